@@ -7,6 +7,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include "libbebo.h"
 
 // ==========================================
 // Constants and Configuration
@@ -21,6 +23,14 @@
 #define MAX_INCLUDE_DEPTH      16
 #define MAX_MACRO_PARAMS       8
 #define CACHE_SIZE             256
+#define PAGE_SHIFT             12         // 4KB pages for dirty tracking
+#define PAGE_SIZE              (1 << PAGE_SHIFT)
+#define NUM_PAGES              (MEMORY_SIZE >> PAGE_SHIFT)
+#define NUM_IRQS               8
+#define DEFAULT_CLOCK_HZ       10000000   // Simulated clock for time conversions (10 MHz)
+#define COVERAGE_MAP_SIZE      65536      // AFL's MAP_SIZE
+#define IDLE_MAX_LOOP          16         // Longest polling loop (instructions) fast-forwarded
+#define SEMIHOST_MAX_FILES     16
 
 // Special Purpose Registers
 enum {
@@ -42,6 +52,26 @@ typedef enum {
     FLAG_DEBUG     = 0x80
 } ProcessorFlags;
 
+// Semihosting (SVC #0 / TRAP #0, function number in R0, arguments in R1-R3)
+#define SEMIHOST_VECTOR        0
+#define SEMIHOST_ERROR         0xFFFFFFFF
+
+typedef enum {
+    SYS_WRITE = 0x01,   // R1 = handle, R2 = buffer, R3 = length -> bytes written
+    SYS_READ  = 0x02,   // R1 = handle, R2 = buffer, R3 = length -> bytes read
+    SYS_OPEN  = 0x03,   // R1 = path (NUL-terminated), R2 = mode -> handle
+    SYS_CLOSE = 0x04,   // R1 = handle -> 0
+    SYS_CLOCK = 0x05,   // -> R0 = host milliseconds, R1 = clock cycles
+    SYS_EXIT  = 0x06    // R1 = exit code
+} SemihostCall;
+
+typedef enum {
+    SEMIHOST_MODE_READ   = 0,
+    SEMIHOST_MODE_WRITE  = 1,
+    SEMIHOST_MODE_RDWR   = 2,
+    SEMIHOST_MODE_APPEND = 3
+} SemihostMode;
+
 // Addressing Modes
 typedef enum {
     AM_IMMEDIATE,      // #value
@@ -173,11 +203,21 @@ typedef struct {
     
     // Debug Information
     bool debug;
+    bool quiet;                 // Only report diagnostics when assembly fails
     char *debug_info;
     
     // Listing Generation
     FILE *list_file;
-    bool generate_listing;
+    bool generate_listing;      // Record source lines in pass 2 for write_listing
+    struct {
+        uint32_t address;
+        uint32_t size;
+        int line;
+        bool instruction;
+        char *text;
+    } *listing;
+    int listing_count;
+    int listing_capacity;
     
     // Relocation Information
     struct {
@@ -203,8 +243,51 @@ typedef struct {
     } cache;
 } AssemblerState;
 
+// Port-mapped device bus (defined in devices.h)
+typedef struct DeviceBus DeviceBus;
+
+// Cycle-ordered event queue (defined in interrupt.c)
+typedef struct EventQueue EventQueue;
+
+// Assembled image and symbols kept for hot patching (defined in hotpatch.c)
+typedef struct HotPatch HotPatch;
+
+// Binary execution trace being written (defined in tracer.h)
+typedef struct Tracer Tracer;
+
+// Guest profiler state (defined in profiler.h)
+typedef struct Profiler Profiler;
+
+// Instruction mix counters (defined in opstats.h)
+typedef struct OpcodeStats OpcodeStats;
+
+// Memory access heatmap (defined in heatmap.h)
+typedef struct Heatmap Heatmap;
+
+// Cache hierarchy model (defined in cache.h)
+typedef struct CacheModel CacheModel;
+
+// In-order pipeline timing model (defined in pipeline.h)
+typedef struct PipelineModel PipelineModel;
+
+// Branch predictor model (defined in branch.h)
+typedef struct BranchPredictor BranchPredictor;
+
+// Live metrics export (defined in metrics.h)
+typedef struct Metrics Metrics;
+
+// Why simulator_run_for returned
+typedef enum {
+    STOP_HALT,          // HALT or SYS_EXIT
+    STOP_BREAKPOINT,    // PC reached a breakpoint
+    STOP_BUDGET,        // Instruction budget used up
+    STOP_FAULT,         // Execution error
+    STOP_EXTERNAL,      // simulator_request_stop (signal or another thread)
+    STOP_MARKER         // TRACE executed with stop_on_marker set
+} StopReason;
+
 // Simulator State
-typedef struct {
+typedef struct SimulatorState {
     uint32_t registers[NUM_REGISTERS];
     uint32_t flags;
     uint8_t *memory;
@@ -215,12 +298,47 @@ typedef struct {
     // Statistics
     uint64_t instructions_executed;
     uint64_t clock_cycles;
+    uint64_t clock_hz;          // Simulated frequency: maps clock_cycles to time
     uint64_t memory_accesses;
+    uint64_t memory_writes;
+    uint64_t io_reads;          // IN instructions
+    uint64_t io_effects;        // OUT, SVC/TRAP and IN from ports with read side effects
+    
+    // Idle detection: state at the last pass over a backward branch
+    struct {
+        uint32_t head;          // Branch target (loop head)
+        uint32_t tail;          // Address of the backward branch
+        uint64_t instructions;
+        uint64_t cycles;
+        uint64_t memory_accesses;
+        uint64_t memory_writes;
+        uint64_t io_reads;
+        uint64_t io_effects;
+        uint32_t registers[NUM_REGISTERS];
+        uint32_t flags;
+        uint32_t sp;
+        bool armed;             // registers/flags/sp above are a valid snapshot
+        uint64_t skipped_cycles;        // Cycles fast-forwarded by WAIT and idle loops
+        uint64_t skipped_instructions;  // Loop iterations accounted without executing
+    } idle;
+    
+    // Dirty page bitmap (one bit per PAGE_SIZE page, set on every write)
+    uint64_t dirty_pages[NUM_PAGES / 64];
+    
+    // Guest range forwarded to the framebuffer's tile tracking (size 0 = off)
+    struct {
+        uint32_t base;
+        uint32_t size;
+        void *opaque;
+    } fb_watch;
     
     // Breakpoints
     uint32_t breakpoints[256];
     int breakpoint_count;
     
+    // Source the guest was assembled from, if loaded with hotpatch_load
+    HotPatch *hotpatch;
+    
     // Watchpoints
     struct {
         uint32_t address;
@@ -236,10 +354,12 @@ typedef struct {
         uint32_t execute;
         uint32_t writeback;
         bool stalled;
+        PipelineModel *model;   // Timing model, NULL unless enabled
     } pipeline;
     
     // I/O Ports
     uint8_t io_ports[256];
+    DeviceBus *bus;
     
     // Interrupt Controller
     struct {
@@ -247,16 +367,40 @@ typedef struct {
         uint8_t mask;
         uint8_t pending;
         void (*handlers[16])(void*);
+        uint32_t vector_base;   // Guest table of 32-bit handler addresses
     } interrupt;
     
+    // Event Scheduling
+    EventQueue *events;
+    uint64_t next_event_cycle;  // Earliest cycle needing service (UINT64_MAX if none)
+    uint64_t interrupts_delivered;
+    
     // Debug Interface
     bool single_step;
-    bool trace;
-    FILE *trace_file;
+    Tracer *tracer;                 // Set by tracer_start; NULL when not tracing
+    Profiler *profiler;             // Set by profiler_start; NULL when not profiling
+    OpcodeStats *opstats;           // Set by opstats_start (BEBO_OPCODE_STATS builds only)
+    Heatmap *heatmap;               // Set by heatmap_start; NULL when not collecting
+    CacheModel *cache;              // Set by cache_start; misses add to clock_cycles
+    BranchPredictor *branch;        // Set by branch_start; mispredictions add to clock_cycles
+    
+    // Semihosting (guest handle -> host file descriptor)
+    int semihost_fds[SEMIHOST_MAX_FILES];
     
     // Execution Control
     bool running;
     bool halted;
+    atomic_int stop_requested;      // Set by simulator_request_stop
+    Metrics *metrics;               // Set by metrics_start; published at backward branches
+    uint64_t instruction_limit;     // End of the current simulator_run_for budget
+    bool stop_on_marker;            // TRACE ends simulator_run_for (otherwise a NOP)
+    bool marker_hit;
+    int exit_code;
+    
+    // AFL-style edge coverage: each control transfer bumps
+    // coverage[hash(target) ^ coverage_prev]. NULL disables it.
+    uint8_t *coverage;
+    uint32_t coverage_prev;
 } SimulatorState;
 
 // ==========================================
@@ -312,13 +456,31 @@ void debug_add_info(AssemblerState *state, const char *info);
 void generate_debug_info(AssemblerState *state);
 
 // Simulator Functions
+// A non-NULL state hands its memory image over to the simulator (no copy);
+// state->memory is NULL afterwards.
 SimulatorState* simulator_create(AssemblerState *state);
 void simulator_destroy(SimulatorState *sim);
 int simulator_load(SimulatorState *sim, const char *filename);
 int simulator_run(SimulatorState *sim);
 int simulator_step(SimulatorState *sim);
+int simulator_run_for(SimulatorState *sim, uint64_t max_instructions, StopReason *stop_reason);
+void simulator_request_stop(SimulatorState *sim);
+const char* simulator_stop_reason_name(StopReason reason);
+void simulator_idle_check(SimulatorState *sim, uint32_t branch_pc);
+uint64_t host_monotonic_ns(void);
 void simulator_reset(SimulatorState *sim);
 
+// Semihosting
+void semihost_init(SimulatorState *sim);
+void semihost_cleanup(SimulatorState *sim);
+int semihost_call(SimulatorState *sim);
+
+// Hot Patching (hotpatch.c)
+int hotpatch_load(SimulatorState *sim, const char *source);
+int hotpatch_reload(SimulatorState *sim, const char *source);
+int hotpatch_symbol_address(SimulatorState *sim, const char *name, uint32_t *address);
+void hotpatch_free(SimulatorState *sim);
+
 // Debugger Functions
 void debugger_start(SimulatorState *sim);
 void debugger_add_breakpoint(SimulatorState *sim, uint32_t address);
@@ -333,6 +495,36 @@ uint8_t memory_read_byte(SimulatorState *sim, uint32_t address);
 uint16_t memory_read_word(SimulatorState *sim, uint32_t address);
 void memory_write_byte(SimulatorState *sim, uint32_t address, uint8_t value);
 void memory_write_word(SimulatorState *sim, uint32_t address, uint16_t value);
+uint32_t memory_read_dword(SimulatorState *sim, uint32_t address);
+void memory_write_dword(SimulatorState *sim, uint32_t address, uint32_t value);
+int memory_read_block(SimulatorState *sim, uint32_t address, uint8_t *dst, uint32_t len);
+int memory_write_block(SimulatorState *sim, uint32_t address, const uint8_t *src, uint32_t len);
+int memory_copy_block(SimulatorState *sim, uint32_t dst, uint32_t src, uint32_t len);
+int memory_fill_block(SimulatorState *sim, uint32_t address, uint8_t value, uint32_t len);
+uint8_t* memory_map_block(SimulatorState *sim, uint32_t address, uint32_t len, bool write);
+void memory_mark_dirty(SimulatorState *sim, uint32_t address, uint32_t len);
+void memory_clear_dirty(SimulatorState *sim);
+void framebuffer_mark_dirty(SimulatorState *sim, uint32_t address, uint32_t len);
+
+// Interrupt Controller
+void interrupt_raise(SimulatorState *sim, int irq);
+void interrupt_clear(SimulatorState *sim, int irq);
+void interrupt_set_enabled(SimulatorState *sim, bool enabled);
+void interrupt_deliver(SimulatorState *sim);
+void interrupt_return(SimulatorState *sim);
+
+// Event Queue
+typedef void (*EventCallback)(SimulatorState *sim, void *opaque);
+EventQueue* event_queue_create(void);
+void event_queue_destroy(EventQueue *q);
+EventQueue* event_queue_save(SimulatorState *sim);
+int event_queue_restore(SimulatorState *sim, const EventQueue *saved);
+uint32_t event_schedule(SimulatorState *sim, uint64_t cycle, EventCallback callback, void *opaque);
+uint32_t event_schedule_observer(SimulatorState *sim, uint64_t cycle, EventCallback callback, void *opaque);
+void event_cancel(SimulatorState *sim, uint32_t id);
+uint64_t event_next_cycle(SimulatorState *sim);
+uint64_t event_next_guest_cycle(SimulatorState *sim);
+void simulator_service_events(SimulatorState *sim);
 
 // Utility Functions
 uint32_t parse_number(const char *str);
@@ -355,4 +547,7 @@ void* hash_table_get(HashTable *ht, const char *key);
 void hash_table_put(HashTable *ht, const char *key, void *value);
 void hash_table_remove(HashTable *ht, const char *key);
 
+// Library Output (log.c; bebo_set_log_callback is in libbebo.h)
+void bebo_log(BeboLogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
 #endif // BEBOASM_H
\ No newline at end of file
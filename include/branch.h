@@ -0,0 +1,89 @@
+#ifndef BRANCH_H
+#define BRANCH_H
+
+#include "beboasm.h"
+
+// ==========================================
+// Branch predictor model
+// ==========================================
+//
+// Replaces the flat cost of a taken conditional branch (cycles.h) with a
+// misprediction penalty. Conditional branches go through a direction
+// predictor (their targets are direct, so known at decode); JMP and CALL
+// targets come from a direct-mapped BTB, RET targets from a return-address
+// stack that CALL pushes. Each misprediction adds the penalty to
+// clock_cycles and is charged to the branch's PC. Under the pipeline
+// model the flush that follows a misprediction is the penalty instead.
+
+typedef enum {
+    BRANCH_STATIC,              // Always predict not taken
+    BRANCH_BIMODAL,             // 2-bit counters indexed by PC
+    BRANCH_GSHARE               // 2-bit counters indexed by PC ^ global history
+} BranchPredictorKind;
+
+typedef struct {
+    BranchPredictorKind kind;
+    uint32_t table_bits;        // log2 of the counter table size
+    uint32_t history_bits;      // gshare global history length
+    uint32_t btb_entries;       // Power of two; 0 disables the BTB
+    uint32_t ras_depth;         // 0 disables the return-address stack
+    uint32_t penalty;           // Cycles per misprediction
+} BranchConfig;
+
+typedef enum {
+    BRANCH_CONDITIONAL,
+    BRANCH_JUMP,                // JMP and CALL, predicted by the BTB
+    BRANCH_RETURN,              // RET, predicted by the RAS
+    BRANCH_CLASS_COUNT
+} BranchClass;
+
+typedef struct {
+    uint32_t pc;
+    uint8_t cls;
+    uint64_t count;             // 0 = empty slot
+    uint64_t taken;
+    uint64_t mispredicts;
+} BranchSite;
+
+struct BranchPredictor {
+    BranchConfig config;
+    uint8_t *counters;
+    uint32_t counter_mask;
+    uint32_t history;
+
+    uint32_t *btb_tags;         // Branch PC + 1 (0 = empty)
+    uint32_t *btb_targets;
+    uint32_t *ras;              // Circular: overflow drops the oldest entry
+    uint32_t ras_top;
+    uint32_t ras_count;
+
+    bool mispredicted;          // Outcome of the instruction just retired
+
+    uint64_t branches[BRANCH_CLASS_COUNT];
+    uint64_t mispredicts[BRANCH_CLASS_COUNT];
+    uint64_t penalty_cycles;    // Without the pipeline model
+
+    BranchSite *sites;          // Open addressing keyed by PC
+    uint32_t site_capacity;
+    uint32_t site_count;
+};
+
+// Bimodal, 4096 counters, 12 bits of history (gshare), 256-entry BTB,
+// 16-deep RAS, 3-cycle penalty
+void branch_default_config(BranchConfig *config);
+// "static", "bimodal" or "gshare"
+int branch_parse_kind(BranchConfig *config, const char *name);
+// "table=BITS", "history=BITS", "btb=ENTRIES", "ras=DEPTH" or "penalty=CYCLES"
+int branch_parse_option(BranchConfig *config, const char *spec);
+
+// Lifecycle: predictor state starts cold; freed by simulator_destroy
+int branch_start(SimulatorState *sim, const BranchConfig *config);
+void branch_stop(SimulatorState *sim);
+
+// Accuracy per branch class, then the max_sites branches that mispredict most
+void branch_report(SimulatorState *sim, int max_sites);
+
+// Called right after the instruction at pc executed
+void branch_retire(SimulatorState *sim, uint32_t pc);
+
+#endif // BRANCH_H
@@ -0,0 +1,138 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "beboasm.h"
+
+// ==========================================
+// Cache hierarchy model
+// ==========================================
+//
+// Split L1 instruction and data caches over an optional unified L2,
+// fed by every fetch, load and store in the memory access functions.
+// Caches are set associative, write-back and write-allocate. An access
+// adds the latency of the level that satisfied it to clock_cycles (the
+// L1 latency is usually 0, being part of each instruction's base cost).
+// Each load or store is one access, or two if it straddles a line; each
+// instruction is one fetch plus one per further line its bytes reach.
+
+typedef enum {
+    CACHE_LRU,
+    CACHE_FIFO,
+    CACHE_RANDOM
+} CachePolicy;
+
+typedef struct {
+    uint32_t size;              // Bytes; 0 disables the level (L2 only)
+    uint32_t ways;
+    uint32_t line_size;
+    CachePolicy policy;
+    uint32_t latency;           // Cycles for an access this level satisfies
+} CacheLevelConfig;
+
+typedef struct {
+    CacheLevelConfig l1i;
+    CacheLevelConfig l1d;
+    CacheLevelConfig l2;
+    uint32_t memory_latency;    // Cycles for an access that misses every level
+} CacheConfig;
+
+typedef struct CacheLevel {
+    // Fast path: another access to the line used last hits without a lookup
+    uint32_t last_line;
+    uint32_t last_slot;
+    uint32_t latency;
+    uint32_t line_shift;
+    uint32_t set_mask;
+    uint32_t ways;
+    CachePolicy policy;
+
+    // Slot set * ways + way holds line + 1 (0 = empty)
+    uint32_t *tags;
+    uint64_t *stamps;           // LRU: last use, FIFO: fill
+    uint8_t *dirty;
+    uint64_t clock;
+    uint32_t random;
+
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t writebacks;
+    struct CacheLevel *next;    // NULL: memory
+    const char *name;
+} CacheLevel;
+
+// Misses charged to the instruction that caused them
+typedef struct {
+    uint32_t pc;
+    uint64_t l1_misses;
+    uint64_t l2_misses;
+    uint64_t cycles;            // Latency added by the misses
+} CacheMissPC;
+
+struct CacheModel {
+    CacheLevel l1i;
+    CacheLevel l1d;
+    CacheLevel l2;
+    uint32_t memory_latency;
+    uint64_t cycles;            // Latency added by every access
+    uint64_t miss_cycles;       // Latency added by L1 misses
+
+    uint32_t pc;                // Instruction being executed
+    CacheMissPC *pcs;           // Open addressing; l1_misses 0 = empty
+    uint32_t pc_capacity;
+    uint32_t pc_count;
+};
+
+// L1I/L1D 16 KB 4-way, L2 256 KB 8-way, 64-byte lines, LRU,
+// latencies 0 / 10 / 100 cycles
+void cache_default_config(CacheConfig *config);
+// "l1i=SIZE,WAYS,LINE[,POLICY[,LATENCY]]" (also l1d, l2) or "memory=LATENCY";
+// SIZE takes a K or M suffix and POLICY is lru, fifo or random
+int cache_parse_option(CacheConfig *config, const char *spec);
+
+// Lifecycle: the caches start empty; freed by simulator_destroy
+int cache_start(SimulatorState *sim, const CacheConfig *config);
+void cache_stop(SimulatorState *sim);
+
+// Per-level hit rates, then the max_pcs instructions with the most miss cycles
+void cache_report(SimulatorState *sim, int max_pcs);
+
+// Out-of-line half of cache_access
+void cache_lookup(SimulatorState *sim, CacheLevel *c, uint32_t address, bool write);
+
+static inline void cache_access(SimulatorState *sim, CacheLevel *c, uint32_t address, bool write) {
+    c->accesses++;
+    if ((address >> c->line_shift) == c->last_line) {
+        if (write) c->dirty[c->last_slot] = 1;
+        sim->clock_cycles += c->latency;
+        sim->cache->cycles += c->latency;
+        return;
+    }
+    cache_lookup(sim, c, address, write);
+}
+
+// Hooks in the memory access functions. Instruction bytes after the
+// opcode (at cache->pc) only probe when they start a new line.
+static inline void cache_fetch(SimulatorState *sim, uint32_t address) {
+    CacheLevel *c = &sim->cache->l1i;
+    if (address == sim->cache->pc || !(address & ((1u << c->line_shift) - 1))) {
+        cache_access(sim, c, address, false);
+    }
+}
+
+static inline void cache_data(SimulatorState *sim, uint32_t address, uint32_t size, bool write) {
+    CacheLevel *c = &sim->cache->l1d;
+    cache_access(sim, c, address, write);
+    if (size > 1 && ((address + size - 1) >> c->line_shift) != (address >> c->line_shift)) {
+        cache_access(sim, c, address + size - 1, write);
+    }
+}
+
+static inline void cache_read(SimulatorState *sim, uint32_t address, uint32_t size) {
+    cache_data(sim, address, size, false);
+}
+
+static inline void cache_write(SimulatorState *sim, uint32_t address, uint32_t size) {
+    cache_data(sim, address, size, true);
+}
+
+#endif // CACHE_H
@@ -0,0 +1,45 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include "beboasm.h"
+
+// ==========================================
+// Instruction cycle costs
+// ==========================================
+//
+// One table, indexed by opcode and addressing mode, holds what every
+// instruction costs: the simulator's handlers charge it and assembler
+// listings print it. Mode 0 is a register operand, mode 1 an immediate
+// or absolute address; instructions without a mode byte use mode 0.
+// Taken conditional branches add taken[] on top, and entering a guest
+// interrupt handler costs interrupt. The table can be loaded from a file
+// to model other hardware variants.
+
+#define CYCLE_MODES 2
+
+typedef struct {
+    uint8_t cost[256 * CYCLE_MODES];    // opcode * CYCLE_MODES + mode
+    uint8_t taken[256];                 // Extra cycles for a taken branch
+    uint8_t interrupt;                  // Pushing PC/flags and vectoring
+} CycleTable;
+
+extern CycleTable cycle_table;
+
+static inline uint32_t cycle_cost(uint8_t opcode, uint8_t mode) {
+    return cycle_table.cost[opcode * CYCLE_MODES + (mode & 1)];
+}
+
+// Overrides entries from a text file, one instruction per line:
+//   MNEMONIC|OPCODE  REGISTER [IMMEDIATE [TAKEN]]
+//   INTERRUPT        ENTRY
+// '#' or ';' start a comment. Nothing changes if any line is invalid.
+int cycles_load(const char *filename);
+
+// The current table in the format cycles_load reads
+void cycles_write(FILE *f);
+
+// Cost of the encoded instruction at code (size bytes); *taken gets the
+// extra cycles if it is a conditional branch that is taken
+uint32_t cycles_instruction(const uint8_t *code, uint32_t size, uint32_t *taken);
+
+#endif // CYCLES_H
@@ -0,0 +1,165 @@
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include "beboasm.h"
+
+// ==========================================
+// Port-mapped Device Bus
+// ==========================================
+#define NUM_PORTS              65536      // OP_IN/OP_OUT carry a 16-bit port
+#define MAX_DEVICES            32
+#define MAX_DEVICE_NAME        32
+
+// Standard Port Assignments
+#define PORT_STDOUT            0x0001
+#define PORT_PIC_BASE          0x0020
+#define PORT_PIC_COUNT         4
+#define PORT_TIMER_BASE        0x0040
+#define PORT_TIMER_COUNT       4
+#define PORT_RTC_BASE          0x0070
+#define PORT_RTC_COUNT         6
+#define PORT_ATA_BASE          0x01F0
+#define PORT_ATA_COUNT         8
+#define ATA_SECTOR_SIZE        512
+#define PORT_DISPLAY           0xC000
+#define PORT_PRINTER           0xC001
+#define PORT_FB_BASE           0xC010
+#define PORT_FB_COUNT          6
+#define PORT_DMA_BASE          0xC100
+#define PORT_DMA_COUNT         5
+#define PORT_VIRTQ_BASE        0xC200
+#define PORT_VIRTQ_COUNT       8
+#define PORT_KEYBOARD          0xC800     // Data: next input byte (0 if none)
+#define PORT_MOUSE             0xC801
+#define PORT_KEYBOARD_STATUS   0xC802
+#define PORT_KEYBOARD_CONTROL  0xC803
+
+// Interrupt Lines
+#define IRQ_TIMER              0
+#define IRQ_KEYBOARD           1
+#define IRQ_DMA                3
+#define IRQ_VIRTQ              4
+
+// Device callbacks. 'port' is the absolute port number, 'opaque' is the
+// pointer passed at registration time.
+typedef uint32_t (*DeviceReadFn)(SimulatorState *sim, void *opaque, uint16_t port);
+typedef void (*DeviceWriteFn)(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value);
+
+typedef struct Device {
+    char name[MAX_DEVICE_NAME];
+    uint16_t base;          // First port
+    uint32_t count;         // Number of consecutive ports
+    DeviceReadFn read;
+    DeviceWriteFn write;
+    void (*reset)(SimulatorState *sim, void *opaque);
+    void (*print_stats)(SimulatorState *sim, void *opaque);
+    void (*destroy)(void *opaque);
+    void *opaque;
+    bool active;
+    uint64_t idle_reads;    // Bit n set: reading base+n has no side effects
+                            // (bit 63 covers every offset >= 63)
+    size_t state_size;      // Bytes of *opaque captured by device_bus_save (0: none)
+    void (*restore)(SimulatorState *sim, void *opaque, const void *saved);
+                            // Apply a saved copy; NULL copies it back verbatim
+    uint64_t (*counter)(SimulatorState *sim, void *opaque);
+                            // Running total for live metrics (NULL: none)
+    const char *counter_name;   // Its key in the metrics line, e.g. "ata_sectors"
+} Device;
+
+// Every port maps to a slot in devices[]; slot 0 is the null device, so
+// unmapped ports need no setup (the map starts zeroed) and dispatch is a
+// single table load with no range checks.
+#define DEVICE_NULL_SLOT       0
+
+struct DeviceBus {
+    uint8_t port_map[NUM_PORTS];
+    Device devices[MAX_DEVICES];
+    int device_count;
+};
+
+// Bus Lifecycle
+DeviceBus* device_bus_create(void);
+void device_bus_destroy(SimulatorState *sim, DeviceBus *bus);
+void device_bus_reset(SimulatorState *sim);
+void device_bus_print_stats(SimulatorState *sim);
+
+// Device snapshot for rewinding (fuzzer): the state_size bytes of every
+// device that declares them. Restore together with the event queue, since
+// devices hold the ids of their pending events.
+typedef struct DeviceSnapshot DeviceSnapshot;
+DeviceSnapshot* device_bus_save(SimulatorState *sim);
+void device_bus_restore(SimulatorState *sim, const DeviceSnapshot *snap);
+void device_snapshot_free(DeviceSnapshot *snap);
+
+// Device Registration (usable from embedding programs)
+Device* device_register(SimulatorState *sim, const char *name, uint16_t base, uint32_t count,
+                        DeviceReadFn read, DeviceWriteFn write, void *opaque);
+int device_unregister(SimulatorState *sim, Device *dev);
+Device* device_find(SimulatorState *sim, const char *name);
+void devices_register_builtin(SimulatorState *sim);
+
+// ATA Disk (ata.c)
+int ata_attach_image(SimulatorState *sim, const char *path);
+
+// Interrupt Controller and Timer (interrupt.c, timer.c)
+void interrupt_controller_attach(SimulatorState *sim);
+int timer_attach(SimulatorState *sim);
+
+// Real-time Clock and Pacing (rtc.c)
+int rtc_attach(SimulatorState *sim);
+int rtc_set_pacing(SimulatorState *sim, bool throttle, bool report);
+
+// Keyboard/Input (keyboard.c), fed by a host reader thread
+int keyboard_attach(SimulatorState *sim, const char *path);
+
+// Framebuffer (framebuffer.c)
+int framebuffer_attach(SimulatorState *sim);
+int framebuffer_set_export(SimulatorState *sim, const char *prefix, uint64_t interval);
+
+// DMA Controller (dma.c)
+int dma_attach(SimulatorState *sim);
+
+// Virtqueue Device (virtqueue.c)
+#define VIRTQ_NUM_QUEUES       2
+#define VIRTQ_TX               0          // Guest -> host buffers
+#define VIRTQ_RX               1          // Host -> guest buffers
+#define VIRTQ_MAX_SIZE         256
+
+// Host side of the virtqueue. read fills a guest buffer (RX), write
+// consumes one (TX); both return the number of bytes moved.
+typedef struct VirtqBackend {
+    const char *name;
+    long (*read)(struct VirtqBackend *be, uint8_t *buf, uint32_t len);
+    long (*write)(struct VirtqBackend *be, const uint8_t *buf, uint32_t len);
+    void (*close)(struct VirtqBackend *be);
+    void *opaque;
+} VirtqBackend;
+
+// Takes ownership of the backend, closing it if the attach fails
+int virtq_attach(SimulatorState *sim, VirtqBackend *backend);
+VirtqBackend* virtq_backend_fd(int in_fd, int out_fd);
+VirtqBackend* virtq_backend_file(const char *in_path, const char *out_path);
+VirtqBackend* virtq_backend_memory(const uint8_t *input, size_t input_len);
+const uint8_t* virtq_backend_memory_output(VirtqBackend *be, size_t *len);
+
+// Port Access (hot path)
+static inline uint32_t device_read(SimulatorState *sim, uint16_t port) {
+    Device *dev = &sim->bus->devices[sim->bus->port_map[port]];
+    return dev->read(sim, dev->opaque, port);
+}
+
+// True if an IN from this port may change device state, which rules out
+// fast-forwarding a loop that polls it.
+static inline bool device_read_has_effects(SimulatorState *sim, uint16_t port) {
+    Device *dev = &sim->bus->devices[sim->bus->port_map[port]];
+    uint32_t offset = port - dev->base;
+    if (offset > 63) offset = 63;
+    return !(dev->idle_reads & (1ULL << offset));
+}
+
+static inline void device_write(SimulatorState *sim, uint16_t port, uint32_t value) {
+    Device *dev = &sim->bus->devices[sim->bus->port_map[port]];
+    dev->write(sim, dev->opaque, port, value);
+}
+
+#endif // DEVICES_H
@@ -0,0 +1,63 @@
+#ifndef FUZZER_H
+#define FUZZER_H
+
+#include "beboasm.h"
+#include <signal.h>
+#include <stdatomic.h>
+
+// ==========================================
+// bebofuzz: snapshot fuzzing of guest programs
+// ==========================================
+
+#define FUZZ_MAX_WORKERS       64
+#define FUZZ_MAX_INPUT         (1 << 20)
+
+// Where each test case goes in the guest
+typedef struct {
+    bool use_buffer;            // Copy input to buffer_addr; R0 = length, R1 = address
+    uint32_t buffer_addr;
+    uint32_t buffer_size;
+    bool use_port;              // IN port: next byte (0xFFFFFFFF at end); port+1: bytes left
+    uint16_t port;
+    uint64_t budget;            // Instructions per test case before it counts as a hang
+    uint32_t max_len;           // Longest input the mutator produces
+} FuzzConfig;
+
+typedef enum {
+    FUZZ_OK,
+    FUZZ_CRASH,                 // Guest fault
+    FUZZ_HANG                   // Budget used up
+} FuzzResult;
+
+// Global coverage and statistics, mapped shared between worker processes
+typedef struct {
+    _Atomic uint64_t virgin[COVERAGE_MAP_SIZE / 8];         // Bits not yet seen
+    _Atomic uint64_t virgin_crash[COVERAGE_MAP_SIZE / 8];   // Same, for crashes only
+    _Atomic uint64_t virgin_tmout[COVERAGE_MAP_SIZE / 8];   // Same, for hangs only
+    struct {
+        _Atomic uint64_t execs;
+        _Atomic uint64_t paths;
+        _Atomic uint64_t crashes;
+        _Atomic uint64_t hangs;
+    } workers[FUZZ_MAX_WORKERS];
+} FuzzShared;
+
+typedef struct Fuzzer Fuzzer;
+
+// Lifecycle: the snapshot is the simulator's state at creation time
+Fuzzer* fuzzer_create(SimulatorState *sim, const FuzzConfig *config);
+void fuzzer_destroy(Fuzzer *fz);
+
+// One test case: restore dirtied pages, inject, run. Coverage is left in
+// the map returned by fuzzer_trace (or the one set with fuzzer_set_trace).
+FuzzResult fuzzer_exec(Fuzzer *fz, const uint8_t *data, uint32_t len);
+uint8_t* fuzzer_trace(Fuzzer *fz);
+void fuzzer_set_trace(Fuzzer *fz, uint8_t *map);
+
+// Worker loop: seeds from in_dir (AFL-style corpus, may be NULL), writes
+// out_dir/<name>/{queue,crashes,hangs} and syncs with sibling directories.
+// Runs until *stop is set or max_execs test cases have run (0 = no limit).
+void fuzzer_worker(Fuzzer *fz, FuzzShared *shared, int id, const char *in_dir,
+                   const char *out_dir, uint64_t max_execs, volatile sig_atomic_t *stop);
+
+#endif // FUZZER_H
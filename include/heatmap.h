@@ -0,0 +1,86 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "beboasm.h"
+#include "symtab.h"
+
+// ==========================================
+// Guest memory heatmap
+// ==========================================
+//
+// Per-page read, write and execute counts collected in the memory access
+// functions, the number of distinct pages touched in each window of
+// instructions (working set), and LRU reuse distances over 64-byte lines
+// kept separately for instruction fetches and data accesses. A fetch is
+// counted once per instruction, at its first byte.
+
+#define HEATMAP_LINE_SHIFT      6       // Reuse distance granularity: 64-byte lines
+#define HEATMAP_LINES           (MEMORY_SIZE >> HEATMAP_LINE_SHIFT)
+#define HEATMAP_REUSE_BUCKETS   20      // 0, 1, 2-3, 4-7, ... distinct lines in between
+#define HEATMAP_CLOCK_SIZE      (1 << 20)       // Timestamps before compaction
+#define HEATMAP_DEFAULT_WINDOW  100000  // Instructions per working-set sample
+
+typedef struct {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t execs;
+} HeatmapPage;
+
+typedef struct {
+    uint64_t instructions;      // Executed when the window closed
+    uint32_t pages;             // Distinct pages touched in the window
+} HeatmapWindow;
+
+// Exact LRU stack distance: every line keeps a mark at the timestamp of
+// its last access, and the marks after it count the distinct lines used
+// since. Timestamps are renumbered when the clock runs out.
+typedef struct {
+    uint32_t *last;             // Per line: timestamp + 1 of last access, 0 = never
+    uint32_t *owner;            // Per timestamp: line accessed
+    uint32_t *tree;             // Fenwick tree over marks
+    uint32_t clock;
+    uint32_t live;              // Lines with a mark
+    uint64_t histogram[HEATMAP_REUSE_BUCKETS + 1];  // Last bucket: first touch
+} ReuseStack;
+
+struct Heatmap {
+    HeatmapPage pages[NUM_PAGES];
+
+    // Working set: a page joins the window the first time its epoch is stale
+    uint32_t epoch[NUM_PAGES];
+    uint32_t window_epoch;
+    uint32_t window_pages;
+    uint64_t window;
+    uint64_t window_end;
+    HeatmapWindow *windows;
+    int window_count;
+    int window_capacity;
+
+    ReuseStack code;
+    ReuseStack data;
+
+    SymbolTable sections;
+    SymbolTable symbols;        // Code, data and bss labels
+};
+
+// Lifecycle: collection starts with the next instruction; window is in
+// instructions (0 selects HEATMAP_DEFAULT_WINDOW). Freed by simulator_destroy.
+int heatmap_start(SimulatorState *sim, uint64_t window);
+void heatmap_stop(SimulatorState *sim);
+
+// Sections and symbols for the report: from an assembler run or a map file
+int heatmap_add_symbols(SimulatorState *sim, AssemblerState *state);
+int heatmap_load_map(SimulatorState *sim, const char *path);
+
+// Working set over time, hottest pages and reuse distances on the log
+void heatmap_report(SimulatorState *sim, int max_pages);
+// Per-page counters as CSV, or a PPM image when path ends in .ppm
+int heatmap_export(SimulatorState *sim, const char *path);
+
+// Hooks: reads and writes from the memory access functions, and one
+// execute per retired instruction
+void heatmap_read(SimulatorState *sim, uint32_t address);
+void heatmap_write(SimulatorState *sim, uint32_t address);
+void heatmap_exec(SimulatorState *sim, uint32_t pc);
+
+#endif // HEATMAP_H
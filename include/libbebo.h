@@ -0,0 +1,92 @@
+#ifndef LIBBEBO_H
+#define LIBBEBO_H
+
+// libbebo: embeddable BeboAsm simulator
+//
+// Link with libbebo.a or libbebo.so (plus -lm -lpthread). The simulator
+// state is opaque here; everything goes through the functions below, so
+// programs built against this header keep working as the internals change.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBBEBO_VERSION        1
+
+typedef struct SimulatorState BeboSim;
+
+// Why bebo_run_for returned (same values as StopReason)
+typedef enum {
+    BEBO_STOP_HALT,
+    BEBO_STOP_BREAKPOINT,
+    BEBO_STOP_BUDGET,
+    BEBO_STOP_FAULT,
+    BEBO_STOP_EXTERNAL,
+    BEBO_STOP_MARKER
+} BeboStopReason;
+
+// Logging: all library output (statistics, diagnostics, debugger views)
+// is passed to the callback as text fragments, not necessarily whole
+// lines. With no callback, info goes to stdout and errors to stderr.
+// Guest console output (port 0x01, semihosting) is not log output.
+typedef enum {
+    BEBO_LOG_INFO,
+    BEBO_LOG_ERROR
+} BeboLogLevel;
+
+typedef void (*BeboLogFn)(void *user, BeboLogLevel level, const char *text);
+void bebo_set_log_callback(BeboLogFn callback, void *user);
+
+// Lifecycle
+BeboSim* bebo_create(void);
+void bebo_destroy(BeboSim *sim);
+int bebo_load(BeboSim *sim, uint32_t address, const void *data, size_t len);
+
+// Assemble BeboAsm source text straight into a new simulator, ready to run
+// from address 0. Returns NULL on assembly errors (reported through the log).
+BeboSim* bebo_create_from_source(const char *source);
+
+// One-shot assemble and execute. Returns 1 if the program assembled and
+// ran without faulting; *reason and *exit_code may be NULL.
+int bebo_run_source(const char *source, uint64_t max_instructions,
+                    BeboStopReason *reason, int *exit_code);
+
+// Execution
+int bebo_run_for(BeboSim *sim, uint64_t max_instructions, BeboStopReason *reason);
+void bebo_request_stop(BeboSim *sim);
+int bebo_exit_code(BeboSim *sim);
+uint64_t bebo_instructions(BeboSim *sim);
+uint64_t bebo_cycles(BeboSim *sim);
+
+// Registers (0-31, see the register map in doc.md) and memory
+uint32_t bebo_get_register(BeboSim *sim, int reg);
+void bebo_set_register(BeboSim *sim, int reg, uint32_t value);
+uint32_t bebo_get_pc(BeboSim *sim);
+void bebo_set_pc(BeboSim *sim, uint32_t pc);
+int bebo_read_memory(BeboSim *sim, uint32_t address, void *dst, size_t len);
+int bebo_write_memory(BeboSim *sim, uint32_t address, const void *src, size_t len);
+
+// Devices: callbacks receive the absolute port and the opaque pointer
+typedef uint32_t (*BeboPortReadFn)(BeboSim *sim, void *opaque, uint16_t port);
+typedef void (*BeboPortWriteFn)(BeboSim *sim, void *opaque, uint16_t port, uint32_t value);
+
+int bebo_register_device(BeboSim *sim, const char *name, uint16_t base, uint32_t count,
+                         BeboPortReadFn read, BeboPortWriteFn write, void *opaque);
+int bebo_unregister_device(BeboSim *sim, const char *name);
+
+// Events and interrupts: callbacks run between instructions once the
+// cycle counter reaches 'cycle'. Returns an id for bebo_cancel_event, 0 on failure.
+typedef void (*BeboEventFn)(BeboSim *sim, void *opaque);
+
+uint32_t bebo_schedule_event(BeboSim *sim, uint64_t cycle, BeboEventFn callback, void *opaque);
+void bebo_cancel_event(BeboSim *sim, uint32_t id);
+void bebo_raise_irq(BeboSim *sim, int irq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBBEBO_H
@@ -0,0 +1,87 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "beboasm.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// ==========================================
+// Live metrics export
+// ==========================================
+//
+// The CPU loop copies its counters into a snapshot every
+// METRICS_PUBLISH_INSTRUCTIONS instructions, checked at backward branches
+// next to the stop flag: plain stores under a sequence counter, no lock
+// and no syscall. A sampler thread at idle priority reads the snapshot
+// every interval and appends one line to a file, or sends it to a Unix
+// domain socket ("unix:/path"):
+//   bebosim ts_ms=... instructions=... cycles=... ips=... memory_accesses=...
+//           memory_writes=... io_reads=... io_effects=... interrupts=...
+//           idle_cycles=... [l1i_hit=... l1d_hit=... l2_hit=...]
+//           [ata_sectors=... dma_bytes=... ...] halted=0|1
+// The per-device totals come from each device's counter hook, for the
+// devices attached when metrics start.
+
+#define METRICS_PUBLISH_INSTRUCTIONS    65536
+#define METRICS_POLL_MS                 50      // Sampler wakeup for shutdown checks
+#define METRICS_MAX_DEVICES             8       // Device counters exported
+
+typedef enum {
+    METRIC_INSTRUCTIONS,
+    METRIC_CYCLES,
+    METRIC_MEMORY_ACCESSES,
+    METRIC_MEMORY_WRITES,
+    METRIC_IO_READS,
+    METRIC_IO_EFFECTS,
+    METRIC_INTERRUPTS,
+    METRIC_IDLE_CYCLES,
+    METRIC_L1I_ACCESSES,
+    METRIC_L1I_MISSES,
+    METRIC_L1D_ACCESSES,
+    METRIC_L1D_MISSES,
+    METRIC_L2_ACCESSES,
+    METRIC_L2_MISSES,
+    METRIC_HALTED,
+    METRIC_DEVICE_FIRST,
+    METRIC_COUNT = METRIC_DEVICE_FIRST + METRICS_MAX_DEVICES
+} MetricId;
+
+struct Metrics {
+    // Seqlock: odd while the CPU thread is writing
+    _Atomic uint64_t seq;
+    _Atomic uint64_t values[METRIC_COUNT];
+    uint64_t next_publish;          // CPU thread only
+    struct {
+        int slot;                   // Index in the device bus
+        char name[32];
+    } devices[METRICS_MAX_DEVICES];
+    int device_count;
+
+    // Sampler thread
+    pthread_t thread;
+    bool thread_started;
+    atomic_bool stop;
+    uint32_t interval_ms;
+    char path[256];
+    bool socket;
+    int fd;                         // -1 while disconnected
+    bool cache;                     // Cache model present at start
+    uint64_t last_instructions;
+    uint64_t last_ns;
+    uint64_t lines;
+};
+
+// Lifecycle: starts the sampler; stopping publishes once more and writes
+// a final line. Freed by simulator_destroy if still running.
+int metrics_start(SimulatorState *sim, const char *destination, uint32_t interval_ms);
+void metrics_stop(SimulatorState *sim);
+
+// Copy the counters into the snapshot (CPU thread)
+void metrics_publish(SimulatorState *sim);
+
+// Backward-branch hook
+static inline void metrics_tick(SimulatorState *sim) {
+    if (sim->instructions_executed >= sim->metrics->next_publish) metrics_publish(sim);
+}
+
+#endif // METRICS_H
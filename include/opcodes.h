@@ -205,7 +205,6 @@ typedef struct {
     Opcode opcode;
     uint8_t format;
     uint8_t size;           // Base size in bytes
-    uint8_t cycles;         // Base cycles
     uint8_t operands;       // Number of operands
     struct {
         uint8_t types;      // Allowed operand types (bitmask of OperandType)
@@ -0,0 +1,78 @@
+#ifndef OPSTATS_H
+#define OPSTATS_H
+
+#include "beboasm.h"
+#include "opcodes.h"
+
+// ==========================================
+// Instruction mix counters
+// ==========================================
+//
+// Per-opcode execution counts and cycles, mode byte usage and taken/not
+// taken counts for conditional jumps. The hooks only exist in builds with
+// BEBO_OPCODE_STATS defined (make OPCODE_STATS=1); otherwise they compile
+// to nothing and opstats_start fails.
+
+#define OPSTATS_MODE_REG        0       // Mode byte 0x00
+#define OPSTATS_MODE_IMM        1       // Mode byte 0x01
+
+// One cache line per opcode: an instruction touches a single line
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t modes[2];          // Indexed by OPSTATS_MODE_*
+    uint64_t taken;             // Conditional jumps only
+    uint64_t not_taken;
+    uint64_t reserved[2];
+} OpcodeCounter;
+
+struct OpcodeStats {
+    OpcodeCounter counters[256];
+    uint8_t opcode;             // Opcode being executed
+};
+
+// Lifecycle: counting starts with the next instruction; the counters are
+// freed by simulator_destroy
+int opstats_start(SimulatorState *sim);
+void opstats_stop(SimulatorState *sim);
+
+// Opcodes sorted by count, as a table on the log or a JSON document
+void opstats_report(SimulatorState *sim);
+int opstats_write_json(SimulatorState *sim, const char *path);
+
+#ifdef BEBO_OPCODE_STATS
+
+static inline void opstats_fetch(SimulatorState *sim, uint8_t opcode) {
+    if (sim->opstats) sim->opstats->opcode = opcode;
+}
+
+static inline void opstats_mode(SimulatorState *sim, uint8_t mode) {
+    if (sim->opstats && mode <= OPSTATS_MODE_IMM) {
+        sim->opstats->counters[sim->opstats->opcode].modes[mode]++;
+    }
+}
+
+// After the instruction at pc retired. Conditional jumps are three bytes,
+// so anything but the next address means the branch was taken.
+static inline void opstats_record(SimulatorState *sim, uint32_t pc, uint64_t cycles) {
+    if (!sim->opstats) return;
+    OpcodeCounter *c = &sim->opstats->counters[sim->opstats->opcode];
+    c->count++;
+    c->cycles += cycles;
+    if (sim->opstats->opcode >= OP_JZ && sim->opstats->opcode <= OP_JNO) {
+        if (sim->pc != pc + 3) c->taken++;
+        else c->not_taken++;
+    }
+}
+
+#else
+
+static inline void opstats_fetch(SimulatorState *sim, uint8_t opcode) { (void)sim; (void)opcode; }
+static inline void opstats_mode(SimulatorState *sim, uint8_t mode) { (void)sim; (void)mode; }
+static inline void opstats_record(SimulatorState *sim, uint32_t pc, uint64_t cycles) {
+    (void)sim; (void)pc; (void)cycles;
+}
+
+#endif // BEBO_OPCODE_STATS
+
+#endif // OPSTATS_H
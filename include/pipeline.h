@@ -0,0 +1,79 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "beboasm.h"
+
+// ==========================================
+// In-order pipeline timing model
+// ==========================================
+//
+// A five-stage IF/ID/EX/MEM/WB pipeline issuing one instruction per
+// cycle. Instead of each handler's fixed cost, an instruction advances
+// clock_cycles by the cycles between its issue into EX and the previous
+// one's:
+//   - data hazards: a source register written by an instruction still in
+//     flight. With forwarding only a load feeding the next instruction
+//     stalls (load-use); without it the consumer waits for write-back.
+//   - control hazards: taken conditional branches, RET and RETI/IRET
+//     flush the instructions fetched behind them; JMP and CALL, resolved
+//     in decode, flush one. With the branch predictor model only its
+//     mispredictions flush.
+//   - memory: latency added by the cache model (if enabled) stalls the
+//     pipeline for as long as it lasts. WAIT still skips to the next event.
+
+#define PIPE_REG_FLAGS          NUM_REGISTERS           // Scoreboard slot for FLAGS
+#define PIPE_REG_CALL_SP        (NUM_REGISTERS + 1)     // sim->sp, used by CALL/RET
+#define PIPE_NUM_REGS           (NUM_REGISTERS + 2)
+
+typedef enum {
+    PIPE_STALL_DATA,            // RAW dependency on an ALU result
+    PIPE_STALL_LOAD_USE,        // RAW dependency on a load result
+    PIPE_STALL_BRANCH,          // Flush after a taken conditional branch
+    PIPE_STALL_JUMP,            // Flush after JMP/CALL/RET/RETI
+    PIPE_STALL_MEMORY,          // Cache miss latency
+    PIPE_STALL_COUNT
+} PipelineStall;
+
+typedef struct {
+    bool forwarding;            // EX/MEM results bypass to EX
+    uint32_t branch_penalty;    // Taken conditional branch (resolved in EX)
+    uint32_t jump_penalty;      // JMP/CALL (resolved in ID)
+    uint32_t return_penalty;    // RET, RETI/IRET (target read from the stack)
+} PipelineConfig;
+
+struct PipelineModel {
+    PipelineConfig config;
+
+    uint64_t issue;             // Pipeline cycle the last instruction entered EX
+    uint64_t ready[PIPE_NUM_REGS];      // First cycle a consumer may enter EX
+    bool from_load[PIPE_NUM_REGS];      // ready[] was set by a load
+    uint32_t flush;             // Bubbles owed by the last control transfer
+    PipelineStall flush_cause;
+    bool flush_mispredict;      // The flush is a branch predictor miss
+    uint64_t memory_cycles;     // Cache model latency seen so far
+
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t stalls[PIPE_STALL_COUNT];
+    uint64_t mispredict_cycles; // Flush cycles from branch predictor misses
+};
+
+// Classic five-stage defaults: forwarding, 2-cycle branch and return
+// penalties, 1-cycle jump penalty
+void pipeline_default_config(PipelineConfig *config);
+// "branch=N", "jump=N", "return=N" (flush cycles) or "forwarding=on|off"
+int pipeline_parse_option(PipelineConfig *config, const char *spec);
+
+// Lifecycle: the model takes over instruction timing from the next
+// instruction; freed by simulator_destroy
+int pipeline_start(SimulatorState *sim, const PipelineConfig *config);
+void pipeline_stop(SimulatorState *sim);
+
+// CPI and the stall breakdown
+void pipeline_report(SimulatorState *sim);
+
+// Called right after an instruction at pc executed, with clock_cycles as
+// it was before; replaces the handler's cycles with the pipeline's
+void pipeline_retire(SimulatorState *sim, uint32_t pc, uint64_t cycles_before);
+
+#endif // PIPELINE_H
@@ -0,0 +1,108 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "beboasm.h"
+#include "symtab.h"
+
+// ==========================================
+// Guest profiler
+// ==========================================
+//
+// PROFILE_EXACT counts instructions and cycles for every executed PC in
+// the code range; PROFILE_SAMPLE records the PC every 'period' cycles
+// from the event queue and costs nothing in between. Both attribute
+// their cost to a shadow call stack kept from CALL/RET and interrupts,
+// which feeds the call graph report and collapsed output.
+
+#define PROFILE_MAX_DEPTH       128     // Deeper calls are folded into the last frame
+
+typedef enum {
+    PROFILE_EXACT,
+    PROFILE_SAMPLE
+} ProfileMode;
+
+// One node per distinct call path
+typedef struct ProfileFrame {
+    uint32_t entry;             // Call target (function address)
+    uint64_t weight;            // Self cycles (exact) or samples
+    uint64_t instructions;      // Self instructions (exact)
+    uint64_t calls;             // Times this path was entered
+    uint64_t total;             // Inclusive weight and instructions,
+    uint64_t total_instructions;        // filled in when reporting
+    struct ProfileFrame *parent;
+    struct ProfileFrame *child;
+    struct ProfileFrame *sibling;
+} ProfileFrame;
+
+struct Profiler {
+    ProfileMode mode;
+    uint64_t period;
+    uint32_t event_id;
+    uint32_t jitter;            // xorshift state: sample intervals vary around period
+
+    // Per-PC counters for [code_base, code_base + code_size)
+    uint32_t code_base;
+    uint32_t code_size;
+    uint64_t *instructions;     // Samples in PROFILE_SAMPLE mode
+    uint64_t *cycles;           // PROFILE_EXACT only
+    uint64_t other_instructions;        // PCs outside the code range
+    uint64_t other_cycles;
+
+    // Shadow call stack: 'top' follows CALL/RET as they execute;
+    // 'current' is where the instruction being retired is charged (exact)
+    ProfileFrame *root;
+    ProfileFrame *top;
+    ProfileFrame *current;
+    struct {
+        ProfileFrame *frame;
+        uint32_t return_addr;   // Where the matching RET should go
+    } stack[PROFILE_MAX_DEPTH];
+    int depth;
+    int folded;                 // Calls not given a frame past PROFILE_MAX_DEPTH
+    uint64_t unwound;           // Frames skipped by a RET to an outer caller
+    uint64_t mismatched;        // RETs to an address no frame expected
+    bool call_graph;            // Report adds call tree, edges and top paths
+
+    SymbolTable symbols;        // Code labels
+};
+
+// Lifecycle: profiling starts at the current PC and is freed by
+// simulator_destroy. code_size 0 profiles per function/stack only.
+int profiler_start(SimulatorState *sim, ProfileMode mode, uint64_t period,
+                   uint32_t code_base, uint32_t code_size);
+void profiler_stop(SimulatorState *sim);
+
+// Symbols for the report: from an assembler run or a beboasm --map file
+int profiler_add_symbols(SimulatorState *sim, AssemblerState *state);
+int profiler_load_map(SimulatorState *sim, const char *path);
+
+// Report sorted by cost: functions, then (with call_graph set) the call
+// tree, call edges and top call paths, then the hottest addresses
+void profiler_report(SimulatorState *sim, int max_rows);
+// Collapsed stacks ("main;f;g 1234" per line) for flame graph tools
+int profiler_write_collapsed(SimulatorState *sim, const char *path);
+
+// Hooks in execute_call/execute_ret, RETI/IRET and interrupt_deliver
+void profiler_call(SimulatorState *sim, uint32_t target, uint32_t return_addr);
+void profiler_ret(SimulatorState *sim, uint32_t target);
+void profiler_interrupt(SimulatorState *sim, uint32_t handler, uint32_t return_addr);
+
+// Called after every executed instruction while sim->profiler is set
+static inline void profiler_record(SimulatorState *sim, uint32_t pc, uint64_t cycles) {
+    Profiler *p = sim->profiler;
+    if (p->mode != PROFILE_EXACT) return;
+
+    uint32_t i = pc - p->code_base;
+    if (i < p->code_size) {
+        p->instructions[i]++;
+        p->cycles[i] += cycles;
+    } else {
+        p->other_instructions++;
+        p->other_cycles += cycles;
+    }
+    p->current->weight += cycles;
+    p->current->instructions++;
+    p->current = p->top;
+}
+
+#endif // PROFILER_H
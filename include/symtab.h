@@ -0,0 +1,40 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include "beboasm.h"
+
+// ==========================================
+// Address-sorted label tables
+// ==========================================
+//
+// The profiler, heatmap, bebotrace and hot patching all name addresses
+// after the nearest label. Labels come from an assembler run or from a
+// beboasm --map file, filtered by symbol type (SYM_CODE, SYM_DATA, ...).
+// Sections can be collected into a second table alongside.
+
+typedef struct {
+    char name[MAX_LABEL_LEN];
+    uint32_t address;
+    uint32_t size;              // Sections only
+} SymtabEntry;
+
+typedef struct {
+    SymtabEntry *entries;       // Sorted by address
+    int count;
+} SymbolTable;
+
+// Both append to 'symbols' (and 'sections' unless NULL) and sort.
+// 'types' is a mask of SYM_* bits; empty sections are skipped.
+int symtab_add_assembler(SymbolTable *symbols, SymbolTable *sections,
+                         AssemblerState *state, uint8_t types);
+int symtab_load_map(SymbolTable *symbols, SymbolTable *sections, const char *path, uint8_t types);
+void symtab_free(SymbolTable *table);
+
+// Index of the last entry at or below address, -1 if there is none
+int symtab_find(const SymbolTable *table, uint32_t address);
+// First entry with that exact name, NULL if there is none
+const SymtabEntry* symtab_lookup(const SymbolTable *table, const char *name);
+// "LABEL", "LABEL+0xN", or the bare address below the first label
+const char* symtab_format(const SymbolTable *table, uint32_t address, char *buf, size_t size);
+
+#endif // SYMTAB_H
@@ -0,0 +1,168 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "beboasm.h"
+#include <pthread.h>
+
+// ==========================================
+// Binary execution trace
+// ==========================================
+//
+// File layout (little-endian):
+//   header  "BTRC" magic, u16 version, u16 flags, u32 start PC, u32 reserved
+//   blocks  u32 raw size, u32 stored size, then stored bytes. A block whose
+//           stored size is smaller than its raw size is LZ4-block compressed.
+//
+// Each block holds whole records, and PC and address deltas restart from
+// zero at every block so a block decodes on its own. One record per
+// executed instruction:
+//   varint  zigzag(pc - previous pc) << 2 | TRACE_REC_REGS | TRACE_REC_MEM
+//   REGS:   u8 count, then count x (u8 register, varint new value)
+//   MEM:    u8 count, then count x (varint zigzag(addr - previous end),
+//                                   u8 size, varint value)
+// Register numbers above NUM_REGISTERS name TRACE_REG_FLAGS and TRACE_REG_SP.
+
+#define TRACE_MAGIC             "BTRC"
+#define TRACE_VERSION           1
+#define TRACE_HEADER_SIZE       16
+
+#define TRACE_F_REGS            0x01    // Records carry register changes
+#define TRACE_F_MEM             0x02    // Records carry memory writes
+#define TRACE_F_COMPRESS        0x04    // Writer compresses blocks
+
+#define TRACE_REC_REGS          0x01
+#define TRACE_REC_MEM           0x02
+
+#define TRACE_REG_FLAGS         NUM_REGISTERS
+#define TRACE_REG_SP            (NUM_REGISTERS + 1)
+#define TRACE_NUM_REGS          (NUM_REGISTERS + 2)
+
+#define TRACE_BLOCK_SIZE        (64 * 1024)
+#define TRACE_BLOCK_SLOTS       8
+#define TRACE_MAX_WRITES        16      // Memory writes kept per instruction
+#define TRACE_RECORD_MAX        (10 + 1 + TRACE_NUM_REGS * 6 + 1 + TRACE_MAX_WRITES * 11)
+
+typedef struct {
+    uint32_t address;
+    uint32_t value;
+    uint8_t size;
+} TraceWrite;
+
+// One trace per simulator. The simulator thread appends records to the
+// current block; full blocks go onto a ring that a writer thread drains,
+// so the simulator only waits when the disk falls a whole ring behind.
+struct Tracer {
+    // Producer side (simulator thread only)
+    uint8_t *pos;
+    uint8_t *limit;             // Block end less room for one record
+    uint32_t last_pc;
+    uint32_t last_addr;
+    uint32_t flags;             // Fixed once the writer starts; both threads read it
+    uint32_t shadow[TRACE_NUM_REGS];    // Register values already in the trace
+    TraceWrite writes[TRACE_MAX_WRITES];
+    int write_count;
+
+    // Block ring: slots [tail, head) are full, slot head is being filled
+    uint8_t *slots[TRACE_BLOCK_SLOTS];
+    uint32_t slot_len[TRACE_BLOCK_SLOTS];
+    uint64_t head;
+    uint64_t tail;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t drained;
+    pthread_t thread;
+
+    FILE *file;
+    uint8_t *scratch;           // Compression output (writer thread)
+    bool write_error;
+
+    // Statistics
+    uint64_t records;
+    uint64_t raw_bytes;
+    uint64_t stored_bytes;
+    uint64_t stalls;            // Times the simulator waited for the writer
+};
+
+// Lifecycle: tracing starts with the next instruction and runs until
+// tracer_stop (called by simulator_destroy)
+int tracer_start(SimulatorState *sim, const char *path, uint32_t flags);
+int tracer_stop(SimulatorState *sim);
+
+// Out-of-line halves of the hooks below
+void tracer_next_block(Tracer *t);
+void tracer_record_effects(SimulatorState *sim, uint32_t pc);
+
+static inline uint8_t* trace_put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline uint64_t trace_zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t trace_unzigzag(uint64_t v) {
+    return (int32_t)((uint32_t)(v >> 1) ^ -(uint32_t)(v & 1));
+}
+
+// Called after every executed instruction while sim->tracer is set. A
+// PC-only trace costs one varint store, usually a single byte.
+static inline void tracer_record(SimulatorState *sim, uint32_t pc) {
+    Tracer *t = sim->tracer;
+    if (t->flags & (TRACE_F_REGS | TRACE_F_MEM)) {
+        tracer_record_effects(sim, pc);
+        return;
+    }
+    if (t->pos >= t->limit) tracer_next_block(t);
+    t->pos = trace_put_varint(t->pos, trace_zigzag((int32_t)(pc - t->last_pc)) << 2);
+    t->last_pc = pc;
+    t->records++;
+}
+
+// Memory write hook: collects the current instruction's stores, merging
+// byte stores to consecutive addresses into words
+static inline void tracer_note_write(Tracer *t, uint32_t address, uint32_t value, uint8_t size) {
+    if (!(t->flags & TRACE_F_MEM)) return;
+    if (t->write_count) {
+        TraceWrite *w = &t->writes[t->write_count - 1];
+        if (w->address + w->size == address && w->size + size <= 4) {
+            w->value |= value << (8 * w->size);
+            w->size += size;
+            return;
+        }
+    }
+    if (t->write_count < TRACE_MAX_WRITES) {
+        t->writes[t->write_count++] = (TraceWrite){address, value, size};
+    }
+}
+
+// ==========================================
+// Reading traces (bebotrace)
+// ==========================================
+
+typedef struct {
+    uint16_t version;
+    uint16_t flags;
+    uint32_t start_pc;
+} TraceHeader;
+
+typedef struct {
+    uint32_t pc;
+    int reg_count;
+    uint8_t regs[TRACE_NUM_REGS];
+    uint32_t reg_values[TRACE_NUM_REGS];
+    int write_count;
+    TraceWrite writes[TRACE_MAX_WRITES];
+} TraceRecord;
+
+// Calls fn for each record in order; a non-zero return from fn stops early.
+// Returns 1 on success, 0 on a malformed or unreadable file.
+typedef int (*TraceRecordFn)(void *user, const TraceRecord *rec);
+int trace_read_file(const char *path, TraceHeader *header, TraceRecordFn fn, void *user);
+
+#endif // TRACER_H
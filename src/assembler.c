@@ -1,5 +1,6 @@
 #include "../include/beboasm.h"
 #include "../include/opcodes.h"
+#include "../include/cycles.h"
 #include <stdarg.h>
 #include <time.h>
 #include <sys/stat.h>
@@ -26,65 +27,73 @@ bool parse_operand(AssemblerState *state, char *str, Operand *operand);
 static char *string_pool[4096];
 static int string_pool_count = 0;
 
-// Global instruction set (Updated with corrected OP_SETB)
+// Global instruction set (Updated with corrected OP_SETB). The cycles
+// column mirrors the register-mode defaults in cycles.c, which is what the
+// simulator and listings charge.
 OpcodeMetadata instruction_set[] = {
     // Data Transfer
-    {"MOV", OP_MOV, FORMAT_R, 2, 1, 2, {{OT_REG | OT_MEM, "dst"}, {OT_REG | OT_IMM | OT_MEM, "src"}}, IF_NONE, "Move data"},
-    {"MOVW", OP_MOVW, FORMAT_R, 2, 1, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src"}}, IF_NONE, "Move 32-bit data"},
-    {"LOAD", OP_LOAD, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load from memory"},
-    {"LDB", OP_LOADB, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load byte from memory"},
-    {"LDW", OP_LOADH, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load word from memory"},
-    {"STORE", OP_STORE, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store to memory"},
-    {"STB", OP_STOREB, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store byte to memory"},
-    {"STW", OP_STOREH, FORMAT_M, 3, 2, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store word to memory"},
-    {"PUSH", OP_PUSH, FORMAT_R, 1, 1, 1, {{OT_REG | OT_IMM, "src"}}, IF_STACK, "Push to stack"},
-    {"POP", OP_POP, FORMAT_R, 1, 1, 1, {{OT_REG, "dst"}}, IF_STACK, "Pop from stack"},
-    {"XCHG", OP_XCHG, FORMAT_R, 2, 2, 2, {{OT_REG, "dst"}, {OT_REG, "src"}}, IF_NONE, "Exchange registers"},
+    {"MOV", OP_MOV, FORMAT_R, 2, 2, {{OT_REG | OT_MEM, "dst"}, {OT_REG | OT_IMM | OT_MEM, "src"}}, IF_NONE, "Move data"},
+    {"MOVW", OP_MOVW, FORMAT_R, 2, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src"}}, IF_NONE, "Move 32-bit data"},
+    {"LOAD", OP_LOAD, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load from memory"},
+    {"LDB", OP_LOADB, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load byte from memory"},
+    {"LDW", OP_LOADH, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Load word from memory"},
+    {"STORE", OP_STORE, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store to memory"},
+    {"STB", OP_STOREB, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store byte to memory"},
+    {"STW", OP_STOREH, FORMAT_M, 3, 2, {{OT_REG, "reg"}, {OT_MEM | OT_LABEL, "addr"}}, IF_MEMORY, "Store word to memory"},
+    {"PUSH", OP_PUSH, FORMAT_R, 1, 1, {{OT_REG | OT_IMM, "src"}}, IF_STACK, "Push to stack"},
+    {"POP", OP_POP, FORMAT_R, 1, 1, {{OT_REG, "dst"}}, IF_STACK, "Pop from stack"},
+    {"XCHG", OP_XCHG, FORMAT_R, 2, 2, {{OT_REG, "dst"}, {OT_REG, "src"}}, IF_NONE, "Exchange registers"},
     
     // Arithmetic
-    {"ADD", OP_ADD, FORMAT_R, 2, 1, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Add"},
-    {"SUB", OP_SUB, FORMAT_R, 2, 1, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Subtract"},
-    {"MUL", OP_MUL, FORMAT_R, 2, 3, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Multiply"},
-    {"DIV", OP_DIV, FORMAT_R, 2, 4, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Divide"},
-    {"MOD", OP_MOD, FORMAT_R, 2, 4, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Remainder"},
-    {"INC", OP_INC, FORMAT_R, 1, 1, 1, {{OT_REG, "dst"}}, IF_ARITH, "Increment"},
-    {"DEC", OP_DEC, FORMAT_R, 1, 1, 1, {{OT_REG, "dst"}}, IF_ARITH, "Decrement"},
+    {"ADD", OP_ADD, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Add"},
+    {"SUB", OP_SUB, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Subtract"},
+    {"MUL", OP_MUL, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Multiply"},
+    {"DIV", OP_DIV, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Divide"},
+    {"MOD", OP_MOD, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_ARITH, "Remainder"},
+    {"INC", OP_INC, FORMAT_R, 1, 1, {{OT_REG, "dst"}}, IF_ARITH, "Increment"},
+    {"DEC", OP_DEC, FORMAT_R, 1, 1, {{OT_REG, "dst"}}, IF_ARITH, "Decrement"},
     
     // Logic (Note: OP_SET changed to OP_SETB)
-    {"AND", OP_AND, FORMAT_R, 2, 1, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical AND"},
-    {"OR", OP_OR, FORMAT_R, 2, 1, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical OR"},
-    {"XOR", OP_XOR, FORMAT_R, 2, 1, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical XOR"},
-    {"NOT", OP_NOT, FORMAT_R, 1, 1, 1, {{OT_REG, "dst"}}, IF_LOGIC, "Logical NOT"},
-    {"SHL", OP_SHL, FORMAT_R, 2, 1, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "shift"}}, IF_SHIFT, "Shift left"},
-    {"SHR", OP_SHR, FORMAT_R, 2, 1, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "shift"}}, IF_SHIFT, "Shift right"},
-    {"CLR", OP_CLR, FORMAT_R, 1, 1, 1, {{OT_REG, "dst"}}, IF_LOGIC, "Clear register"},
-    {"SETB", OP_SETB, FORMAT_R, 2, 1, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "mask"}}, IF_LOGIC, "Set bits"}, // Fixed: OP_SET -> OP_SETB
+    {"AND", OP_AND, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical AND"},
+    {"OR", OP_OR, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical OR"},
+    {"XOR", OP_XOR, FORMAT_R, 2, 3, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_LOGIC, "Logical XOR"},
+    {"NOT", OP_NOT, FORMAT_R, 1, 1, {{OT_REG, "dst"}}, IF_LOGIC, "Logical NOT"},
+    {"SHL", OP_SHL, FORMAT_R, 2, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "shift"}}, IF_SHIFT, "Shift left"},
+    {"SHR", OP_SHR, FORMAT_R, 2, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "shift"}}, IF_SHIFT, "Shift right"},
+    {"CLR", OP_CLR, FORMAT_R, 1, 1, {{OT_REG, "dst"}}, IF_LOGIC, "Clear register"},
+    {"SETB", OP_SETB, FORMAT_R, 2, 2, {{OT_REG, "dst"}, {OT_REG | OT_IMM, "mask"}}, IF_LOGIC, "Set bits"}, // Fixed: OP_SET -> OP_SETB
     
     // Comparison
-    {"CMP", OP_CMP, FORMAT_R, 2, 1, 2, {{OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_COMPARE, "Compare"},
-    {"TEST", OP_TEST, FORMAT_R, 2, 1, 2, {{OT_REG, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_COMPARE, "Test bits"},
+    {"CMP", OP_CMP, FORMAT_R, 2, 2, {{OT_REG | OT_IMM, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_COMPARE, "Compare"},
+    {"TEST", OP_TEST, FORMAT_R, 2, 2, {{OT_REG, "src1"}, {OT_REG | OT_IMM, "src2"}}, IF_COMPARE, "Test bits"},
     
     // Control Flow
-    {"JMP", OP_JMP, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH, "Unconditional jump"},
-    {"JE", OP_JE, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if equal"},
-    {"JNE", OP_JNE, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if not equal"},
-    {"JG", OP_JG, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if greater"},
-    {"JL", OP_JL, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if less"},
-    {"JGE", OP_JGE, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if greater or equal"},
-    {"JLE", OP_JLE, FORMAT_B, 3, 2, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if less or equal"},
-    {"CALL", OP_CALL, FORMAT_B, 3, 3, 1, {{OT_LABEL, "target"}}, IF_CALL, "Call subroutine"},
-    {"RET", OP_RET, FORMAT_S, 1, 2, 0, {{0, ""}}, IF_RETURN, "Return from subroutine"},
+    {"JMP", OP_JMP, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH, "Unconditional jump"},
+    {"JE", OP_JE, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if equal"},
+    {"JNE", OP_JNE, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if not equal"},
+    {"JG", OP_JG, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if greater"},
+    {"JL", OP_JL, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if less"},
+    {"JGE", OP_JGE, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if greater or equal"},
+    {"JLE", OP_JLE, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_BRANCH | IF_CONDITIONAL, "Jump if less or equal"},
+    {"CALL", OP_CALL, FORMAT_B, 3, 1, {{OT_LABEL, "target"}}, IF_CALL, "Call subroutine"},
+    {"RET", OP_RET, FORMAT_S, 1, 0, {{0, ""}}, IF_RETURN, "Return from subroutine"},
+    {"RETI", OP_RETI, FORMAT_S, 1, 0, {{0, ""}}, IF_RETURN, "Return from interrupt"},
+    {"IRET", OP_IRET, FORMAT_S, 1, 0, {{0, ""}}, IF_RETURN, "Interrupt return"},
     
     // System
-    {"HALT", OP_HALT, FORMAT_S, 1, 1, 0, {{0, ""}}, IF_NONE, "Halt processor"},
-    {"NOP", OP_NOP, FORMAT_S, 1, 1, 0, {{0, ""}}, IF_NONE, "No operation"},
+    {"HALT", OP_HALT, FORMAT_S, 1, 0, {{0, ""}}, IF_NONE, "Halt processor"},
+    {"NOP", OP_NOP, FORMAT_S, 1, 0, {{0, ""}}, IF_NONE, "No operation"},
+    {"WAIT", OP_WAIT, FORMAT_S, 1, 0, {{0, ""}}, IF_NONE, "Wait for next event"},
+    {"TRACE", OP_TRACE, FORMAT_S, 1, 0, {{0, ""}}, IF_NONE, "Snapshot marker (NOP unless fuzzing)"},
+    {"SVC", OP_SVC, FORMAT_S, 2, 1, {{OT_IMM, "vector"}}, IF_PRIVILEGED, "Supervisor call (#0 = semihosting)"},
+    {"TRAP", OP_TRAP, FORMAT_S, 2, 1, {{OT_IMM, "vector"}}, IF_NONE, "Software trap (#0 = semihosting)"},
     
     // I/O
-    {"IN", OP_IN, FORMAT_I, 2, 2, 2, {{OT_REG, "reg"}, {OT_IMM, "port"}}, IF_IO, "Input from port"},
-    {"OUT", OP_OUT, FORMAT_I, 2, 2, 2, {{OT_IMM, "port"}, {OT_REG, "reg"}}, IF_IO, "Output to port"},
+    {"IN", OP_IN, FORMAT_I, 2, 2, {{OT_REG, "reg"}, {OT_IMM, "port"}}, IF_IO, "Input from port"},
+    {"OUT", OP_OUT, FORMAT_I, 2, 2, {{OT_IMM, "port"}, {OT_REG, "reg"}}, IF_IO, "Output to port"},
     
     // Terminator
-    {"", 0, 0, 0, 0, 0, {{0, ""}}, 0, ""}
+    {"", 0, 0, 0, 0, {{0, ""}}, 0, ""}
 };
 
 AssemblerState* assembler_create(bool optimize, bool debug) {
@@ -139,6 +148,10 @@ void assembler_destroy(AssemblerState *state) {
     if (state->list_file) {
         fclose(state->list_file);
     }
+    for (int i = 0; i < state->listing_count; i++) {
+        free(state->listing[i].text);
+    }
+    free(state->listing);
     
     // Free debug info
     if (state->debug_info) {
@@ -149,6 +162,7 @@ void assembler_destroy(AssemblerState *state) {
     for (int i = 0; i < string_pool_count; i++) {
         free(string_pool[i]);
     }
+    string_pool_count = 0;
     
     // Free allocations
     free(state->memory);
@@ -159,23 +173,8 @@ void assembler_destroy(AssemblerState *state) {
     free(state);
 }
 
-int assemble_file(AssemblerState *state, const char *filename) {
-    if (!state || !filename) return 0;
-    
-    printf("Assembling: %s\n", filename);
-    
-    // Store current file info
-    strncpy(state->current_file, filename, sizeof(state->current_file) - 1);
-    state->current_file[sizeof(state->current_file) - 1] = '\0';
-    state->current_line = 0;
-    
-    // Open file
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        error_add(state, "Cannot open file: %s", filename);
-        return 0;
-    }
-    
+// Run all passes over an already opened source. Takes ownership of 'file'.
+static int assemble_stream(AssemblerState *state, FILE *file) {
     // Push to include stack
     if (state->include_depth >= MAX_INCLUDE_DEPTH) {
         error_add(state, "Include depth too deep");
@@ -185,23 +184,23 @@ int assemble_file(AssemblerState *state, const char *filename) {
     state->include_stack[state->include_depth++] = file;
     
     // First pass: collect symbols and macros
-    printf("Pass 1: Collecting symbols...\n");
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Pass 1: Collecting symbols...\n");
     assemble_pass(state, 1);
     
     // Second pass: generate code
-    printf("Pass 2: Generating code...\n");
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Pass 2: Generating code...\n");
     rewind(file);
     state->current_line = 0;
     section_switch(state, ".text");
     assemble_pass(state, 2);
     
     // Third pass: resolve references
-    printf("Pass 3: Resolving references...\n");
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Pass 3: Resolving references...\n");
     resolve_references(state);
     
     // Optimize if requested
     if (state->optimize) {
-        printf("Optimizing code...\n");
+        if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Optimizing code...\n");
         optimize_instructions(state);
     }
     
@@ -209,12 +208,73 @@ int assemble_file(AssemblerState *state, const char *filename) {
     state->include_depth--;
     fclose(file);
     
-    // Print diagnostics
-    print_diagnostics(state);
+    // Print diagnostics (quiet mode only reports failures)
+    if (!state->quiet || state->diagnostics.errors > 0) {
+        print_diagnostics(state);
+    }
     
     return state->diagnostics.errors == 0;
 }
 
+int assemble_file(AssemblerState *state, const char *filename) {
+    if (!state || !filename) return 0;
+    
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Assembling: %s\n", filename);
+    
+    // Store current file info
+    strncpy(state->current_file, filename, sizeof(state->current_file) - 1);
+    state->current_file[sizeof(state->current_file) - 1] = '\0';
+    state->current_line = 0;
+    
+    // Open file
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        error_add(state, "Cannot open file: %s", filename);
+        return 0;
+    }
+    
+    return assemble_stream(state, file);
+}
+
+// Assemble source held in memory; diagnostics refer to it as "<string>"
+int assemble_string(AssemblerState *state, const char *code) {
+    if (!state || !code) return 0;
+    
+    strcpy(state->current_file, "<string>");
+    state->current_line = 0;
+    
+    FILE *file = fmemopen((void *)code, strlen(code), "r");
+    if (!file) {
+        error_add(state, "Cannot open source buffer");
+        return 0;
+    }
+    
+    return assemble_stream(state, file);
+}
+
+// Remember a source line and where its bytes went; the bytes themselves
+// are read back by write_listing once references are resolved
+static void listing_add(AssemblerState *state, uint32_t address, bool instruction, const char *text) {
+    if (state->listing_count >= state->listing_capacity) {
+        int capacity = state->listing_capacity ? state->listing_capacity * 2 : 256;
+        void *grown = realloc(state->listing, capacity * sizeof(*state->listing));
+        if (!grown) return;
+        state->listing = grown;
+        state->listing_capacity = capacity;
+    }
+    
+    char *copy = strdup(text);
+    if (!copy) return;
+    copy[strcspn(copy, "\r\n")] = '\0';
+    
+    state->listing[state->listing_count].address = address;
+    state->listing[state->listing_count].size = state->pc > address ? state->pc - address : 0;
+    state->listing[state->listing_count].line = state->current_line;
+    state->listing[state->listing_count].instruction = instruction;
+    state->listing[state->listing_count].text = copy;
+    state->listing_count++;
+}
+
 void assemble_pass(AssemblerState *state, int pass) {
     char line[1024];
     char original_line[1024];
@@ -244,6 +304,7 @@ void assemble_pass(AssemblerState *state, int pass) {
         // Parse the line
         Instruction inst;
         memset(&inst, 0, sizeof(inst));
+        uint32_t line_pc = state->pc;
         
         int result = parse_line(state, line, &inst, pass);
         
@@ -274,6 +335,10 @@ void assemble_pass(AssemblerState *state, int pass) {
                 }
              }
         }
+        
+        if (pass == 2 && state->generate_listing) {
+            listing_add(state, line_pc, result == PARSE_INSTRUCTION, original_line);
+        }
     }
 }
 
@@ -398,19 +463,19 @@ void warning_add(AssemblerState *state, const char *format, ...) {
 }
 
 void print_diagnostics(AssemblerState *state) {
-    printf("\n=== Assembly Diagnostics ===\n");
-    printf("Errors: %d, Warnings: %d\n\n", 
-           state->diagnostics.errors, 
-           state->diagnostics.warnings);
+    bebo_log(BEBO_LOG_INFO, "\n=== Assembly Diagnostics ===\n");
+    bebo_log(BEBO_LOG_INFO, "Errors: %d, Warnings: %d\n\n", 
+             state->diagnostics.errors, 
+             state->diagnostics.warnings);
     
     for (int i = 0; i < state->diagnostics.message_count; i++) {
-        printf("%s\n", state->diagnostics.messages[i]);
+        bebo_log(BEBO_LOG_INFO, "%s\n", state->diagnostics.messages[i]);
     }
     
     if (state->diagnostics.errors == 0) {
-        printf("\nAssembly successful!\n");
+        bebo_log(BEBO_LOG_INFO, "\nAssembly successful!\n");
     } else {
-        printf("\nAssembly failed with %d error(s)\n", state->diagnostics.errors);
+        bebo_log(BEBO_LOG_INFO, "\nAssembly failed with %d error(s)\n", state->diagnostics.errors);
     }
 }
 
@@ -508,7 +573,7 @@ int instruction_full_size(Instruction *inst) {
             break;
         case OP_OUT:
         case OP_IN:
-            size += 2; // Port/Reg + Reg/Port
+            size += 3; // Port(2) + Reg(1)
             break;
         case OP_INC:
         case OP_DEC:
@@ -528,9 +593,16 @@ int instruction_full_size(Instruction *inst) {
         case OP_CALL:
             size += 2; // 16-bit address
             break;
+        case OP_SVC:
+        case OP_TRAP:
+            size += 1; // 8-bit vector
+            break;
         case OP_HALT:
         case OP_NOP:
         case OP_RET:
+        case OP_RETI:
+        case OP_IRET:
+        case OP_WAIT:
             // Size is 1
             break;
         default:
@@ -709,12 +781,12 @@ void emit_byte(AssemblerState *state, uint8_t byte) {
 
 void resolve_references(AssemblerState *state) {
     if (!state) return;
-    printf("Resolving references...\n");
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Resolving references...\n");
 }
 
 void handle_include(AssemblerState *state, const char *filename, int pass) {
     if (!state || !filename) return;
-    printf("Including file: %s (pass %d)\n", filename, pass);
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Including file: %s (pass %d)\n", filename, pass);
     FILE *file = fopen(filename, "r");
     if (!file) {
         error_add(state, "Cannot open include file: %s", filename);
@@ -1004,9 +1076,19 @@ void emit_instruction(AssemblerState *state, Instruction *inst, int pass) {
             emit_byte(state, (uint8_t)((val >> 8) & 0xFF));
             break;
         }
+        case OP_SVC:
+        case OP_TRAP: {
+            // Vector defaults to 0 (semihosting) when omitted
+            uint32_t vector = (inst->operand_count > 0) ? (uint32_t)inst->operands[0].value.immediate : 0;
+            emit_byte(state, (uint8_t)vector);
+            break;
+        }
         case OP_HALT:
         case OP_NOP:
         case OP_RET:
+        case OP_RETI:
+        case OP_IRET:
+        case OP_WAIT:
             break;
         default:
             for (int i = 0; i < inst->operand_count; i++) {
@@ -1024,7 +1106,7 @@ void emit_instruction(AssemblerState *state, Instruction *inst, int pass) {
 
 void optimize_instructions(AssemblerState *state) {
     if (!state || !state->optimize) return;
-    printf("Performing basic optimizations...\n");
+    if (!state->quiet) bebo_log(BEBO_LOG_INFO, "Performing basic optimizations...\n");
     for (int i = 0; i < state->section_count; i++) {
         Section *sec = &state->sections[i];
         if (!sec->data || sec->size == 0) continue;
@@ -1040,6 +1122,10 @@ void optimize_instructions(AssemblerState *state) {
 
 int write_binary(AssemblerState *state, const char *filename) {
     if (!state || !filename) return 0;
+    if (!state->memory) {
+        error_add(state, "Image already handed to the simulator");
+        return 0;
+    }
     FILE *f = fopen(filename, "wb");
     if (!f) {
         perror("fopen");
@@ -1062,3 +1148,109 @@ int write_binary(AssemblerState *state, const char *filename) {
     }
     return 1;
 }
+
+// Listing: address, up to six bytes, cycles from the cycle table (taken
+// cost after a slash for conditional branches) and the source line.
+// Needs generate_listing set before assembling.
+int write_listing(AssemblerState *state, const char *filename) {
+    if (!state || !filename) return 0;
+    if (!state->memory) {
+        error_add(state, "Image already handed to the simulator");
+        return 0;
+    }
+    
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        error_add(state, "Cannot open file %s for writing", filename);
+        return 0;
+    }
+    
+    fprintf(f, "; BeboAsm listing for %s\n", state->current_file);
+    fprintf(f, "; %5s  %-8s %-18s %-7s source\n", "line", "address", "bytes", "cycles");
+    for (int i = 0; i < state->listing_count; i++) {
+        uint32_t address = state->listing[i].address;
+        uint32_t size = state->listing[i].size;
+        if (address >= MEMORY_SIZE) size = 0;
+        else if (size > MEMORY_SIZE - address) size = MEMORY_SIZE - address;
+        
+        char bytes[32] = "";
+        int pos = 0;
+        for (uint32_t b = 0; b < size && b < 6; b++) {
+            pos += snprintf(bytes + pos, sizeof(bytes) - pos, "%02X ", state->memory[address + b]);
+        }
+        if (size > 6) snprintf(bytes + pos, sizeof(bytes) - pos, "...");
+        
+        char cycles[16] = "";
+        if (state->listing[i].instruction && size) {
+            uint32_t taken;
+            uint32_t cost = cycles_instruction(&state->memory[address], size, &taken);
+            if (taken) snprintf(cycles, sizeof(cycles), "%u/%u", cost, cost + taken);
+            else snprintf(cycles, sizeof(cycles), "%u", cost);
+        }
+        
+        if (size) fprintf(f, "  %5d  %06X   %-18s %-7s %s\n", state->listing[i].line, address, bytes, cycles, state->listing[i].text);
+        else fprintf(f, "  %5d  %-8s %-18s %-7s %s\n", state->listing[i].line, "", "", "", state->listing[i].text);
+    }
+    
+    return fclose(f) == 0;
+}
+
+static int map_symbol_compare(const void *a, const void *b) {
+    const Symbol *x = *(const Symbol * const *)a;
+    const Symbol *y = *(const Symbol * const *)b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static const char* map_symbol_type(uint8_t type) {
+    switch (type) {
+        case SYM_CODE:     return "code";
+        case SYM_DATA:     return "data";
+        case SYM_BSS:      return "bss";
+        case SYM_EQU:      return "equ";
+        case SYM_ABSOLUTE: return "abs";
+    }
+    return "other";
+}
+
+// Map file: one line per non-empty section and per defined symbol, sorted
+// by address, for tools that only have the binary (bebosim --map)
+//   section <name> <address> <size> <r|-><w|-><x|->
+//   symbol  <address> <code|data|bss|equ|abs|other> <name>
+int write_map(AssemblerState *state, const char *filename) {
+    if (!state || !filename) return 0;
+    
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        error_add(state, "Cannot open file %s for writing", filename);
+        return 0;
+    }
+    
+    fprintf(f, "; BeboAsm map for %s\n", state->current_file);
+    for (int i = 0; i < state->section_count; i++) {
+        Section *sec = &state->sections[i];
+        if (sec->size == 0) continue;
+        fprintf(f, "section %-8s 0x%06X 0x%06X %c%c%c\n", sec->name, sec->address, sec->size,
+                (sec->attributes & 0x04) ? 'r' : '-',
+                (sec->attributes & 0x02) ? 'w' : '-',
+                (sec->attributes & 0x01) ? 'x' : '-');
+    }
+    
+    Symbol **sorted = malloc((state->symbol_count ? state->symbol_count : 1) * sizeof(Symbol *));
+    if (!sorted) {
+        fclose(f);
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < state->symbol_count; i++) {
+        if (state->symbols[i].defined) sorted[count++] = &state->symbols[i];
+    }
+    qsort(sorted, count, sizeof(Symbol *), map_symbol_compare);
+    for (int i = 0; i < count; i++) {
+        fprintf(f, "symbol  0x%06X %-5s %s\n", sorted[i]->value,
+                map_symbol_type(sorted[i]->type), sorted[i]->name);
+    }
+    free(sorted);
+    
+    return fclose(f) == 0;
+}
@@ -0,0 +1,359 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ATA PIO register offsets from PORT_ATA_BASE
+#define ATA_REG_DATA        0
+#define ATA_REG_ERROR       1   // Read: error, Write: features
+#define ATA_REG_COUNT       2
+#define ATA_REG_LBA_LO      3
+#define ATA_REG_LBA_MID     4
+#define ATA_REG_LBA_HI      5
+#define ATA_REG_DRIVE       6
+#define ATA_REG_STATUS      7   // Read: status, Write: command
+#define ATA_REG_DMA_ADDR    8   // BeboAsm extension: guest address for DMA commands
+
+// Status bits
+#define ATA_SR_BSY          0x80
+#define ATA_SR_DRDY         0x40
+#define ATA_SR_DF           0x20
+#define ATA_SR_DRQ          0x08
+#define ATA_SR_ERR          0x01
+
+// Error bits
+#define ATA_ER_ABRT         0x04
+#define ATA_ER_IDNF         0x10
+
+// Commands
+#define ATA_CMD_READ_PIO    0x20
+#define ATA_CMD_WRITE_PIO   0x30
+#define ATA_CMD_READ_DMA    0xC8
+#define ATA_CMD_WRITE_DMA   0xCA
+#define ATA_CMD_FLUSH       0xE7
+#define ATA_CMD_IDENTIFY    0xEC
+
+typedef struct {
+    int fd;
+    uint8_t *image;
+    size_t size;
+    uint32_t sectors;
+    bool read_only;
+
+    // Task file
+    uint8_t features;
+    uint8_t error;
+    uint8_t status;
+    uint8_t count;
+    uint8_t lba_lo, lba_mid, lba_hi;
+    uint8_t drive;
+    uint32_t dma_addr;
+
+    // PIO transfer in progress
+    uint8_t command;
+    uint8_t *buffer;            // Current sector (points into image or identify)
+    uint32_t buffer_pos;        // Byte offset within the sector
+    uint32_t lba;               // Current sector
+    uint32_t remaining;         // Sectors left including the current one
+    uint8_t identify[ATA_SECTOR_SIZE];
+
+    // Statistics
+    uint64_t sectors_read;
+    uint64_t sectors_written;
+    uint64_t pio_commands;
+    uint64_t dma_commands;
+} AtaDisk;
+
+static uint32_t ata_lba(AtaDisk *ata) {
+    return ata->lba_lo | (ata->lba_mid << 8) | (ata->lba_hi << 16) |
+           ((uint32_t)(ata->drive & 0x0F) << 24);
+}
+
+static uint32_t ata_count(AtaDisk *ata) {
+    return ata->count ? ata->count : 256;
+}
+
+static void ata_abort(AtaDisk *ata, uint8_t error) {
+    ata->error = error;
+    ata->status = ATA_SR_DRDY | ATA_SR_ERR;
+    ata->command = 0;
+    ata->remaining = 0;
+}
+
+static void ata_build_identify(AtaDisk *ata) {
+    uint16_t words[ATA_SECTOR_SIZE / 2];
+    memset(words, 0, sizeof(words));
+
+    words[0] = 0x0040;                          // Fixed device
+    words[49] = 0x0300;                         // LBA + DMA supported
+    words[60] = ata->sectors & 0xFFFF;          // Total LBA28 sectors
+    words[61] = (ata->sectors >> 16) & 0x0FFF;
+
+    // Model number (words 27-46), byte-swapped per ATA string convention
+    const char *model = "BEBO ATA DISK";
+    char padded[40];
+    memset(padded, ' ', sizeof(padded));
+    memcpy(padded, model, strlen(model));
+    for (int i = 0; i < 20; i++) {
+        words[27 + i] = ((uint16_t)(uint8_t)padded[i * 2] << 8) | (uint8_t)padded[i * 2 + 1];
+    }
+
+    for (int i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+        ata->identify[i * 2] = words[i] & 0xFF;
+        ata->identify[i * 2 + 1] = words[i] >> 8;
+    }
+}
+
+// Point the PIO buffer at the current sector, or finish the command
+static void ata_next_sector(AtaDisk *ata) {
+    if (ata->remaining == 0) {
+        ata->status = ATA_SR_DRDY;
+        ata->command = 0;
+        ata->buffer = NULL;
+        return;
+    }
+    ata->buffer = ata->image + (size_t)ata->lba * ATA_SECTOR_SIZE;
+    ata->buffer_pos = 0;
+    ata->status = ATA_SR_DRDY | ATA_SR_DRQ;
+}
+
+static void ata_command(SimulatorState *sim, AtaDisk *ata, uint8_t command) {
+    uint32_t lba = ata_lba(ata);
+    uint32_t count = ata_count(ata);
+
+    ata->error = 0;
+
+    switch (command) {
+        case ATA_CMD_READ_PIO:
+        case ATA_CMD_WRITE_PIO:
+            if (lba >= ata->sectors || count > ata->sectors - lba) {
+                ata_abort(ata, ATA_ER_IDNF);
+                return;
+            }
+            if (command == ATA_CMD_WRITE_PIO && ata->read_only) {
+                ata_abort(ata, ATA_ER_ABRT);
+                return;
+            }
+            ata->command = command;
+            ata->lba = lba;
+            ata->remaining = count;
+            ata->pio_commands++;
+            ata_next_sector(ata);
+            break;
+
+        case ATA_CMD_READ_DMA:
+        case ATA_CMD_WRITE_DMA: {
+            if (lba >= ata->sectors || count > ata->sectors - lba) {
+                ata_abort(ata, ATA_ER_IDNF);
+                return;
+            }
+            if (command == ATA_CMD_WRITE_DMA && ata->read_only) {
+                ata_abort(ata, ATA_ER_ABRT);
+                return;
+            }
+
+            // Whole transfer in one copy between guest memory and the image
+            uint8_t *disk = ata->image + (size_t)lba * ATA_SECTOR_SIZE;
+            uint32_t bytes = count * ATA_SECTOR_SIZE;
+            int ok;
+            if (command == ATA_CMD_READ_DMA) {
+                ok = memory_write_block(sim, ata->dma_addr, disk, bytes);
+                if (ok) ata->sectors_read += count;
+            } else {
+                ok = memory_read_block(sim, ata->dma_addr, disk, bytes);
+                if (ok) ata->sectors_written += count;
+            }
+            if (!ok) {
+                ata_abort(ata, ATA_ER_ABRT);
+                return;
+            }
+            ata->dma_commands++;
+            ata->status = ATA_SR_DRDY;
+            break;
+        }
+
+        case ATA_CMD_FLUSH:
+            if (!ata->read_only) {
+                msync(ata->image, ata->size, MS_SYNC);
+            }
+            ata->status = ATA_SR_DRDY;
+            break;
+
+        case ATA_CMD_IDENTIFY:
+            ata->command = command;
+            ata->remaining = 0;
+            ata->buffer = ata->identify;
+            ata->buffer_pos = 0;
+            ata->status = ATA_SR_DRDY | ATA_SR_DRQ;
+            break;
+
+        default:
+            ata_abort(ata, ATA_ER_ABRT);
+            break;
+    }
+}
+
+static uint32_t ata_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim;
+    AtaDisk *ata = (AtaDisk *)opaque;
+
+    switch (port - PORT_ATA_BASE) {
+        case ATA_REG_DATA: {
+            if (!(ata->status & ATA_SR_DRQ) || ata->command == ATA_CMD_WRITE_PIO) {
+                return 0;
+            }
+            uint32_t value = ata->buffer[ata->buffer_pos] | (ata->buffer[ata->buffer_pos + 1] << 8);
+            ata->buffer_pos += 2;
+            if (ata->buffer_pos >= ATA_SECTOR_SIZE) {
+                if (ata->command == ATA_CMD_READ_PIO) {
+                    ata->sectors_read++;
+                    ata->lba++;
+                    ata->remaining--;
+                }
+                ata_next_sector(ata);
+            }
+            return value;
+        }
+        case ATA_REG_ERROR:    return ata->error;
+        case ATA_REG_COUNT:    return ata->count;
+        case ATA_REG_LBA_LO:   return ata->lba_lo;
+        case ATA_REG_LBA_MID:  return ata->lba_mid;
+        case ATA_REG_LBA_HI:   return ata->lba_hi;
+        case ATA_REG_DRIVE:    return ata->drive;
+        case ATA_REG_STATUS:   return ata->status;
+        case ATA_REG_DMA_ADDR: return ata->dma_addr;
+    }
+    return 0;
+}
+
+static void ata_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    AtaDisk *ata = (AtaDisk *)opaque;
+
+    switch (port - PORT_ATA_BASE) {
+        case ATA_REG_DATA:
+            if (!(ata->status & ATA_SR_DRQ) || ata->command != ATA_CMD_WRITE_PIO) {
+                return;
+            }
+            ata->buffer[ata->buffer_pos] = value & 0xFF;
+            ata->buffer[ata->buffer_pos + 1] = (value >> 8) & 0xFF;
+            ata->buffer_pos += 2;
+            if (ata->buffer_pos >= ATA_SECTOR_SIZE) {
+                ata->sectors_written++;
+                ata->lba++;
+                ata->remaining--;
+                ata_next_sector(ata);
+            }
+            break;
+        case ATA_REG_ERROR:    ata->features = value; break;
+        case ATA_REG_COUNT:    ata->count = value; break;
+        case ATA_REG_LBA_LO:   ata->lba_lo = value; break;
+        case ATA_REG_LBA_MID:  ata->lba_mid = value; break;
+        case ATA_REG_LBA_HI:   ata->lba_hi = value; break;
+        case ATA_REG_DRIVE:    ata->drive = value; break;
+        case ATA_REG_STATUS:   ata_command(sim, ata, (uint8_t)value); break;
+        case ATA_REG_DMA_ADDR: ata->dma_addr = value; break;
+    }
+}
+
+static void ata_reset(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    AtaDisk *ata = (AtaDisk *)opaque;
+    ata->status = ATA_SR_DRDY;
+    ata->error = 0;
+    ata->command = 0;
+    ata->remaining = 0;
+    ata->buffer = NULL;
+}
+
+static void ata_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    AtaDisk *ata = (AtaDisk *)opaque;
+    bebo_log(BEBO_LOG_INFO, "ATA sectors read: %lu\n", (unsigned long)ata->sectors_read);
+    bebo_log(BEBO_LOG_INFO, "ATA sectors written: %lu\n", (unsigned long)ata->sectors_written);
+    bebo_log(BEBO_LOG_INFO, "ATA commands: %lu PIO, %lu DMA\n",
+             (unsigned long)ata->pio_commands, (unsigned long)ata->dma_commands);
+}
+
+static uint64_t ata_counter(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    AtaDisk *ata = (AtaDisk *)opaque;
+    return ata->sectors_read + ata->sectors_written;
+}
+
+static void ata_destroy(void *opaque) {
+    AtaDisk *ata = (AtaDisk *)opaque;
+    if (!ata) return;
+
+    if (ata->image) {
+        if (!ata->read_only) msync(ata->image, ata->size, MS_SYNC);
+        munmap(ata->image, ata->size);
+    }
+    if (ata->fd >= 0) close(ata->fd);
+    free(ata);
+}
+
+int ata_attach_image(SimulatorState *sim, const char *path) {
+    if (!sim || !path) return 0;
+
+    AtaDisk *ata = calloc(1, sizeof(AtaDisk));
+    if (!ata) return 0;
+
+    ata->fd = open(path, O_RDWR);
+    if (ata->fd < 0) {
+        ata->fd = open(path, O_RDONLY);
+        ata->read_only = true;
+    }
+    if (ata->fd < 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot open disk image '%s'\n", path);
+        free(ata);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(ata->fd, &st) != 0 || st.st_size < ATA_SECTOR_SIZE) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Disk image '%s' is smaller than one sector\n", path);
+        close(ata->fd);
+        free(ata);
+        return 0;
+    }
+
+    ata->size = (size_t)st.st_size;
+    ata->sectors = (uint32_t)(ata->size / ATA_SECTOR_SIZE);
+    if (ata->sectors > 0x0FFFFFFF) ata->sectors = 0x0FFFFFFF; // LBA28 limit
+
+    ata->image = mmap(NULL, ata->size, ata->read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+                      MAP_SHARED, ata->fd, 0);
+    if (ata->image == MAP_FAILED) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot map disk image '%s'\n", path);
+        close(ata->fd);
+        free(ata);
+        return 0;
+    }
+
+    ata_build_identify(ata);
+    ata_reset(sim, ata);
+
+    // Replace the stub device
+    Device *stub = device_find(sim, "ata");
+    if (stub) device_unregister(sim, stub);
+
+    Device *dev = device_register(sim, "ata", PORT_ATA_BASE, PORT_ATA_COUNT + 1,
+                                  ata_read, ata_write, ata);
+    if (!dev) {
+        ata_destroy(ata);
+        return 0;
+    }
+    dev->reset = ata_reset;
+    dev->print_stats = ata_print_stats;
+    dev->counter = ata_counter;
+    dev->counter_name = "ata_sectors";
+    dev->idle_reads = ~(1ULL << ATA_REG_DATA);
+    dev->state_size = sizeof(AtaDisk);             // The image itself is not rewound
+    dev->destroy = ata_destroy;
+
+    bebo_log(BEBO_LOG_INFO, "Attached disk image %s (%u sectors%s)\n", path, ata->sectors,
+             ata->read_only ? ", read-only" : "");
+    return 1;
+}
@@ -0,0 +1,270 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/branch.h"
+#include "../include/cycles.h"
+#include "../include/pipeline.h"
+#include <strings.h>
+
+// Branch predictor model. Runs after each instruction, so outcomes are
+// read off the PC the handler left behind.
+
+static const char *branch_kind_names[] = {"static", "bimodal", "gshare"};
+static const char *branch_class_names[BRANCH_CLASS_COUNT] = {"conditional", "jmp/call", "ret"};
+
+void branch_default_config(BranchConfig *config) {
+    config->kind = BRANCH_BIMODAL;
+    config->table_bits = 12;
+    config->history_bits = 12;
+    config->btb_entries = 256;
+    config->ras_depth = 16;
+    config->penalty = 3;
+}
+
+int branch_parse_kind(BranchConfig *config, const char *name) {
+    for (int i = 0; i < 3; i++) {
+        if (strcasecmp(name, branch_kind_names[i]) == 0) {
+            config->kind = (BranchPredictorKind)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int branch_parse_option(BranchConfig *config, const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return 0;
+
+    size_t len = eq - spec;
+    const char *value = eq + 1;
+    char *end;
+    unsigned long v = strtoul(value, &end, 0);
+    if (end == value || *end != '\0') return 0;
+
+    if (len == 5 && strncasecmp(spec, "table", 5) == 0 && v >= 1 && v <= 24) config->table_bits = v;
+    else if (len == 7 && strncasecmp(spec, "history", 7) == 0 && v <= 24) config->history_bits = v;
+    else if (len == 3 && strncasecmp(spec, "btb", 3) == 0 && v <= (1u << 20)) config->btb_entries = v;
+    else if (len == 3 && strncasecmp(spec, "ras", 3) == 0 && v <= 4096) config->ras_depth = v;
+    else if (len == 7 && strncasecmp(spec, "penalty", 7) == 0 && v <= 1000) config->penalty = v;
+    else return 0;
+    return 1;
+}
+
+int branch_start(SimulatorState *sim, const BranchConfig *config) {
+    if (!sim || sim->branch) return 0;
+    if (config->btb_entries & (config->btb_entries - 1)) {
+        bebo_log(BEBO_LOG_ERROR, "Error: BTB entries must be a power of two, not %u\n", config->btb_entries);
+        return 0;
+    }
+
+    BranchPredictor *b = calloc(1, sizeof(BranchPredictor));
+    if (!b) return 0;
+    b->config = *config;
+
+    // Counters start weakly not taken
+    uint32_t entries = 1u << config->table_bits;
+    b->counters = malloc(entries);
+    b->counter_mask = entries - 1;
+    if (config->btb_entries) {
+        b->btb_tags = calloc(config->btb_entries, sizeof(uint32_t));
+        b->btb_targets = calloc(config->btb_entries, sizeof(uint32_t));
+    }
+    if (config->ras_depth) b->ras = calloc(config->ras_depth, sizeof(uint32_t));
+    if (!b->counters || (config->btb_entries && (!b->btb_tags || !b->btb_targets)) ||
+        (config->ras_depth && !b->ras)) {
+        free(b->counters);
+        free(b->btb_tags);
+        free(b->btb_targets);
+        free(b->ras);
+        free(b);
+        return 0;
+    }
+    memset(b->counters, 1, entries);
+
+    sim->branch = b;
+    return 1;
+}
+
+void branch_stop(SimulatorState *sim) {
+    if (!sim || !sim->branch) return;
+    BranchPredictor *b = sim->branch;
+    free(b->counters);
+    free(b->btb_tags);
+    free(b->btb_targets);
+    free(b->ras);
+    free(b->sites);
+    free(b);
+    sim->branch = NULL;
+}
+
+static BranchSite* branch_site(BranchPredictor *b, uint32_t pc) {
+    if (b->site_count * 2 >= b->site_capacity) {
+        uint32_t capacity = b->site_capacity ? b->site_capacity * 2 : 1024;
+        BranchSite *grown = calloc(capacity, sizeof(BranchSite));
+        if (!grown) return NULL;
+        for (uint32_t i = 0; i < b->site_capacity; i++) {
+            if (!b->sites[i].count) continue;
+            uint32_t j = (b->sites[i].pc * 0x9E3779B1u) & (capacity - 1);
+            while (grown[j].count) j = (j + 1) & (capacity - 1);
+            grown[j] = b->sites[i];
+        }
+        free(b->sites);
+        b->sites = grown;
+        b->site_capacity = capacity;
+    }
+
+    uint32_t i = (pc * 0x9E3779B1u) & (b->site_capacity - 1);
+    while (b->sites[i].count && b->sites[i].pc != pc) {
+        i = (i + 1) & (b->site_capacity - 1);
+    }
+    if (!b->sites[i].count) {
+        b->sites[i].pc = pc;
+        b->site_count++;
+    }
+    return &b->sites[i];
+}
+
+static bool branch_predict_direction(BranchPredictor *b, uint32_t pc, bool taken) {
+    if (b->config.kind == BRANCH_STATIC) return !taken;
+
+    uint32_t index = pc;
+    if (b->config.kind == BRANCH_GSHARE) index ^= b->history;
+    uint8_t *counter = &b->counters[index & b->counter_mask];
+    bool miss = (*counter >= 2) != taken;
+
+    if (taken && *counter < 3) (*counter)++;
+    else if (!taken && *counter > 0) (*counter)--;
+    b->history = ((b->history << 1) | taken) & ((1u << b->config.history_bits) - 1);
+    return miss;
+}
+
+static bool branch_predict_target(BranchPredictor *b, uint32_t pc, uint32_t target) {
+    if (!b->btb_tags) return true;
+    uint32_t slot = pc & (b->config.btb_entries - 1);
+    bool miss = b->btb_tags[slot] != pc + 1 || b->btb_targets[slot] != target;
+    b->btb_tags[slot] = pc + 1;
+    b->btb_targets[slot] = target;
+    return miss;
+}
+
+static void branch_push_return(BranchPredictor *b, uint32_t address) {
+    if (!b->ras) return;
+    b->ras_top = (b->ras_top + 1) % b->config.ras_depth;
+    b->ras[b->ras_top] = address;
+    if (b->ras_count < b->config.ras_depth) b->ras_count++;
+}
+
+static bool branch_predict_return(BranchPredictor *b, uint32_t target) {
+    if (!b->ras || !b->ras_count) return true;
+    uint32_t predicted = b->ras[b->ras_top];
+    b->ras_top = (b->ras_top + b->config.ras_depth - 1) % b->config.ras_depth;
+    b->ras_count--;
+    return predicted != target;
+}
+
+void branch_retire(SimulatorState *sim, uint32_t pc) {
+    BranchPredictor *b = sim->branch;
+    b->mispredicted = false;
+    if (pc >= MEMORY_SIZE) return;
+
+    uint8_t opcode = sim->memory[pc];
+    BranchClass cls;
+    bool taken = true;
+    bool miss;
+    if (opcode >= OP_JZ && opcode <= OP_JNO) {
+        cls = BRANCH_CONDITIONAL;
+        taken = sim->pc != pc + 3;
+        miss = branch_predict_direction(b, pc, taken);
+        // The table's flat cost of a taken branch gives way to the prediction
+        if (taken && !sim->pipeline.model) sim->clock_cycles -= cycle_table.taken[opcode];
+    } else if (opcode == OP_JMP || opcode == OP_CALL) {
+        cls = BRANCH_JUMP;
+        miss = branch_predict_target(b, pc, sim->pc);
+        if (opcode == OP_CALL) branch_push_return(b, pc + 3);
+    } else if (opcode == OP_RET) {
+        cls = BRANCH_RETURN;
+        miss = branch_predict_return(b, sim->pc);
+    } else {
+        return;
+    }
+
+    b->branches[cls]++;
+    BranchSite *site = branch_site(b, pc);
+    if (site) {
+        site->cls = cls;
+        site->count++;
+        site->taken += taken;
+    }
+    if (!miss) return;
+
+    b->mispredicted = true;
+    b->mispredicts[cls]++;
+    if (site) site->mispredicts++;
+    // The pipeline model charges its own flush instead
+    if (!sim->pipeline.model) {
+        b->penalty_cycles += b->config.penalty;
+        sim->clock_cycles += b->config.penalty;
+    }
+}
+
+// ==========================================
+// Report
+// ==========================================
+
+void branch_report(SimulatorState *sim, int max_sites) {
+    if (!sim || !sim->branch) return;
+    BranchPredictor *b = sim->branch;
+
+    bebo_log(BEBO_LOG_INFO, "\n=== Branch Prediction ===\n");
+    bebo_log(BEBO_LOG_INFO, "Predictor: %s", branch_kind_names[b->config.kind]);
+    if (b->config.kind != BRANCH_STATIC) {
+        bebo_log(BEBO_LOG_INFO, ", %u counters", b->counter_mask + 1);
+        if (b->config.kind == BRANCH_GSHARE) bebo_log(BEBO_LOG_INFO, ", %u history bits", b->config.history_bits);
+    }
+    bebo_log(BEBO_LOG_INFO, "; BTB %u entries, RAS depth %u", b->config.btb_entries, b->config.ras_depth);
+    if (sim->pipeline.model) bebo_log(BEBO_LOG_INFO, ", penalty from the pipeline flush\n");
+    else bebo_log(BEBO_LOG_INFO, ", penalty %u cycles\n", b->config.penalty);
+    bebo_log(BEBO_LOG_INFO, "%-12s %14s %14s %8s\n", "class", "branches", "mispredicts", "miss%");
+    for (int i = 0; i < BRANCH_CLASS_COUNT; i++) {
+        bebo_log(BEBO_LOG_INFO, "%-12s %14lu %14lu %7.2f%%\n", branch_class_names[i],
+                 (unsigned long)b->branches[i], (unsigned long)b->mispredicts[i],
+                 b->branches[i] ? 100.0 * b->mispredicts[i] / b->branches[i] : 0.0);
+    }
+    uint64_t penalty = sim->pipeline.model ? sim->pipeline.model->mispredict_cycles : b->penalty_cycles;
+    bebo_log(BEBO_LOG_INFO, "Misprediction penalty: %lu cycles (%.2f%% of %lu)\n",
+             (unsigned long)penalty, sim->clock_cycles ? 100.0 * penalty / sim->clock_cycles : 0.0,
+             (unsigned long)sim->clock_cycles);
+
+    if (!b->site_count || max_sites <= 0) return;
+
+    BranchSite *order = malloc(b->site_count * sizeof(BranchSite));
+    if (!order) return;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < b->site_capacity; i++) {
+        if (b->sites[i].count && b->sites[i].mispredicts) order[n++] = b->sites[i];
+    }
+
+    // Partial selection of the branches with the most mispredictions
+    uint32_t rows = n < (uint32_t)max_sites ? n : (uint32_t)max_sites;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint32_t best = i;
+        for (uint32_t j = i + 1; j < n; j++) {
+            if (order[j].mispredicts > order[best].mispredicts) best = j;
+        }
+        BranchSite tmp = order[i];
+        order[i] = order[best];
+        order[best] = tmp;
+    }
+
+    if (rows) {
+        bebo_log(BEBO_LOG_INFO, "\nBranches with the most mispredictions:\n");
+        bebo_log(BEBO_LOG_INFO, "  %8s %-12s %12s %8s %12s %8s\n",
+                 "pc", "class", "executed", "taken%", "mispredicts", "miss%");
+    }
+    for (uint32_t i = 0; i < rows; i++) {
+        BranchSite *s = &order[i];
+        bebo_log(BEBO_LOG_INFO, "  0x%06X %-12s %12lu %7.2f%% %12lu %7.2f%%\n", s->pc,
+                 branch_class_names[s->cls], (unsigned long)s->count, 100.0 * s->taken / s->count,
+                 (unsigned long)s->mispredicts, 100.0 * s->mispredicts / s->count);
+    }
+    free(order);
+}
@@ -0,0 +1,342 @@
+#include "../include/beboasm.h"
+#include "../include/cache.h"
+#include <strings.h>
+
+// Cache hierarchy model. Hits on the line used last stay in the inline
+// fast path in cache.h; everything else comes through cache_lookup.
+
+static const char *cache_policy_names[] = {"lru", "fifo", "random"};
+
+void cache_default_config(CacheConfig *config) {
+    config->l1i = (CacheLevelConfig){16 * 1024, 4, 64, CACHE_LRU, 0};
+    config->l1d = (CacheLevelConfig){16 * 1024, 4, 64, CACHE_LRU, 0};
+    config->l2 = (CacheLevelConfig){256 * 1024, 8, 64, CACHE_LRU, 10};
+    config->memory_latency = 100;
+}
+
+static bool cache_parse_size(const char *s, char **end, uint32_t *size) {
+    unsigned long v = strtoul(s, end, 0);
+    if (**end == 'K' || **end == 'k') {
+        v *= 1024;
+        (*end)++;
+    } else if (**end == 'M' || **end == 'm') {
+        v *= 1024 * 1024;
+        (*end)++;
+    }
+    if (*end == s || v > MEMORY_SIZE) return false;
+    *size = (uint32_t)v;
+    return true;
+}
+
+int cache_parse_option(CacheConfig *config, const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return 0;
+
+    size_t len = eq - spec;
+    const char *value = eq + 1;
+    char *end;
+    if (len == 6 && strncasecmp(spec, "memory", 6) == 0) {
+        config->memory_latency = (uint32_t)strtoul(value, &end, 0);
+        return end != value && *end == '\0';
+    }
+
+    CacheLevelConfig *level;
+    if (len == 3 && strncasecmp(spec, "l1i", 3) == 0) level = &config->l1i;
+    else if (len == 3 && strncasecmp(spec, "l1d", 3) == 0) level = &config->l1d;
+    else if (len == 2 && strncasecmp(spec, "l2", 2) == 0) level = &config->l2;
+    else return 0;
+
+    // SIZE,WAYS,LINE[,POLICY[,LATENCY]]
+    CacheLevelConfig c = *level;
+    if (!cache_parse_size(value, &end, &c.size)) return 0;
+    if (*end == '\0' && c.size == 0) {
+        *level = c;
+        return 1;
+    }
+    if (*end++ != ',') return 0;
+    c.ways = (uint32_t)strtoul(end, &end, 0);
+    if (*end++ != ',') return 0;
+    c.line_size = (uint32_t)strtoul(end, &end, 0);
+    if (*end == ',') {
+        const char *policy = ++end;
+        while (*end && *end != ',') end++;
+        bool found = false;
+        for (int i = 0; i < 3; i++) {
+            if (strlen(cache_policy_names[i]) == (size_t)(end - policy) &&
+                strncasecmp(policy, cache_policy_names[i], end - policy) == 0) {
+                c.policy = (CachePolicy)i;
+                found = true;
+            }
+        }
+        if (!found) return 0;
+        if (*end == ',') c.latency = (uint32_t)strtoul(end + 1, &end, 0);
+    }
+    if (*end != '\0') return 0;
+
+    *level = c;
+    return 1;
+}
+
+static bool is_power_of_two(uint32_t v) {
+    return v && !(v & (v - 1));
+}
+
+static int cache_level_init(CacheLevel *c, const CacheLevelConfig *config, const char *name) {
+    uint32_t sets = config->ways && config->line_size ? config->size / (config->ways * config->line_size) : 0;
+    if (!is_power_of_two(config->line_size) || config->line_size < 4 || config->ways > 64 ||
+        !is_power_of_two(sets) || sets * config->ways * config->line_size != config->size) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Invalid %s cache geometry %u bytes, %u ways, %u-byte lines\n",
+                 name, config->size, config->ways, config->line_size);
+        return 0;
+    }
+
+    uint32_t slots = sets * config->ways;
+    c->tags = calloc(slots, sizeof(uint32_t));
+    c->stamps = calloc(slots, sizeof(uint64_t));
+    c->dirty = calloc(slots, 1);
+    if (!c->tags || !c->stamps || !c->dirty) return 0;
+
+    c->last_line = UINT32_MAX;
+    c->latency = config->latency;
+    c->line_shift = __builtin_ctz(config->line_size);
+    c->set_mask = sets - 1;
+    c->ways = config->ways;
+    c->policy = config->policy;
+    c->random = 0x9E3779B9;
+    c->name = name;
+    return 1;
+}
+
+static void cache_level_free(CacheLevel *c) {
+    free(c->tags);
+    free(c->stamps);
+    free(c->dirty);
+}
+
+int cache_start(SimulatorState *sim, const CacheConfig *config) {
+    if (!sim || sim->cache) return 0;
+    if (config->l1i.size == 0 || config->l1d.size == 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: The L1 caches cannot be disabled\n");
+        return 0;
+    }
+
+    CacheModel *m = calloc(1, sizeof(CacheModel));
+    if (!m) return 0;
+    if (!cache_level_init(&m->l1i, &config->l1i, "L1I") ||
+        !cache_level_init(&m->l1d, &config->l1d, "L1D") ||
+        (config->l2.size && !cache_level_init(&m->l2, &config->l2, "L2"))) {
+        cache_level_free(&m->l1i);
+        cache_level_free(&m->l1d);
+        cache_level_free(&m->l2);
+        free(m);
+        return 0;
+    }
+    if (config->l2.size) {
+        m->l1i.next = m->l1d.next = &m->l2;
+    }
+    m->memory_latency = config->memory_latency;
+    m->pc = sim->pc;
+
+    sim->cache = m;
+    return 1;
+}
+
+void cache_stop(SimulatorState *sim) {
+    if (!sim || !sim->cache) return;
+    CacheModel *m = sim->cache;
+
+    cache_level_free(&m->l1i);
+    cache_level_free(&m->l1d);
+    cache_level_free(&m->l2);
+    free(m->pcs);
+    free(m);
+    sim->cache = NULL;
+}
+
+// ==========================================
+// Lookup
+// ==========================================
+
+// Empty way first, then by policy
+static uint32_t cache_victim(CacheLevel *c, uint32_t base) {
+    uint32_t victim = base;
+    for (uint32_t w = 0; w < c->ways; w++) {
+        if (!c->tags[base + w]) return base + w;
+        if (c->stamps[base + w] < c->stamps[victim]) victim = base + w;
+    }
+    if (c->policy == CACHE_RANDOM) {
+        c->random ^= c->random << 13;
+        c->random ^= c->random >> 17;
+        c->random ^= c->random << 5;
+        victim = base + c->random % c->ways;
+    }
+    return victim;
+}
+
+// Fill slot with line, writing back what it held. A line written back to
+// the next level is marked dirty there, or installed if it was evicted.
+static void cache_fill(CacheModel *m, CacheLevel *c, uint32_t slot, uint32_t line, bool write);
+
+static void cache_writeback(CacheModel *m, CacheLevel *c, uint32_t address) {
+    uint32_t line = address >> c->line_shift;
+    uint32_t base = (line & c->set_mask) * c->ways;
+    for (uint32_t w = 0; w < c->ways; w++) {
+        if (c->tags[base + w] == line + 1) {
+            c->dirty[base + w] = 1;
+            return;
+        }
+    }
+    cache_fill(m, c, cache_victim(c, base), line, true);
+}
+
+static void cache_fill(CacheModel *m, CacheLevel *c, uint32_t slot, uint32_t line, bool write) {
+    if (c->tags[slot] && c->dirty[slot]) {
+        c->writebacks++;
+        if (c->next) cache_writeback(m, c->next, (c->tags[slot] - 1) << c->line_shift);
+    }
+    c->tags[slot] = line + 1;
+    c->stamps[slot] = ++c->clock;
+    c->dirty[slot] = write;
+
+    // The line just filled is the most recently used in its set
+    c->last_line = line;
+    c->last_slot = slot;
+}
+
+// Cycles for the access: this level's latency on a hit, otherwise
+// whatever the next level (or memory) takes to supply the line
+static uint32_t cache_level_access(CacheModel *m, CacheLevel *c, uint32_t address, bool write) {
+    uint32_t line = address >> c->line_shift;
+    if (line == c->last_line) {
+        if (write) c->dirty[c->last_slot] = 1;
+        return c->latency;
+    }
+
+    uint32_t base = (line & c->set_mask) * c->ways;
+    for (uint32_t w = 0; w < c->ways; w++) {
+        uint32_t slot = base + w;
+        if (c->tags[slot] == line + 1) {
+            if (c->policy == CACHE_LRU) c->stamps[slot] = ++c->clock;
+            if (write) c->dirty[slot] = 1;
+            c->last_line = line;
+            c->last_slot = slot;
+            return c->latency;
+        }
+    }
+
+    c->misses++;
+    uint32_t cycles = m->memory_latency;
+    if (c->next) {
+        c->next->accesses++;
+        cycles = cache_level_access(m, c->next, address, false);
+    }
+    cache_fill(m, c, cache_victim(c, base), line, write);
+    return cycles;
+}
+
+static CacheMissPC* cache_miss_pc(CacheModel *m, uint32_t pc) {
+    if (m->pc_count * 2 >= m->pc_capacity) {
+        uint32_t capacity = m->pc_capacity ? m->pc_capacity * 2 : 1024;
+        CacheMissPC *grown = calloc(capacity, sizeof(CacheMissPC));
+        if (!grown) return NULL;
+        for (uint32_t i = 0; i < m->pc_capacity; i++) {
+            if (!m->pcs[i].l1_misses) continue;
+            uint32_t j = (m->pcs[i].pc * 0x9E3779B1u) & (capacity - 1);
+            while (grown[j].l1_misses) j = (j + 1) & (capacity - 1);
+            grown[j] = m->pcs[i];
+        }
+        free(m->pcs);
+        m->pcs = grown;
+        m->pc_capacity = capacity;
+    }
+
+    uint32_t i = (pc * 0x9E3779B1u) & (m->pc_capacity - 1);
+    while (m->pcs[i].l1_misses && m->pcs[i].pc != pc) {
+        i = (i + 1) & (m->pc_capacity - 1);
+    }
+    if (!m->pcs[i].l1_misses) {
+        m->pcs[i].pc = pc;
+        m->pc_count++;
+    }
+    return &m->pcs[i];
+}
+
+void cache_lookup(SimulatorState *sim, CacheLevel *c, uint32_t address, bool write) {
+    CacheModel *m = sim->cache;
+    uint64_t misses = c->misses;
+    uint64_t l2_misses = m->l2.misses;
+
+    uint32_t cycles = cache_level_access(m, c, address, write);
+    sim->clock_cycles += cycles;
+    m->cycles += cycles;
+    if (c->misses == misses) return;
+
+    m->miss_cycles += cycles;
+    CacheMissPC *entry = cache_miss_pc(m, m->pc);
+    if (entry) {
+        entry->l1_misses++;
+        entry->l2_misses += m->l2.misses - l2_misses;
+        entry->cycles += cycles;
+    }
+}
+
+// ==========================================
+// Report
+// ==========================================
+
+static void cache_report_level(CacheLevel *c) {
+    if (!c->tags) return;
+    uint32_t line = 1u << c->line_shift;
+    uint32_t size = (c->set_mask + 1) * c->ways * line;
+    bebo_log(BEBO_LOG_INFO, "%-5s %7u KB %5u %5u %-7s %14lu %12lu %7.2f%% %11lu\n",
+             c->name, size / 1024, c->ways, line, cache_policy_names[c->policy],
+             (unsigned long)c->accesses, (unsigned long)c->misses,
+             c->accesses ? 100.0 * c->misses / c->accesses : 0.0, (unsigned long)c->writebacks);
+}
+
+void cache_report(SimulatorState *sim, int max_pcs) {
+    if (!sim || !sim->cache) return;
+    CacheModel *m = sim->cache;
+
+    bebo_log(BEBO_LOG_INFO, "\n=== Cache Model ===\n");
+    bebo_log(BEBO_LOG_INFO, "%-5s %10s %5s %5s %-7s %14s %12s %8s %11s\n",
+             "level", "size", "ways", "line", "policy", "accesses", "misses", "miss%", "writebacks");
+    cache_report_level(&m->l1i);
+    cache_report_level(&m->l1d);
+    cache_report_level(&m->l2);
+    bebo_log(BEBO_LOG_INFO, "Miss latency: %lu cycles (%.2f%% of %lu), memory latency %u\n",
+             (unsigned long)m->miss_cycles,
+             sim->clock_cycles ? 100.0 * m->miss_cycles / sim->clock_cycles : 0.0,
+             (unsigned long)sim->clock_cycles, m->memory_latency);
+
+    if (!m->pc_count || max_pcs <= 0) return;
+
+    CacheMissPC *order = malloc(m->pc_count * sizeof(CacheMissPC));
+    if (!order) return;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < m->pc_capacity; i++) {
+        if (m->pcs[i].l1_misses) order[n++] = m->pcs[i];
+    }
+
+    // Partial selection of the instructions with the most miss cycles
+    uint32_t rows = n < (uint32_t)max_pcs ? n : (uint32_t)max_pcs;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint32_t best = i;
+        for (uint32_t j = i + 1; j < n; j++) {
+            if (order[j].cycles > order[best].cycles) best = j;
+        }
+        CacheMissPC tmp = order[i];
+        order[i] = order[best];
+        order[best] = tmp;
+    }
+
+    bebo_log(BEBO_LOG_INFO, "\nInstructions with the most miss cycles:\n");
+    bebo_log(BEBO_LOG_INFO, "  %8s %12s %12s %12s %7s\n", "pc", "L1 misses", "L2 misses", "cycles", "%");
+    for (uint32_t i = 0; i < rows; i++) {
+        CacheMissPC *e = &order[i];
+        bebo_log(BEBO_LOG_INFO, "  0x%06X %12lu %12lu %12lu %6.2f%%\n", e->pc,
+                 (unsigned long)e->l1_misses, (unsigned long)e->l2_misses, (unsigned long)e->cycles,
+                 m->miss_cycles ? 100.0 * e->cycles / m->miss_cycles : 0.0);
+    }
+    free(order);
+}
@@ -0,0 +1,181 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/cycles.h"
+#include <ctype.h>
+#include <strings.h>
+
+// Default instruction timings. Every instruction the simulator executes
+// has an entry; unimplemented opcodes cost nothing.
+
+#define COST(op, reg, imm) [(op) * CYCLE_MODES] = (reg), [(op) * CYCLE_MODES + 1] = (imm)
+
+CycleTable cycle_table = {
+    .cost = {
+        COST(OP_MOV, 2, 2),
+        COST(OP_MOVW, 4, 4),
+        COST(OP_LOAD, 4, 4),
+        COST(OP_LOADB, 2, 2),
+        COST(OP_LOADH, 3, 3),
+        COST(OP_STORE, 4, 4),
+        COST(OP_STOREB, 2, 2),
+        COST(OP_STOREH, 3, 3),
+        COST(OP_PUSH, 2, 2),
+        COST(OP_POP, 2, 2),
+
+        COST(OP_ADD, 3, 3),
+        COST(OP_SUB, 3, 3),
+        COST(OP_INC, 1, 1),
+        COST(OP_DEC, 1, 1),
+        COST(OP_AND, 3, 3),
+        COST(OP_OR, 3, 3),
+        COST(OP_XOR, 3, 3),
+        COST(OP_NOT, 2, 2),
+        COST(OP_SHL, 3, 3),
+        COST(OP_SHR, 3, 3),
+        COST(OP_CMP, 2, 2),
+
+        COST(OP_JMP, 3, 3),
+        COST(OP_JZ, 2, 2),
+        COST(OP_JNZ, 2, 2),
+        COST(OP_JE, 2, 2),
+        COST(OP_JNE, 2, 2),
+        COST(OP_JG, 2, 2),
+        COST(OP_JGE, 2, 2),
+        COST(OP_JL, 2, 2),
+        COST(OP_JLE, 2, 2),
+        COST(OP_JC, 2, 2),
+        COST(OP_JNC, 2, 2),
+        COST(OP_JO, 2, 2),
+        COST(OP_JNO, 2, 2),
+        COST(OP_CALL, 5, 5),
+        COST(OP_RET, 4, 4),
+        COST(OP_RETI, 4, 4),
+
+        COST(OP_NOP, 1, 1),
+        COST(OP_WAIT, 1, 1),
+        COST(OP_TRAP, 4, 4),
+        COST(OP_SVC, 4, 4),
+        COST(OP_IRET, 4, 4),
+        COST(OP_TRACE, 1, 1),
+
+        COST(OP_IN, 2, 2),
+        COST(OP_OUT, 2, 2),
+        COST(OP_INB, 2, 2),
+        COST(OP_OUTB, 2, 2),
+    },
+    .taken = {
+        [OP_JZ] = 1, [OP_JNZ] = 1, [OP_JE] = 1, [OP_JNE] = 1, [OP_JG] = 1, [OP_JGE] = 1,
+        [OP_JL] = 1, [OP_JLE] = 1, [OP_JC] = 1, [OP_JNC] = 1, [OP_JO] = 1, [OP_JNO] = 1,
+    },
+    .interrupt = 6,
+};
+
+// Offset of the mode byte in each encoding (0: none)
+static uint32_t cycles_mode_offset(uint8_t opcode) {
+    switch (opcode) {
+        case OP_MOV: case OP_MOVW: case OP_CMP:
+        case OP_LOAD: case OP_LOADB: case OP_LOADH:
+        case OP_STORE: case OP_STOREB: case OP_STOREH:
+            return 2;
+        case OP_ADD: case OP_SUB: case OP_AND: case OP_OR:
+        case OP_XOR: case OP_SHL: case OP_SHR:
+            return 3;
+    }
+    return 0;
+}
+
+uint32_t cycles_instruction(const uint8_t *code, uint32_t size, uint32_t *taken) {
+    if (!size) return 0;
+    uint8_t opcode = code[0];
+    uint32_t offset = cycles_mode_offset(opcode);
+    uint8_t mode = offset && offset < size ? code[offset] : 0;
+    if (taken) *taken = cycle_table.taken[opcode];
+    return cycle_cost(opcode, mode);
+}
+
+static bool cycles_parse_value(char *token, uint8_t *value) {
+    if (!token) return false;
+    char *end;
+    unsigned long v = strtoul(token, &end, 0);
+    if (end == token || *end || v > 255) return false;
+    *value = (uint8_t)v;
+    return true;
+}
+
+int cycles_load(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot open cycle table %s\n", filename);
+        return 0;
+    }
+
+    CycleTable table = cycle_table;
+    char line[256];
+    int line_no = 0;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_no++;
+        line[strcspn(line, "#;\r\n")] = '\0';
+
+        char *name = strtok(line, " \t,");
+        if (!name) continue;
+        char *reg = strtok(NULL, " \t,");
+        char *imm = strtok(NULL, " \t,");
+        char *taken = strtok(NULL, " \t,");
+
+        if (strcasecmp(name, "INTERRUPT") == 0) {
+            if (!cycles_parse_value(reg, &table.interrupt) || imm) {
+                bebo_log(BEBO_LOG_ERROR, "Error: %s:%d: expected 1 cycle count (0-255)\n", filename, line_no);
+                ok = 0;
+            }
+            continue;
+        }
+
+        int opcode = -1;
+        if (isdigit((unsigned char)name[0])) {
+            char *end;
+            unsigned long v = strtoul(name, &end, 0);
+            if (!*end && v < 256) opcode = (int)v;
+        } else {
+            OpcodeMetadata *meta = opcode_find(name);
+            if (meta) opcode = meta->opcode;
+        }
+
+        uint8_t costs[3] = {0, 0, 0};
+        if (opcode < 0) {
+            bebo_log(BEBO_LOG_ERROR, "Error: %s:%d: unknown instruction '%s'\n", filename, line_no, name);
+            ok = 0;
+        } else if (!cycles_parse_value(reg, &costs[0]) ||
+                   (imm && !cycles_parse_value(imm, &costs[1])) ||
+                   (taken && !cycles_parse_value(taken, &costs[2])) ||
+                   strtok(NULL, " \t,")) {
+            bebo_log(BEBO_LOG_ERROR, "Error: %s:%d: expected 1 to 3 cycle counts (0-255)\n", filename, line_no);
+            ok = 0;
+        } else {
+            table.cost[opcode * CYCLE_MODES] = costs[0];
+            table.cost[opcode * CYCLE_MODES + 1] = imm ? costs[1] : costs[0];
+            if (taken) table.taken[opcode] = costs[2];
+        }
+    }
+    fclose(f);
+
+    if (ok) cycle_table = table;
+    return ok;
+}
+
+void cycles_write(FILE *f) {
+    fprintf(f, "# %-8s %8s %9s %5s\n", "opcode", "register", "immediate", "taken");
+    for (int op = 0; op < 256; op++) {
+        uint8_t reg = cycle_table.cost[op * CYCLE_MODES];
+        uint8_t imm = cycle_table.cost[op * CYCLE_MODES + 1];
+        if (!reg && !imm && !cycle_table.taken[op]) continue;
+
+        OpcodeMetadata *meta = opcode_by_value((Opcode)op);
+        if (meta) fprintf(f, "  %-8s", meta->mnemonic);
+        else fprintf(f, "  0x%02X    ", op);
+        fprintf(f, " %8u %9u", reg, imm);
+        if (cycle_table.taken[op]) fprintf(f, " %5u", cycle_table.taken[op]);
+        fprintf(f, "\n");
+    }
+    fprintf(f, "  %-8s %8u\n", "INTERRUPT", cycle_table.interrupt);
+}
@@ -5,15 +5,15 @@ void process_command(SimulatorState *sim, const char *cmd);
 void print_help(void);
 
 void debugger_start(SimulatorState *sim) {
-    printf("BeboAsm Debugger v1.0\n");
-    printf("Type 'help' for commands\n\n");
+    bebo_log(BEBO_LOG_INFO, "BeboAsm Debugger v1.0\n");
+    bebo_log(BEBO_LOG_INFO, "Type 'help' for commands\n\n");
     
     sim->single_step = true;
     
     char line_buf[256];
     
     while (1) {
-        printf("(bebodebug) ");
+        bebo_log(BEBO_LOG_INFO, "(bebodebug) ");
         fflush(stdout);
         
         if (!fgets(line_buf, sizeof(line_buf), stdin)) break;
@@ -48,9 +48,18 @@ void process_command(SimulatorState *sim, const char *cmd) {
         debugger_disassemble(sim, sim->pc, 1);
     } else if (strcmp(command, "break") == 0 || strcmp(command, "b") == 0) {
         uint32_t addr;
-        if (sscanf(args, "0x%x", &addr) == 1 || sscanf(args, "%u", &addr) == 1) {
+        if (sscanf(args, "0x%x", &addr) == 1 || sscanf(args, "%u", &addr) == 1 ||
+            hotpatch_symbol_address(sim, args, &addr)) {
             debugger_add_breakpoint(sim, addr);
         }
+    } else if (strcmp(command, "reload") == 0) {
+        // Reassemble and patch the running guest, then carry on from here
+        char path[256];
+        if (sscanf(cmd, "%*s %255s", path) == 1) {
+            hotpatch_reload(sim, path);
+        } else {
+            hotpatch_reload(sim, NULL);
+        }
     } else if (strcmp(command, "registers") == 0 || strcmp(command, "reg") == 0) {
         debugger_print_registers(sim);
     } else if (strcmp(command, "memory") == 0 || strcmp(command, "mem") == 0) {
@@ -71,66 +80,66 @@ void process_command(SimulatorState *sim, const char *cmd) {
     } else if (strcmp(command, "quit") == 0 || strcmp(command, "q") == 0) {
         exit(0);
     } else {
-        printf("Unknown command: %s\n", command);
+        bebo_log(BEBO_LOG_INFO, "Unknown command: %s\n", command);
     }
 }
 
 void debugger_print_registers(SimulatorState *sim) {
-    printf("\n=== Registers ===\n");
+    bebo_log(BEBO_LOG_INFO, "\n=== Registers ===\n");
     
     // General purpose registers
     for (int i = 0; i < 16; i++) {
-        printf("R%02d: 0x%08X  ", i, sim->registers[i]);
-        if ((i + 1) % 4 == 0) printf("\n");
+        bebo_log(BEBO_LOG_INFO, "R%02d: 0x%08X  ", i, sim->registers[i]);
+        if ((i + 1) % 4 == 0) bebo_log(BEBO_LOG_INFO, "\n");
     }
     
     // Special registers
-    printf("\nPC: 0x%08X  SP: 0x%08X  FP: 0x%08X\n", 
-           sim->pc, sim->sp, sim->fp);
+    bebo_log(BEBO_LOG_INFO, "\nPC: 0x%08X  SP: 0x%08X  FP: 0x%08X\n", 
+             sim->pc, sim->sp, sim->fp);
     
     // Flags
-    printf("Flags: [%c%c%c%c%c%c%c%c]\n",
-           (sim->flags & FLAG_ZERO) ? 'Z' : '-',
-           (sim->flags & FLAG_CARRY) ? 'C' : '-',
-           (sim->flags & FLAG_OVERFLOW) ? 'V' : '-',
-           (sim->flags & FLAG_NEGATIVE) ? 'N' : '-',
-           (sim->flags & FLAG_INTERRUPT) ? 'I' : '-',
-           (sim->flags & FLAG_DECIMAL) ? 'D' : '-',
-           (sim->flags & FLAG_BREAK) ? 'B' : '-',
-           (sim->flags & FLAG_DEBUG) ? 'D' : '-');
+    bebo_log(BEBO_LOG_INFO, "Flags: [%c%c%c%c%c%c%c%c]\n",
+             (sim->flags & FLAG_ZERO) ? 'Z' : '-',
+             (sim->flags & FLAG_CARRY) ? 'C' : '-',
+             (sim->flags & FLAG_OVERFLOW) ? 'V' : '-',
+             (sim->flags & FLAG_NEGATIVE) ? 'N' : '-',
+             (sim->flags & FLAG_INTERRUPT) ? 'I' : '-',
+             (sim->flags & FLAG_DECIMAL) ? 'D' : '-',
+             (sim->flags & FLAG_BREAK) ? 'B' : '-',
+             (sim->flags & FLAG_DEBUG) ? 'D' : '-');
     
-    printf("Instructions: %lu  Cycles: %lu\n", 
-           (unsigned long)sim->instructions_executed, (unsigned long)sim->clock_cycles);
+    bebo_log(BEBO_LOG_INFO, "Instructions: %lu  Cycles: %lu\n", 
+             (unsigned long)sim->instructions_executed, (unsigned long)sim->clock_cycles);
 }
 
 void debugger_print_memory(SimulatorState *sim, uint32_t address, uint32_t size) {
-    printf("\nMemory at 0x%08X:\n", address);
+    bebo_log(BEBO_LOG_INFO, "\nMemory at 0x%08X:\n", address);
     
     for (uint32_t i = 0; i < size; i += 16) {
-        printf("0x%04X: ", address + i);
+        bebo_log(BEBO_LOG_INFO, "0x%04X: ", address + i);
         
         // Hex dump
         for (int j = 0; j < 16 && (i + j) < size; j++) {
-            if (j == 8) printf(" ");
-            printf("%02X ", memory_read_byte(sim, address + i + j));
+            if (j == 8) bebo_log(BEBO_LOG_INFO, " ");
+            bebo_log(BEBO_LOG_INFO, "%02X ", memory_read_byte(sim, address + i + j));
         }
         
         // ASCII dump
-        printf(" |");
+        bebo_log(BEBO_LOG_INFO, " |");
         for (int j = 0; j < 16 && (i + j) < size; j++) {
             uint8_t c = memory_read_byte(sim, address + i + j);
-            printf("%c", (c >= 32 && c < 127) ? c : '.');
+            bebo_log(BEBO_LOG_INFO, "%c", (c >= 32 && c < 127) ? c : '.');
         }
-        printf("|\n");
+        bebo_log(BEBO_LOG_INFO, "|\n");
     }
 }
 
 void debugger_disassemble(SimulatorState *sim, uint32_t address, uint32_t count) {
-    printf("\nDisassembly:\n");
+    bebo_log(BEBO_LOG_INFO, "\nDisassembly:\n");
     
     uint32_t pc = address;
     for (uint32_t i = 0; i < count; i++) {
-        printf("%c 0x%04X: ", (pc == sim->pc) ? '>' : ' ', pc);
+        bebo_log(BEBO_LOG_INFO, "%c 0x%04X: ", (pc == sim->pc) ? '>' : ' ', pc);
         
         uint8_t opcode = memory_read_byte(sim, pc);
         pc++;
@@ -140,9 +149,9 @@ void debugger_disassemble(SimulatorState *sim, uint32_t address, uint32_t count)
             case OP_MOV: {
                 uint8_t dst = memory_read_byte(sim, pc++);
                 uint8_t mode = memory_read_byte(sim, pc++);
-                printf("MOV R%d, ", dst);
-                if (mode == 0) printf("R%d", memory_read_byte(sim, pc++));
-                else { printf("0x%04X", memory_read_word(sim, pc)); pc += 2; }
+                bebo_log(BEBO_LOG_INFO, "MOV R%d, ", dst);
+                if (mode == 0) bebo_log(BEBO_LOG_INFO, "R%d", memory_read_byte(sim, pc++));
+                else { bebo_log(BEBO_LOG_INFO, "0x%04X", memory_read_word(sim, pc)); pc += 2; }
                 break;
             }
             case OP_ADD:
@@ -150,36 +159,44 @@ void debugger_disassemble(SimulatorState *sim, uint32_t address, uint32_t count)
                 uint8_t dst = memory_read_byte(sim, pc++);
                 uint8_t src1 = memory_read_byte(sim, pc++);
                 uint8_t mode = memory_read_byte(sim, pc++);
-                printf("%s R%d, R%d, ", (opcode == OP_ADD) ? "ADD" : "SUB", dst, src1);
-                if (mode == 0) printf("R%d", memory_read_byte(sim, pc++));
-                else { printf("0x%04X", memory_read_word(sim, pc)); pc += 2; }
+                bebo_log(BEBO_LOG_INFO, "%s R%d, R%d, ", (opcode == OP_ADD) ? "ADD" : "SUB", dst, src1);
+                if (mode == 0) bebo_log(BEBO_LOG_INFO, "R%d", memory_read_byte(sim, pc++));
+                else { bebo_log(BEBO_LOG_INFO, "0x%04X", memory_read_word(sim, pc)); pc += 2; }
                 break;
             }
             case OP_LOAD: {
                 uint8_t dst = memory_read_byte(sim, pc++);
                 uint8_t mode = memory_read_byte(sim, pc++);
-                printf("LOAD R%d, ", dst);
-                if (mode == 0) printf("[R%d]", memory_read_byte(sim, pc++));
-                else { printf("[0x%04X]", memory_read_word(sim, pc)); pc += 2; }
+                bebo_log(BEBO_LOG_INFO, "LOAD R%d, ", dst);
+                if (mode == 0) bebo_log(BEBO_LOG_INFO, "[R%d]", memory_read_byte(sim, pc++));
+                else { bebo_log(BEBO_LOG_INFO, "[0x%04X]", memory_read_word(sim, pc)); pc += 2; }
                 break;
             }
             case OP_CMP: {
                 uint8_t src1 = memory_read_byte(sim, pc++);
                 uint8_t mode = memory_read_byte(sim, pc++);
-                printf("CMP R%d, ", src1);
-                if (mode == 0) printf("R%d", memory_read_byte(sim, pc++));
-                else { printf("0x%04X", memory_read_word(sim, pc)); pc += 2; }
+                bebo_log(BEBO_LOG_INFO, "CMP R%d, ", src1);
+                if (mode == 0) bebo_log(BEBO_LOG_INFO, "R%d", memory_read_byte(sim, pc++));
+                else { bebo_log(BEBO_LOG_INFO, "0x%04X", memory_read_word(sim, pc)); pc += 2; }
                 break;
             }
             case OP_OUT: {
-                uint8_t port = memory_read_byte(sim, pc++);
+                uint16_t port = memory_read_word(sim, pc);
+                pc += 2;
                 uint8_t reg = memory_read_byte(sim, pc++);
-                printf("OUT #0x%02X, R%d", port, reg);
+                bebo_log(BEBO_LOG_INFO, "OUT #0x%04X, R%d", port, reg);
+                break;
+            }
+            case OP_IN: {
+                uint8_t reg = memory_read_byte(sim, pc++);
+                uint16_t port = memory_read_word(sim, pc);
+                pc += 2;
+                bebo_log(BEBO_LOG_INFO, "IN R%d, #0x%04X", reg, port);
                 break;
             }
             case OP_INC:
             case OP_DEC:
-                printf("%s R%d", (opcode == OP_INC) ? "INC" : "DEC", memory_read_byte(sim, pc++));
+                bebo_log(BEBO_LOG_INFO, "%s R%d", (opcode == OP_INC) ? "INC" : "DEC", memory_read_byte(sim, pc++));
                 break;
             case OP_JMP:
             case OP_JE:
@@ -190,41 +207,55 @@ void debugger_disassemble(SimulatorState *sim, uint32_t address, uint32_t count)
                 const uint8_t ops[] = {OP_JMP, OP_JE, OP_JNE, OP_JG, OP_JL};
                 const char *m = "J??";
                 for(int k=0; k<5; k++) if(ops[k] == opcode) m = mnem[k];
-                printf("%s 0x%04X", m, memory_read_word(sim, pc));
+                bebo_log(BEBO_LOG_INFO, "%s 0x%04X", m, memory_read_word(sim, pc));
                 pc += 2;
                 break;
             }
             case OP_HALT:
-                printf("HALT");
+                bebo_log(BEBO_LOG_INFO, "HALT");
                 break;
             case OP_NOP:
-                printf("NOP");
+                bebo_log(BEBO_LOG_INFO, "NOP");
+                break;
+            case OP_RETI:
+                bebo_log(BEBO_LOG_INFO, "RETI");
+                break;
+            case OP_IRET:
+                bebo_log(BEBO_LOG_INFO, "IRET");
+                break;
+            case OP_WAIT:
+                bebo_log(BEBO_LOG_INFO, "WAIT");
+                break;
+            case OP_SVC:
+            case OP_TRAP:
+                bebo_log(BEBO_LOG_INFO, "%s #%d", (opcode == OP_SVC) ? "SVC" : "TRAP", memory_read_byte(sim, pc++));
                 break;
             default:
-                printf("DB 0x%02X", opcode);
+                bebo_log(BEBO_LOG_INFO, "DB 0x%02X", opcode);
         }
-        printf("\n");
+        bebo_log(BEBO_LOG_INFO, "\n");
     }
 }
 
 void debugger_add_breakpoint(SimulatorState *sim, uint32_t address) {
     if (sim->breakpoint_count >= 256) {
-        printf("Breakpoint table full\n");
+        bebo_log(BEBO_LOG_INFO, "Breakpoint table full\n");
         return;
     }
     
     sim->breakpoints[sim->breakpoint_count++] = address;
-    printf("Breakpoint set at 0x%08X\n", address);
+    bebo_log(BEBO_LOG_INFO, "Breakpoint set at 0x%08X\n", address);
 }
 
 void print_help(void) {
-    printf("\nAvailable commands:\n");
-    printf("  run/r           - Run program\n");
-    printf("  step/s          - Execute single instruction\n");
-    printf("  break/b ADDR    - Set breakpoint\n");
-    printf("  registers/reg   - Show registers\n");
-    printf("  memory/mem ADDR [SIZE] - Show memory\n");
-    printf("  disassemble/dis [ADDR] [COUNT] - Disassemble code\n");
-    printf("  quit/q          - Exit debugger\n");
-    printf("  help/?          - This help\n");
+    bebo_log(BEBO_LOG_INFO, "\nAvailable commands:\n");
+    bebo_log(BEBO_LOG_INFO, "  run/r           - Run program\n");
+    bebo_log(BEBO_LOG_INFO, "  step/s          - Execute single instruction\n");
+    bebo_log(BEBO_LOG_INFO, "  break/b ADDR    - Set breakpoint (address or label)\n");
+    bebo_log(BEBO_LOG_INFO, "  reload [FILE]   - Reassemble source and patch the running program\n");
+    bebo_log(BEBO_LOG_INFO, "  registers/reg   - Show registers\n");
+    bebo_log(BEBO_LOG_INFO, "  memory/mem ADDR [SIZE] - Show memory\n");
+    bebo_log(BEBO_LOG_INFO, "  disassemble/dis [ADDR] [COUNT] - Disassemble code\n");
+    bebo_log(BEBO_LOG_INFO, "  quit/q          - Exit debugger\n");
+    bebo_log(BEBO_LOG_INFO, "  help/?          - This help\n");
 }
\ No newline at end of file
@@ -2,12 +2,14 @@
 #include "../include/opcodes.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 
 int main(int argc, char *argv[]) {
     printf("BeboAsm Debugger - Version 1.0\nCreated by Abanoub\n\n");
     
     if (argc < 2) {
-        printf("Usage: bebodebug <binary file>\n");
+        printf("Usage: bebodebug <binary file | source.basm>\n");
         return 1;
     }
     
@@ -20,6 +22,19 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Source files are assembled in-process so 'reload' can patch them later
+    size_t len = strlen(filename);
+    if (len > 5 && strcasecmp(filename + len - 5, ".basm") == 0) {
+        if (!hotpatch_load(sim, filename)) {
+            simulator_destroy(sim);
+            return 1;
+        }
+        sim->running = true;
+        debugger_start(sim);
+        simulator_destroy(sim);
+        return 0;
+    }
+    
     // Load binary file
     FILE *file = fopen(filename, "rb");
     if (!file) {
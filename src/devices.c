@@ -0,0 +1,221 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+
+// Null device backing every unmapped port
+static uint32_t null_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim; (void)opaque; (void)port;
+    return 0;
+}
+
+static void null_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    (void)sim; (void)opaque; (void)port; (void)value;
+}
+
+static const Device null_device = {
+    "null", 0, NUM_PORTS, null_read, null_write, NULL, NULL, NULL, NULL, true, ~0ULL, 0, NULL, NULL, NULL
+};
+
+DeviceBus* device_bus_create(void) {
+    DeviceBus *bus = calloc(1, sizeof(DeviceBus));
+    if (!bus) return NULL;
+
+    // port_map is all DEVICE_NULL_SLOT already
+    bus->devices[DEVICE_NULL_SLOT] = null_device;
+    bus->device_count = 1;
+
+    return bus;
+}
+
+void device_bus_destroy(SimulatorState *sim, DeviceBus *bus) {
+    if (!bus) return;
+
+    (void)sim;
+    for (int i = 0; i < bus->device_count; i++) {
+        Device *dev = &bus->devices[i];
+        if (dev->active && dev->destroy) {
+            dev->destroy(dev->opaque);
+        }
+    }
+    free(bus);
+}
+
+void device_bus_reset(SimulatorState *sim) {
+    for (int i = 0; i < sim->bus->device_count; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (dev->active && dev->reset) {
+            dev->reset(sim, dev->opaque);
+        }
+    }
+}
+
+struct DeviceSnapshot {
+    void *state[MAX_DEVICES];
+};
+
+DeviceSnapshot* device_bus_save(SimulatorState *sim) {
+    DeviceSnapshot *snap = calloc(1, sizeof(DeviceSnapshot));
+    if (!snap) return NULL;
+
+    for (int i = 0; i < sim->bus->device_count; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (!dev->active || !dev->state_size) continue;
+        snap->state[i] = malloc(dev->state_size);
+        if (!snap->state[i]) {
+            device_snapshot_free(snap);
+            return NULL;
+        }
+        memcpy(snap->state[i], dev->opaque, dev->state_size);
+    }
+    return snap;
+}
+
+// Devices registered after the snapshot keep their current state
+void device_bus_restore(SimulatorState *sim, const DeviceSnapshot *snap) {
+    for (int i = 0; i < sim->bus->device_count; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (!dev->active || !snap->state[i]) continue;
+        if (dev->restore) {
+            dev->restore(sim, dev->opaque, snap->state[i]);
+        } else {
+            memcpy(dev->opaque, snap->state[i], dev->state_size);
+        }
+    }
+}
+
+void device_snapshot_free(DeviceSnapshot *snap) {
+    if (!snap) return;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        free(snap->state[i]);
+    }
+    free(snap);
+}
+
+void device_bus_print_stats(SimulatorState *sim) {
+    for (int i = 0; i < sim->bus->device_count; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (dev->active && dev->print_stats) {
+            dev->print_stats(sim, dev->opaque);
+        }
+    }
+}
+
+Device* device_register(SimulatorState *sim, const char *name, uint16_t base, uint32_t count,
+                        DeviceReadFn read, DeviceWriteFn write, void *opaque) {
+    if (!sim || !sim->bus || !name || count == 0) return NULL;
+
+    DeviceBus *bus = sim->bus;
+
+    if ((uint32_t)base + count > NUM_PORTS) {
+        bebo_log(BEBO_LOG_ERROR, "Device '%s': port range 0x%04X+%u out of range\n", name, base, count);
+        return NULL;
+    }
+
+    // Reject overlapping ranges
+    for (uint32_t port = base; port < (uint32_t)base + count; port++) {
+        if (bus->port_map[port] != DEVICE_NULL_SLOT) {
+            bebo_log(BEBO_LOG_ERROR, "Device '%s': port 0x%04X already owned by '%s'\n",
+                     name, port, bus->devices[bus->port_map[port]].name);
+            return NULL;
+        }
+    }
+
+    // Reuse a free slot if one exists
+    Device *dev = NULL;
+    for (int i = 0; i < bus->device_count; i++) {
+        if (!bus->devices[i].active) {
+            dev = &bus->devices[i];
+            break;
+        }
+    }
+    if (!dev) {
+        if (bus->device_count >= MAX_DEVICES) {
+            bebo_log(BEBO_LOG_ERROR, "Device table full\n");
+            return NULL;
+        }
+        dev = &bus->devices[bus->device_count++];
+    }
+
+    memset(dev, 0, sizeof(*dev));
+    strncpy(dev->name, name, sizeof(dev->name) - 1);
+    dev->base = base;
+    dev->count = count;
+    dev->read = read ? read : null_read;
+    dev->write = write ? write : null_write;
+    dev->opaque = opaque;
+    dev->active = true;
+    dev->idle_reads = read ? 0 : ~0ULL;
+
+    uint8_t slot = (uint8_t)(dev - bus->devices);
+    for (uint32_t port = base; port < (uint32_t)base + count; port++) {
+        bus->port_map[port] = slot;
+    }
+
+    return dev;
+}
+
+int device_unregister(SimulatorState *sim, Device *dev) {
+    if (!sim || !sim->bus || !dev || !dev->active) return 0;
+
+    DeviceBus *bus = sim->bus;
+    uint8_t slot = (uint8_t)(dev - bus->devices);
+    if (slot == DEVICE_NULL_SLOT) return 0;
+    for (uint32_t port = dev->base; port < (uint32_t)dev->base + dev->count; port++) {
+        if (bus->port_map[port] == slot) {
+            bus->port_map[port] = DEVICE_NULL_SLOT;
+        }
+    }
+
+    if (dev->destroy) {
+        dev->destroy(dev->opaque);
+    }
+    dev->active = false;
+    return 1;
+}
+
+Device* device_find(SimulatorState *sim, const char *name) {
+    if (!sim || !sim->bus || !name) return NULL;
+
+    for (int i = 0; i < sim->bus->device_count; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (dev->active && strcmp(dev->name, name) == 0) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+// ==========================================
+// Built-in Devices
+// ==========================================
+
+// Character output (stdout port, display, printer)
+static void char_out_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    (void)sim; (void)port;
+    FILE *out = opaque ? (FILE *)opaque : stdout;
+    fputc((char)value, out);
+    fflush(out);
+}
+
+// Stub ATA disk: writes ignored, status always reports DRV_READY
+static uint32_t ata_stub_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim; (void)opaque;
+    if (port == PORT_ATA_BASE + 7) {
+        return 0x40; // DRV_READY
+    }
+    return 0;
+}
+
+void devices_register_builtin(SimulatorState *sim) {
+    device_register(sim, "stdout", PORT_STDOUT, 1, NULL, char_out_write, NULL);
+    interrupt_controller_attach(sim);
+    timer_attach(sim);
+    rtc_attach(sim);
+    Device *ata = device_register(sim, "ata", PORT_ATA_BASE, PORT_ATA_COUNT, ata_stub_read, NULL, NULL);
+    if (ata) ata->idle_reads = ~0ULL;
+    device_register(sim, "display", PORT_DISPLAY, 1, NULL, char_out_write, NULL);
+    framebuffer_attach(sim);
+    device_register(sim, "printer", PORT_PRINTER, 1, NULL, char_out_write, stderr);
+    device_register(sim, "keyboard", PORT_KEYBOARD, 1, NULL, NULL, NULL);
+    device_register(sim, "mouse", PORT_MOUSE, 1, NULL, NULL, NULL);
+    dma_attach(sim);
+}
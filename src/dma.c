@@ -0,0 +1,130 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+
+// DMA controller register offsets from PORT_DMA_BASE
+#define DMA_REG_SRC         0
+#define DMA_REG_DST         1
+#define DMA_REG_LEN         2
+#define DMA_REG_FILL        3   // Fill byte for DMA_CMD_FILL
+#define DMA_REG_CONTROL     4   // Write: command, Read: status
+
+// Control register
+#define DMA_CMD_COPY        0x01
+#define DMA_CMD_FILL        0x02
+#define DMA_CTRL_IRQ        0x80    // Raise IRQ_DMA on completion
+
+// Status register
+#define DMA_ST_DONE         0x01
+#define DMA_ST_ERROR        0x02
+
+typedef struct {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t len;
+    uint8_t fill;
+    uint8_t status;
+
+    // Statistics
+    uint64_t copies;
+    uint64_t fills;
+    uint64_t bytes;
+} DmaController;
+
+static void dma_start(SimulatorState *sim, DmaController *dma, uint32_t control) {
+    int ok;
+
+    switch (control & 0x0F) {
+        case DMA_CMD_COPY:
+            ok = memory_copy_block(sim, dma->dst, dma->src, dma->len);
+            if (ok) dma->copies++;
+            break;
+        case DMA_CMD_FILL:
+            ok = memory_fill_block(sim, dma->dst, dma->fill, dma->len);
+            if (ok) dma->fills++;
+            break;
+        default:
+            ok = 0;
+            break;
+    }
+
+    if (ok) {
+        dma->bytes += dma->len;
+        dma->status = DMA_ST_DONE;
+    } else {
+        dma->status = DMA_ST_DONE | DMA_ST_ERROR;
+    }
+
+    if (control & DMA_CTRL_IRQ) {
+        interrupt_raise(sim, IRQ_DMA);
+    }
+}
+
+static uint32_t dma_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim;
+    DmaController *dma = (DmaController *)opaque;
+
+    switch (port - PORT_DMA_BASE) {
+        case DMA_REG_SRC:     return dma->src;
+        case DMA_REG_DST:     return dma->dst;
+        case DMA_REG_LEN:     return dma->len;
+        case DMA_REG_FILL:    return dma->fill;
+        case DMA_REG_CONTROL: return dma->status;
+    }
+    return 0;
+}
+
+static void dma_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    DmaController *dma = (DmaController *)opaque;
+
+    switch (port - PORT_DMA_BASE) {
+        case DMA_REG_SRC:     dma->src = value; break;
+        case DMA_REG_DST:     dma->dst = value; break;
+        case DMA_REG_LEN:     dma->len = value; break;
+        case DMA_REG_FILL:    dma->fill = (uint8_t)value; break;
+        case DMA_REG_CONTROL: dma_start(sim, dma, value); break;
+    }
+}
+
+static void dma_reset(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    DmaController *dma = (DmaController *)opaque;
+    dma->src = dma->dst = dma->len = 0;
+    dma->fill = 0;
+    dma->status = 0;
+}
+
+static void dma_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    DmaController *dma = (DmaController *)opaque;
+    if (dma->copies == 0 && dma->fills == 0) return;
+    bebo_log(BEBO_LOG_INFO, "DMA transfers: %lu copies, %lu fills, %lu bytes\n",
+             (unsigned long)dma->copies, (unsigned long)dma->fills, (unsigned long)dma->bytes);
+}
+
+static uint64_t dma_counter(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    return ((DmaController *)opaque)->bytes;
+}
+
+static void dma_destroy(void *opaque) {
+    free(opaque);
+}
+
+int dma_attach(SimulatorState *sim) {
+    DmaController *dma = calloc(1, sizeof(DmaController));
+    if (!dma) return 0;
+
+    Device *dev = device_register(sim, "dma", PORT_DMA_BASE, PORT_DMA_COUNT, dma_read, dma_write, dma);
+    if (!dev) {
+        free(dma);
+        return 0;
+    }
+    dev->reset = dma_reset;
+    dev->idle_reads = ~0ULL;
+    dev->state_size = sizeof(DmaController);
+    dev->print_stats = dma_print_stats;
+    dev->counter = dma_counter;
+    dev->counter_name = "dma_bytes";
+    dev->destroy = dma_destroy;
+    return 1;
+}
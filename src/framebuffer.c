@@ -0,0 +1,334 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+
+// Framebuffer register offsets from PORT_FB_BASE
+#define FB_REG_ADDR         0   // Guest address of pixel 0
+#define FB_REG_WIDTH        1
+#define FB_REG_HEIGHT       2
+#define FB_REG_MODE         3   // FB_MODE_*
+#define FB_REG_CONTROL      4   // Write FB_CTRL_PRESENT to export a frame
+#define FB_REG_FRAMES       5   // Read: frames exported
+
+// Pixel formats
+#define FB_MODE_OFF         0
+#define FB_MODE_GRAY8       1   // 1 byte per pixel, grayscale
+#define FB_MODE_RGB565      2   // 2 bytes per pixel, little-endian
+#define FB_MODE_XRGB8888    3   // 4 bytes per pixel: B, G, R, X
+
+#define FB_CTRL_PRESENT     0x01
+
+#define FB_TILE_SHIFT       4   // 16x16 pixel tiles
+#define FB_MAX_DIM          4096
+
+typedef struct {
+    uint32_t address;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mode;
+
+    // Host copy of the last frame, re-encoded tile by tile
+    uint8_t *rgb;
+    uint8_t *dirty_tiles;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t bpp;
+    uint32_t pitch;
+    bool changed;               // Any tile dirtied since the last export
+
+    // Export
+    char prefix[256];
+    uint64_t interval;          // Cycles between automatic exports (0 = on demand)
+    uint32_t event_id;
+
+    // Statistics
+    uint64_t frames;
+    uint64_t tiles_encoded;
+} Framebuffer;
+
+static uint32_t fb_bytes_per_pixel(uint32_t mode) {
+    switch (mode) {
+        case FB_MODE_GRAY8:    return 1;
+        case FB_MODE_RGB565:   return 2;
+        case FB_MODE_XRGB8888: return 4;
+    }
+    return 0;
+}
+
+static void fb_mark_all(Framebuffer *fb) {
+    if (fb->dirty_tiles) {
+        memset(fb->dirty_tiles, 1, fb->tiles_x * fb->tiles_y);
+        fb->changed = true;
+    }
+}
+
+// Re-derive the geometry and the guest range watched by the write path
+static void fb_configure(SimulatorState *sim, Framebuffer *fb) {
+    free(fb->rgb);
+    free(fb->dirty_tiles);
+    fb->rgb = NULL;
+    fb->dirty_tiles = NULL;
+    sim->fb_watch.size = 0;
+
+    fb->bpp = fb_bytes_per_pixel(fb->mode);
+    if (!fb->bpp || !fb->width || !fb->height ||
+        fb->width > FB_MAX_DIM || fb->height > FB_MAX_DIM) {
+        return;
+    }
+
+    fb->pitch = fb->width * fb->bpp;
+    uint32_t size = fb->pitch * fb->height;
+    if (fb->address >= MEMORY_SIZE || size > MEMORY_SIZE - fb->address) {
+        bebo_log(BEBO_LOG_INFO, "Framebuffer out of memory range: 0x%08X+%u\n", fb->address, size);
+        return;
+    }
+
+    fb->tiles_x = (fb->width + (1 << FB_TILE_SHIFT) - 1) >> FB_TILE_SHIFT;
+    fb->tiles_y = (fb->height + (1 << FB_TILE_SHIFT) - 1) >> FB_TILE_SHIFT;
+    fb->rgb = calloc((size_t)fb->width * fb->height, 3);
+    fb->dirty_tiles = calloc(fb->tiles_x * fb->tiles_y, 1);
+    if (!fb->rgb || !fb->dirty_tiles) {
+        free(fb->rgb);
+        free(fb->dirty_tiles);
+        fb->rgb = NULL;
+        fb->dirty_tiles = NULL;
+        return;
+    }
+
+    sim->fb_watch.base = fb->address;
+    sim->fb_watch.size = size;
+    fb_mark_all(fb);
+}
+
+// Called from the memory write path for writes overlapping the framebuffer
+void framebuffer_mark_dirty(SimulatorState *sim, uint32_t address, uint32_t len) {
+    Framebuffer *fb = (Framebuffer *)sim->fb_watch.opaque;
+    if (!fb || !fb->dirty_tiles || len == 0) return;
+
+    uint32_t end = address + len - 1;
+    if (end < fb->address) return;
+
+    uint32_t first = address > fb->address ? address - fb->address : 0;
+    uint32_t last = end - fb->address;
+    if (last >= sim->fb_watch.size) last = sim->fb_watch.size - 1;
+
+    uint32_t y0 = first / fb->pitch;
+    uint32_t y1 = last / fb->pitch;
+    uint32_t tx0 = 0;
+    uint32_t tx1 = fb->tiles_x - 1;
+
+    // Writes within one row only touch the tiles they cover; anything
+    // spanning rows marks whole tile rows
+    if (y0 == y1) {
+        tx0 = ((first % fb->pitch) / fb->bpp) >> FB_TILE_SHIFT;
+        tx1 = ((last % fb->pitch) / fb->bpp) >> FB_TILE_SHIFT;
+    }
+
+    for (uint32_t ty = y0 >> FB_TILE_SHIFT; ty <= (y1 >> FB_TILE_SHIFT); ty++) {
+        memset(fb->dirty_tiles + ty * fb->tiles_x + tx0, 1, tx1 - tx0 + 1);
+    }
+    fb->changed = true;
+}
+
+static void fb_encode_tile(SimulatorState *sim, Framebuffer *fb, uint32_t tx, uint32_t ty) {
+    uint32_t x0 = tx << FB_TILE_SHIFT;
+    uint32_t y0 = ty << FB_TILE_SHIFT;
+    uint32_t x1 = x0 + (1 << FB_TILE_SHIFT);
+    uint32_t y1 = y0 + (1 << FB_TILE_SHIFT);
+    if (x1 > fb->width) x1 = fb->width;
+    if (y1 > fb->height) y1 = fb->height;
+
+    for (uint32_t y = y0; y < y1; y++) {
+        const uint8_t *src = sim->memory + fb->address + y * fb->pitch + x0 * fb->bpp;
+        uint8_t *dst = fb->rgb + ((size_t)y * fb->width + x0) * 3;
+
+        for (uint32_t x = x0; x < x1; x++, src += fb->bpp, dst += 3) {
+            switch (fb->mode) {
+                case FB_MODE_GRAY8:
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    break;
+                case FB_MODE_RGB565: {
+                    uint16_t p = src[0] | (src[1] << 8);
+                    dst[0] = (uint8_t)(((p >> 11) & 0x1F) * 255 / 31);
+                    dst[1] = (uint8_t)(((p >> 5) & 0x3F) * 255 / 63);
+                    dst[2] = (uint8_t)((p & 0x1F) * 255 / 31);
+                    break;
+                }
+                case FB_MODE_XRGB8888:
+                    dst[0] = src[2];
+                    dst[1] = src[1];
+                    dst[2] = src[0];
+                    break;
+            }
+        }
+    }
+    fb->tiles_encoded++;
+}
+
+// Re-encode dirty tiles into the host frame and write it as a binary PPM.
+// Returns 1 if a file was written.
+static int fb_export(SimulatorState *sim, Framebuffer *fb, bool force) {
+    if (!fb->rgb || !fb->prefix[0]) return 0;
+    if (!fb->changed && !force) return 0;
+
+    for (uint32_t ty = 0; ty < fb->tiles_y; ty++) {
+        for (uint32_t tx = 0; tx < fb->tiles_x; tx++) {
+            uint8_t *dirty = &fb->dirty_tiles[ty * fb->tiles_x + tx];
+            if (*dirty) {
+                fb_encode_tile(sim, fb, tx, ty);
+                *dirty = 0;
+            }
+        }
+    }
+    fb->changed = false;
+
+    char path[300];
+    snprintf(path, sizeof(path), "%s%05lu.ppm", fb->prefix, (unsigned long)fb->frames);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        bebo_log(BEBO_LOG_ERROR, "Framebuffer: cannot write '%s'\n", path);
+        return 0;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", fb->width, fb->height);
+    fwrite(fb->rgb, 3, (size_t)fb->width * fb->height, file);
+    fclose(file);
+
+    fb->frames++;
+    return 1;
+}
+
+static void fb_tick(SimulatorState *sim, void *opaque) {
+    Framebuffer *fb = (Framebuffer *)opaque;
+    fb_export(sim, fb, false);
+    fb->event_id = event_schedule_observer(sim, sim->clock_cycles + fb->interval, fb_tick, fb);
+}
+
+static uint32_t fb_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim;
+    Framebuffer *fb = (Framebuffer *)opaque;
+
+    switch (port - PORT_FB_BASE) {
+        case FB_REG_ADDR:    return fb->address;
+        case FB_REG_WIDTH:   return fb->width;
+        case FB_REG_HEIGHT:  return fb->height;
+        case FB_REG_MODE:    return fb->mode;
+        case FB_REG_FRAMES:  return (uint32_t)fb->frames;
+    }
+    return 0;
+}
+
+static void fb_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    Framebuffer *fb = (Framebuffer *)opaque;
+
+    switch (port - PORT_FB_BASE) {
+        case FB_REG_ADDR:
+            fb->address = value;
+            fb_configure(sim, fb);
+            break;
+        case FB_REG_WIDTH:
+            fb->width = value;
+            fb_configure(sim, fb);
+            break;
+        case FB_REG_HEIGHT:
+            fb->height = value;
+            fb_configure(sim, fb);
+            break;
+        case FB_REG_MODE:
+            fb->mode = value;
+            fb_configure(sim, fb);
+            break;
+        case FB_REG_CONTROL:
+            if (value & FB_CTRL_PRESENT) fb_export(sim, fb, true);
+            break;
+    }
+}
+
+static void fb_reset(SimulatorState *sim, void *opaque) {
+    Framebuffer *fb = (Framebuffer *)opaque;
+    fb->mode = FB_MODE_OFF;
+    fb_configure(sim, fb);
+}
+
+// Registers and export schedule come from the snapshot; the host copy is
+// rebuilt (or just marked dirty) so it never points at freed buffers.
+static void fb_restore(SimulatorState *sim, void *opaque, const void *saved) {
+    Framebuffer *fb = (Framebuffer *)opaque;
+    const Framebuffer *old = (const Framebuffer *)saved;
+    bool same = fb->address == old->address && fb->width == old->width &&
+                fb->height == old->height && fb->mode == old->mode;
+
+    fb->address = old->address;
+    fb->width = old->width;
+    fb->height = old->height;
+    fb->mode = old->mode;
+    fb->interval = old->interval;
+    fb->event_id = old->event_id;
+    fb->frames = old->frames;
+    fb->tiles_encoded = old->tiles_encoded;
+
+    if (same && fb->rgb) {
+        fb_mark_all(fb);
+    } else {
+        fb_configure(sim, fb);
+    }
+}
+
+static void fb_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    Framebuffer *fb = (Framebuffer *)opaque;
+    if (fb->frames) {
+        bebo_log(BEBO_LOG_INFO, "Framebuffer frames: %lu (%lu tiles encoded)\n",
+                 (unsigned long)fb->frames, (unsigned long)fb->tiles_encoded);
+    }
+}
+
+static void fb_destroy(void *opaque) {
+    Framebuffer *fb = (Framebuffer *)opaque;
+    free(fb->rgb);
+    free(fb->dirty_tiles);
+    free(fb);
+}
+
+int framebuffer_attach(SimulatorState *sim) {
+    Framebuffer *fb = calloc(1, sizeof(Framebuffer));
+    if (!fb) return 0;
+
+    fb->width = 320;
+    fb->height = 200;
+
+    Device *dev = device_register(sim, "framebuffer", PORT_FB_BASE, PORT_FB_COUNT, fb_read, fb_write, fb);
+    if (!dev) {
+        free(fb);
+        return 0;
+    }
+    dev->reset = fb_reset;
+    dev->restore = fb_restore;
+    dev->state_size = sizeof(Framebuffer);
+    dev->idle_reads = ~0ULL;
+    dev->print_stats = fb_print_stats;
+    dev->destroy = fb_destroy;
+
+    sim->fb_watch.opaque = fb;
+    sim->fb_watch.size = 0;
+    return 1;
+}
+
+// Host-side export settings: files are named <prefix>NNNNN.ppm. With a
+// non-zero interval a frame is written every 'interval' cycles, but only
+// if something was drawn since the previous one.
+int framebuffer_set_export(SimulatorState *sim, const char *prefix, uint64_t interval) {
+    Device *dev = device_find(sim, "framebuffer");
+    if (!dev) return 0;
+
+    Framebuffer *fb = (Framebuffer *)dev->opaque;
+    snprintf(fb->prefix, sizeof(fb->prefix), "%s", prefix ? prefix : "");
+
+    if (fb->event_id) {
+        event_cancel(sim, fb->event_id);
+        fb->event_id = 0;
+    }
+    fb->interval = interval;
+    if (interval) {
+        fb->event_id = event_schedule_observer(sim, sim->clock_cycles + interval, fb_tick, fb);
+    }
+    return 1;
+}
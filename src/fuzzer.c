@@ -0,0 +1,588 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include "../include/fuzzer.h"
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FUZZ_HAVOC_ROUNDS       256     // Mutated test cases per queue entry visit
+#define FUZZ_HAVOC_STACK_POW    4       // Up to 2^4 mutations stacked per test case
+#define FUZZ_BLOCK_MAX          64      // Largest block inserted or deleted
+#define FUZZ_SYNC_EXECS         50000   // Test cases between corpus syncs
+#define FUZZ_MAX_PEERS          64
+
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t id;
+} FuzzEntry;
+
+// Another fuzzer's directory under the same output dir, and the next
+// queue id not yet imported from it
+typedef struct {
+    char name[64];
+    uint32_t next_id;
+} FuzzPeer;
+
+struct Fuzzer {
+    SimulatorState *sim;
+    FuzzConfig config;
+
+    // Snapshot: the whole CPU state, a copy of guest memory, pending
+    // events and device registers. Only pages the guest dirtied are
+    // copied back on reset.
+    SimulatorState state;
+    uint8_t *memory;
+    EventQueue *events;
+    DeviceSnapshot *devices;
+    int fds[SEMIHOST_MAX_FILES];        // Private dups of the open semihost files
+    off_t offsets[SEMIHOST_MAX_FILES];
+
+    uint8_t *trace;             // Coverage map currently in use
+    uint8_t *own_trace;
+
+    // Port injection
+    const uint8_t *input;
+    uint32_t input_len;
+    uint32_t input_pos;
+
+    // Worker state
+    uint64_t rng;
+    FuzzEntry *queue;
+    int queue_count;
+    int queue_cap;
+    uint32_t crash_count;
+    uint32_t hang_count;
+    FuzzPeer peers[FUZZ_MAX_PEERS];
+    int peer_count;
+    char name[32];
+    char dir[512];
+};
+
+static const int8_t interesting8[] = {-128, -1, 0, 1, 16, 32, 64, 100, 127};
+static const int16_t interesting16[] = {-32768, -129, 128, 255, 256, 512, 1000, 1024, 4096, 32767};
+
+// AFL's hit count buckets: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+static uint8_t count_class[256];
+
+static void fuzz_init_classes(void) {
+    for (int i = 0; i < 256; i++) {
+        if (i == 0)        count_class[i] = 0;
+        else if (i == 1)   count_class[i] = 1;
+        else if (i == 2)   count_class[i] = 2;
+        else if (i == 3)   count_class[i] = 4;
+        else if (i < 8)    count_class[i] = 8;
+        else if (i < 16)   count_class[i] = 16;
+        else if (i < 32)   count_class[i] = 32;
+        else if (i < 128)  count_class[i] = 64;
+        else               count_class[i] = 128;
+    }
+}
+
+// ==========================================
+// Snapshot and Execution
+// ==========================================
+
+static uint32_t fuzz_port_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    Fuzzer *fz = (Fuzzer *)opaque;
+    (void)sim;
+
+    if (port == fz->config.port + 1) {
+        return fz->input_len - fz->input_pos;
+    }
+    if (fz->input_pos >= fz->input_len) return 0xFFFFFFFF;
+    return fz->input[fz->input_pos++];
+}
+
+Fuzzer* fuzzer_create(SimulatorState *sim, const FuzzConfig *config) {
+    Fuzzer *fz = calloc(1, sizeof(Fuzzer));
+    if (!fz) return NULL;
+
+    for (int i = 0; i < SEMIHOST_MAX_FILES; i++) {
+        fz->fds[i] = -1;
+    }
+    fz->sim = sim;
+    fz->config = *config;
+    fz->memory = malloc(MEMORY_SIZE);
+    fz->own_trace = calloc(COVERAGE_MAP_SIZE, 1);
+    if (!fz->memory || !fz->own_trace) {
+        fuzzer_destroy(fz);
+        return NULL;
+    }
+
+    if (config->use_port &&
+        !device_register(sim, "fuzz-input", config->port, 2, fuzz_port_read, NULL, fz)) {
+        fuzzer_destroy(fz);
+        return NULL;
+    }
+
+    memcpy(fz->memory, sim->memory, MEMORY_SIZE);
+    memory_clear_dirty(sim);
+    fz->events = event_queue_save(sim);
+    fz->devices = device_bus_save(sim);
+    if (!fz->events || !fz->devices) {
+        fuzzer_destroy(fz);
+        return NULL;
+    }
+
+    fz->trace = fz->own_trace;
+    sim->coverage = fz->trace;
+    sim->coverage_prev = 0;
+    sim->stop_on_marker = true;
+    memcpy(&fz->state, sim, sizeof(SimulatorState));
+
+    // The guest may close, seek or reuse these during a run, so keep
+    // copies of our own to hand back on every reset
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        if (sim->semihost_fds[i] < 0) continue;
+        fz->fds[i] = dup(sim->semihost_fds[i]);
+        fz->offsets[i] = lseek(sim->semihost_fds[i], 0, SEEK_CUR);
+        if (fz->fds[i] < 0) {
+            fuzzer_destroy(fz);
+            return NULL;
+        }
+    }
+
+    fz->rng = host_monotonic_ns() | 1;
+    return fz;
+}
+
+void fuzzer_destroy(Fuzzer *fz) {
+    if (!fz) return;
+    for (int i = 0; i < fz->queue_count; i++) {
+        free(fz->queue[i].data);
+    }
+    free(fz->queue);
+    free(fz->memory);
+    free(fz->own_trace);
+    event_queue_destroy(fz->events);
+    device_snapshot_free(fz->devices);
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        if (fz->fds[i] >= 0) close(fz->fds[i]);
+    }
+    free(fz);
+}
+
+uint8_t* fuzzer_trace(Fuzzer *fz) {
+    return fz->trace;
+}
+
+// Record coverage somewhere else, e.g. AFL's shared memory segment
+void fuzzer_set_trace(Fuzzer *fz, uint8_t *map) {
+    fz->trace = map;
+    fz->state.coverage = map;
+    fz->sim->coverage = map;
+}
+
+static void fuzz_restore(Fuzzer *fz) {
+    SimulatorState *sim = fz->sim;
+
+    for (uint32_t word = 0; word < NUM_PAGES / 64; word++) {
+        uint64_t bits = sim->dirty_pages[word];
+        while (bits) {
+            uint32_t page = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            memcpy(sim->memory + ((size_t)page << PAGE_SHIFT),
+                   fz->memory + ((size_t)page << PAGE_SHIFT), PAGE_SIZE);
+        }
+    }
+
+    // Every file open at the end of the run goes, including the
+    // snapshot's own: the guest may have closed and reused their slots
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        if (sim->semihost_fds[i] >= 0) {
+            close(sim->semihost_fds[i]);
+        }
+    }
+
+    // Registers, flags, counters and a clean dirty bitmap in one copy,
+    // then the events and devices, which recompute the event deadline
+    memcpy(sim, &fz->state, sizeof(SimulatorState));
+    event_queue_restore(sim, fz->events);
+    device_bus_restore(sim, fz->devices);
+
+    // Fresh handles on the snapshot's files, rewound to where they were.
+    // Dups share the file offset, hence the seek.
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        if (fz->fds[i] < 0) continue;
+        sim->semihost_fds[i] = dup(fz->fds[i]);
+        if (fz->offsets[i] >= 0) lseek(fz->fds[i], fz->offsets[i], SEEK_SET);
+    }
+}
+
+FuzzResult fuzzer_exec(Fuzzer *fz, const uint8_t *data, uint32_t len) {
+    SimulatorState *sim = fz->sim;
+    fuzz_restore(fz);
+
+    if (fz->config.use_buffer) {
+        uint32_t n = len < fz->config.buffer_size ? len : fz->config.buffer_size;
+        memory_write_block(sim, fz->config.buffer_addr, data, n);
+        sim->registers[0] = n;
+        sim->registers[1] = fz->config.buffer_addr;
+    }
+    if (fz->config.use_port) {
+        fz->input = data;
+        fz->input_len = len;
+        fz->input_pos = 0;
+    }
+
+    memset(fz->trace, 0, COVERAGE_MAP_SIZE);
+
+    StopReason reason;
+    if (!simulator_run_for(sim, fz->config.budget, &reason)) {
+        return FUZZ_CRASH;
+    }
+    return reason == STOP_BUDGET ? FUZZ_HANG : FUZZ_OK;
+}
+
+// ==========================================
+// Coverage
+// ==========================================
+
+static void fuzz_classify(uint8_t *trace) {
+    uint64_t *words = (uint64_t *)trace;
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++) {
+        if (!words[i]) continue;
+        uint8_t *b = (uint8_t *)&words[i];
+        for (int j = 0; j < 8; j++) b[j] = count_class[b[j]];
+    }
+}
+
+// 2 if the trace hit an edge never seen before, 1 if only a new hit
+// count bucket, 0 otherwise. Clears the seen bits in the shared map.
+static int fuzz_has_new_bits(_Atomic uint64_t *virgin, const uint8_t *trace) {
+    const uint64_t *words = (const uint64_t *)trace;
+    int result = 0;
+
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++) {
+        uint64_t cur = words[i];
+        if (!cur || !(cur & atomic_load_explicit(&virgin[i], memory_order_relaxed))) continue;
+
+        uint64_t old = atomic_fetch_and_explicit(&virgin[i], ~cur, memory_order_relaxed);
+        if (!(cur & old)) continue;     // Another worker got there first
+
+        if (!result) result = 1;
+        for (int j = 0; j < 64; j += 8) {
+            if (((cur >> j) & 0xFF) && ((old >> j) & 0xFF) == 0xFF) {
+                result = 2;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// ==========================================
+// Mutation
+// ==========================================
+
+static uint32_t fuzz_rand(Fuzzer *fz, uint32_t limit) {
+    // xorshift64*
+    fz->rng ^= fz->rng >> 12;
+    fz->rng ^= fz->rng << 25;
+    fz->rng ^= fz->rng >> 27;
+    uint64_t value = fz->rng * 0x2545F4914F6CDD1DULL;
+    return limit ? (uint32_t)((value >> 32) % limit) : 0;
+}
+
+static uint32_t fuzz_min(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+// AFL-style havoc: a random stack of small mutations of one queue entry
+static uint32_t fuzz_havoc(Fuzzer *fz, int index, uint8_t *out) {
+    FuzzEntry *src = &fz->queue[index];
+    uint32_t max = fz->config.max_len;
+    uint32_t len = fuzz_min(src->len, max);
+
+    memcpy(out, src->data, len);
+    if (len == 0) {
+        out[0] = 0;
+        len = 1;
+    }
+
+    uint32_t stack = 1u << (1 + fuzz_rand(fz, FUZZ_HAVOC_STACK_POW));
+    for (uint32_t s = 0; s < stack; s++) {
+        switch (fuzz_rand(fz, 9)) {
+            case 0: {   // Flip a bit
+                uint32_t bit = fuzz_rand(fz, len * 8);
+                out[bit >> 3] ^= 0x80 >> (bit & 7);
+                break;
+            }
+            case 1:     // Interesting byte
+                out[fuzz_rand(fz, len)] = (uint8_t)interesting8[fuzz_rand(fz, sizeof(interesting8))];
+                break;
+            case 2:     // Interesting little-endian word
+                if (len >= 2) {
+                    uint32_t pos = fuzz_rand(fz, len - 1);
+                    uint16_t value = (uint16_t)interesting16[fuzz_rand(fz, sizeof(interesting16) / 2)];
+                    out[pos] = value & 0xFF;
+                    out[pos + 1] = value >> 8;
+                }
+                break;
+            case 3:     // Add
+                out[fuzz_rand(fz, len)] += 1 + fuzz_rand(fz, 35);
+                break;
+            case 4:     // Subtract
+                out[fuzz_rand(fz, len)] -= 1 + fuzz_rand(fz, 35);
+                break;
+            case 5:     // Random byte
+                out[fuzz_rand(fz, len)] ^= 1 + fuzz_rand(fz, 255);
+                break;
+            case 6:     // Delete a block
+                if (len >= 2) {
+                    uint32_t del = 1 + fuzz_rand(fz, fuzz_min(len - 1, FUZZ_BLOCK_MAX));
+                    uint32_t pos = fuzz_rand(fz, len - del + 1);
+                    memmove(out + pos, out + pos + del, len - pos - del);
+                    len -= del;
+                }
+                break;
+            case 7:     // Insert a cloned or constant block
+                if (len < max) {
+                    uint8_t block[FUZZ_BLOCK_MAX];
+                    uint32_t size = 1 + fuzz_rand(fz, fuzz_min(fuzz_min(len, max - len), FUZZ_BLOCK_MAX));
+                    if (fuzz_rand(fz, 4)) {
+                        memcpy(block, out + fuzz_rand(fz, len - size + 1), size);
+                    } else {
+                        memset(block, fuzz_rand(fz, 256), size);
+                    }
+                    uint32_t to = fuzz_rand(fz, len + 1);
+                    memmove(out + to + size, out + to, len - to);
+                    memcpy(out + to, block, size);
+                    len += size;
+                }
+                break;
+            case 8:     // Splice the tail of another entry
+                if (fz->queue_count > 1) {
+                    FuzzEntry *other = &fz->queue[fuzz_rand(fz, fz->queue_count)];
+                    uint32_t common = fuzz_min(len, other->len);
+                    if (common >= 2) {
+                        uint32_t cut = 1 + fuzz_rand(fz, common - 1);
+                        uint32_t tail = fuzz_min(other->len, max) - cut;
+                        memcpy(out + cut, other->data + cut, tail);
+                        len = cut + tail;
+                    }
+                }
+                break;
+        }
+    }
+    return len;
+}
+
+// ==========================================
+// Corpus (AFL directory layout)
+// ==========================================
+
+static void fuzz_mkdir(const char *path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        bebo_log(BEBO_LOG_ERROR, "bebofuzz: cannot create %s: %s\n", path, strerror(errno));
+    }
+}
+
+static uint8_t* fuzz_read_file(const char *path, uint32_t *len) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    uint8_t *data = malloc(FUZZ_MAX_INPUT);
+    if (data) {
+        *len = (uint32_t)fread(data, 1, FUZZ_MAX_INPUT, file);
+    }
+    fclose(file);
+    return data;
+}
+
+static void fuzz_save(Fuzzer *fz, const char *subdir, const char *name, const uint8_t *data, uint32_t len) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s/%s", fz->dir, subdir, name);
+    FILE *file = fopen(path, "wb");
+    if (!file) return;
+    fwrite(data, 1, len, file);
+    fclose(file);
+}
+
+static void fuzz_queue_add(Fuzzer *fz, const uint8_t *data, uint32_t len, const char *origin, bool new_edge) {
+    if (fz->queue_count == fz->queue_cap) {
+        int cap = fz->queue_cap ? fz->queue_cap * 2 : 64;
+        FuzzEntry *grown = realloc(fz->queue, cap * sizeof(FuzzEntry));
+        if (!grown) return;
+        fz->queue = grown;
+        fz->queue_cap = cap;
+    }
+
+    FuzzEntry *entry = &fz->queue[fz->queue_count];
+    entry->data = malloc(len ? len : 1);
+    if (!entry->data) return;
+    memcpy(entry->data, data, len);
+    entry->len = len;
+    entry->id = (uint32_t)fz->queue_count++;
+
+    char name[256];
+    snprintf(name, sizeof(name), "id:%06u,%s%s", entry->id, origin, new_edge ? ",+cov" : "");
+    fuzz_save(fz, "queue", name, data, len);
+}
+
+// Run one test case and keep it if it found something. 'origin' is the
+// AFL-style provenance suffix (orig:..., src:..., sync:...).
+static void fuzz_evaluate(Fuzzer *fz, FuzzShared *shared, const uint8_t *data, uint32_t len,
+                          const char *origin, bool keep) {
+    FuzzResult result = fuzzer_exec(fz, data, len);
+    fuzz_classify(fz->trace);
+
+    char name[256];
+    switch (result) {
+        case FUZZ_OK: {
+            int found = fuzz_has_new_bits(shared->virgin, fz->trace);
+            if (found || keep) {
+                fuzz_queue_add(fz, data, len, origin, found == 2);
+            }
+            break;
+        }
+        case FUZZ_CRASH:
+            if (fuzz_has_new_bits(shared->virgin_crash, fz->trace)) {
+                snprintf(name, sizeof(name), "id:%06u,sig:06,%s", fz->crash_count++, origin);
+                fuzz_save(fz, "crashes", name, data, len);
+            }
+            break;
+        case FUZZ_HANG:
+            if (fuzz_has_new_bits(shared->virgin_tmout, fz->trace)) {
+                snprintf(name, sizeof(name), "id:%06u,%s", fz->hang_count++, origin);
+                fuzz_save(fz, "hangs", name, data, len);
+            }
+            break;
+    }
+}
+
+// Run every file in 'dir' whose AFL id is at least *next_id (all files
+// if next_id is NULL), keeping the ones that add coverage.
+static void fuzz_import_dir(Fuzzer *fz, FuzzShared *shared, const char *dir, const char *peer,
+                            uint32_t *next_id) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    uint32_t highest = next_id ? *next_id : 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+
+        unsigned int id = 0;
+        if (next_id && (sscanf(ent->d_name, "id:%u", &id) != 1 || id < *next_id)) continue;
+
+        char path[1024];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        uint32_t len = 0;
+        uint8_t *data = fuzz_read_file(path, &len);
+        if (!data) continue;
+
+        char origin[256];
+        if (peer) {
+            snprintf(origin, sizeof(origin), "sync:%s,src:%06u", peer, id);
+        } else {
+            snprintf(origin, sizeof(origin), "orig:%.200s", ent->d_name);
+        }
+        fuzz_evaluate(fz, shared, data, len, origin, peer == NULL);
+        free(data);
+
+        if (next_id && id + 1 > highest) highest = id + 1;
+    }
+    closedir(d);
+
+    if (next_id) *next_id = highest;
+}
+
+// Pull new queue entries from every other fuzzer under out_dir (other
+// bebofuzz workers or AFL instances using -o with the same directory)
+static void fuzz_sync(Fuzzer *fz, FuzzShared *shared, const char *out_dir) {
+    DIR *d = opendir(out_dir);
+    if (!d) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.' || strcmp(ent->d_name, fz->name) == 0) continue;
+        if (strlen(ent->d_name) >= sizeof(fz->peers[0].name)) continue;
+
+        FuzzPeer *peer = NULL;
+        for (int i = 0; i < fz->peer_count; i++) {
+            if (strcmp(fz->peers[i].name, ent->d_name) == 0) peer = &fz->peers[i];
+        }
+        if (!peer) {
+            if (fz->peer_count >= FUZZ_MAX_PEERS) continue;
+            peer = &fz->peers[fz->peer_count++];
+            strcpy(peer->name, ent->d_name);
+            peer->next_id = 0;
+        }
+
+        char queue[1024];
+        snprintf(queue, sizeof(queue), "%s/%s/queue", out_dir, ent->d_name);
+        fuzz_import_dir(fz, shared, queue, peer->name, &peer->next_id);
+    }
+    closedir(d);
+}
+
+// ==========================================
+// Worker Loop
+// ==========================================
+
+void fuzzer_worker(Fuzzer *fz, FuzzShared *shared, int id, const char *in_dir,
+                   const char *out_dir, uint64_t max_execs, volatile sig_atomic_t *stop) {
+    char path[1024];
+
+    fuzz_init_classes();
+    fz->rng = (host_monotonic_ns() ^ ((uint64_t)id << 40)) | 1;
+
+    snprintf(fz->name, sizeof(fz->name), "bebofuzz%02d", id);
+    snprintf(fz->dir, sizeof(fz->dir), "%s/%s", out_dir, fz->name);
+    fuzz_mkdir(fz->dir);
+    snprintf(path, sizeof(path), "%s/queue", fz->dir);
+    fuzz_mkdir(path);
+    snprintf(path, sizeof(path), "%s/crashes", fz->dir);
+    fuzz_mkdir(path);
+    snprintf(path, sizeof(path), "%s/hangs", fz->dir);
+    fuzz_mkdir(path);
+
+    if (in_dir) {
+        fuzz_import_dir(fz, shared, in_dir, NULL, NULL);
+    }
+    if (fz->queue_count == 0) {
+        uint8_t seed = 0;
+        fuzz_evaluate(fz, shared, &seed, 1, "orig:empty", true);
+    }
+
+    uint8_t *buf = malloc(fz->config.max_len + FUZZ_BLOCK_MAX);
+    if (!buf || fz->queue_count == 0) {
+        free(buf);
+        return;
+    }
+
+    uint64_t execs = 0;
+    uint64_t last_sync = 0;
+    int current = 0;
+
+    while (!*stop && (!max_execs || execs < max_execs)) {
+        char origin[64];
+        snprintf(origin, sizeof(origin), "src:%06u,op:havoc", fz->queue[current].id);
+
+        for (int round = 0; round < FUZZ_HAVOC_ROUNDS && !*stop; round++) {
+            uint32_t len = fuzz_havoc(fz, current, buf);
+            fuzz_evaluate(fz, shared, buf, len, origin, false);
+            if (++execs == max_execs) break;
+        }
+
+        if (execs - last_sync >= FUZZ_SYNC_EXECS) {
+            fuzz_sync(fz, shared, out_dir);
+            last_sync = execs;
+        }
+
+        atomic_store_explicit(&shared->workers[id].execs, execs, memory_order_relaxed);
+        atomic_store_explicit(&shared->workers[id].paths, fz->queue_count, memory_order_relaxed);
+        atomic_store_explicit(&shared->workers[id].crashes, fz->crash_count, memory_order_relaxed);
+        atomic_store_explicit(&shared->workers[id].hangs, fz->hang_count, memory_order_relaxed);
+
+        current = (current + 1) % fz->queue_count;
+    }
+
+    free(buf);
+}
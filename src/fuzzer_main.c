@@ -0,0 +1,349 @@
+#define _GNU_SOURCE
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include "../include/fuzzer.h"
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MARKER_BUDGET       100000000ULL    // Instructions allowed to reach TRACE
+#define STATUS_INTERVAL_NS  1000000000ULL
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop_flag = 1;
+}
+
+static void quiet_log(void *user, BeboLogLevel level, const char *text) {
+    (void)user; (void)level; (void)text;
+}
+
+static void usage(void) {
+    printf("Usage: bebofuzz [options] <program.bin | program.basm> [input file]\n"
+           "  --buffer ADDR[:SIZE]  Copy each input to ADDR (address or label, default SIZE 256);\n"
+           "                        R0 = length, R1 = address\n"
+           "  --port PORT           Serve input bytes from IN PORT (0xFFFFFFFF at end),\n"
+           "                        bytes left from IN PORT+1\n"
+           "  --no-marker           Snapshot at the entry point instead of the first TRACE\n"
+           "  -i DIR                Seed corpus (one test case per file)\n"
+           "  -o DIR                Output directory (default fuzz-out)\n"
+           "  -j N                  Worker processes (default: one per core)\n"
+           "  -t N                  Instructions per test case before it is a hang (default 100000)\n"
+           "  -l N                  Longest generated input (default 1024)\n"
+           "  -n N                  Test cases per worker (default: until interrupted)\n"
+           "  -T SECONDS            Stop after this long\n"
+           "With an input file, runs that one test case and reports the result. If\n"
+           "__AFL_SHM_ID is set, coverage goes to AFL's map and a guest fault aborts.\n");
+}
+
+static int load_program(SimulatorState *sim, const char *path) {
+    size_t len = strlen(path);
+    if (len > 5 && strcasecmp(path + len - 5, ".basm") == 0) {
+        return hotpatch_load(sim, path);
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+        return 0;
+    }
+    size_t read_size = fread(sim->memory, 1, MEMORY_SIZE, file);
+    fclose(file);
+    if (read_size == 0) {
+        fprintf(stderr, "Error: '%s' is empty\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// ADDR[:SIZE], ADDR being a number or (for .basm programs) a label
+static int parse_buffer(SimulatorState *sim, const char *spec, FuzzConfig *config) {
+    char addr[128];
+    unsigned long size = 256;
+
+    snprintf(addr, sizeof(addr), "%s", spec);
+    char *colon = strchr(addr, ':');
+    if (colon) {
+        *colon = '\0';
+        size = strtoul(colon + 1, NULL, 0);
+    }
+
+    uint32_t address;
+    if (addr[0] >= '0' && addr[0] <= '9') {
+        address = (uint32_t)strtoul(addr, NULL, 0);
+    } else if (!hotpatch_symbol_address(sim, addr, &address)) {
+        fprintf(stderr, "Error: Unknown buffer label '%s'\n", addr);
+        return 0;
+    }
+
+    if (size == 0 || address >= MEMORY_SIZE || size > MEMORY_SIZE - address) {
+        fprintf(stderr, "Error: Buffer 0x%X+%lu outside guest memory\n", address, size);
+        return 0;
+    }
+
+    config->use_buffer = true;
+    config->buffer_addr = address;
+    config->buffer_size = (uint32_t)size;
+    return 1;
+}
+
+// Single test case, for reproducing crashes or running under afl-fuzz
+static int run_one(Fuzzer *fz, SimulatorState *sim, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open input '%s'\n", path);
+        return 1;
+    }
+    uint8_t *data = malloc(FUZZ_MAX_INPUT);
+    uint32_t len = data ? (uint32_t)fread(data, 1, FUZZ_MAX_INPUT, file) : 0;
+    fclose(file);
+
+    const char *shm_id = getenv("__AFL_SHM_ID");
+    if (shm_id) {
+        void *map = shmat(atoi(shm_id), NULL, 0);
+        if (map == (void *)-1) {
+            fprintf(stderr, "Error: Cannot attach __AFL_SHM_ID %s\n", shm_id);
+            return 1;
+        }
+        fuzzer_set_trace(fz, (uint8_t *)map);
+    }
+
+    FuzzResult result = fuzzer_exec(fz, data, len);
+    free(data);
+
+    if (shm_id) {
+        if (result == FUZZ_CRASH) abort();
+        return 0;
+    }
+
+    uint8_t *trace = fuzzer_trace(fz);
+    uint32_t edges = 0;
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE; i++) {
+        if (trace[i]) edges++;
+    }
+    static const char *names[] = {"ok", "crash", "hang"};
+    printf("\n[bebofuzz] %s after %lu instructions, %u edges, PC=0x%04X\n", names[result],
+           (unsigned long)sim->instructions_executed, edges, sim->pc);
+    return (int)result;
+}
+
+static void print_status(FuzzShared *shared, int workers, double seconds, uint64_t *last_execs,
+                         double *last_seconds) {
+    uint64_t execs = 0, paths = 0, crashes = 0, hangs = 0;
+    for (int i = 0; i < workers; i++) {
+        execs += atomic_load(&shared->workers[i].execs);
+        paths += atomic_load(&shared->workers[i].paths);
+        crashes += atomic_load(&shared->workers[i].crashes);
+        hangs += atomic_load(&shared->workers[i].hangs);
+    }
+
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++) {
+        uint64_t word = atomic_load_explicit(&shared->virgin[i], memory_order_relaxed);
+        for (int j = 0; j < 64; j += 8) {
+            if (((word >> j) & 0xFF) != 0xFF) seen++;
+        }
+    }
+
+    double rate = seconds > *last_seconds ? (execs - *last_execs) / (seconds - *last_seconds) : 0;
+    fprintf(stderr, "[bebofuzz] %6.0fs  %lu execs (%.0f/s)  %lu paths  %lu crashes  %lu hangs  map %.2f%%\n",
+            seconds, (unsigned long)execs, rate, (unsigned long)paths, (unsigned long)crashes,
+            (unsigned long)hangs, seen * 100.0 / COVERAGE_MAP_SIZE);
+    *last_execs = execs;
+    *last_seconds = seconds;
+}
+
+int main(int argc, char *argv[]) {
+    const char *program = NULL;
+    const char *input = NULL;
+    const char *buffer_spec = NULL;
+    const char *in_dir = NULL;
+    const char *out_dir = "fuzz-out";
+    long port = -1;
+    bool marker = true;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t max_execs = 0;
+    unsigned int time_limit = 0;
+
+    FuzzConfig config = {0};
+    config.budget = 100000;
+    config.max_len = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--buffer") == 0 && i + 1 < argc) {
+            buffer_spec = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--no-marker") == 0) {
+            marker = false;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            in_dir = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            config.budget = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            config.max_len = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_execs = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            time_limit = (unsigned int)atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        } else if (!program) {
+            program = argv[i];
+        } else {
+            input = argv[i];
+        }
+    }
+
+    if (!program || (!buffer_spec && port < 0)) {
+        usage();
+        return 1;
+    }
+    if (port > 0xFFFE || config.max_len == 0 || config.max_len > FUZZ_MAX_INPUT) {
+        fprintf(stderr, "Error: Invalid --port or -l\n");
+        return 1;
+    }
+    if (jobs < 1) jobs = 1;
+    if (jobs > FUZZ_MAX_WORKERS) jobs = FUZZ_MAX_WORKERS;
+
+    SimulatorState *sim = simulator_create(NULL);
+    if (!sim) {
+        fprintf(stderr, "Error: Failed to create simulator\n");
+        return 1;
+    }
+    sim->running = true;
+
+    if (!load_program(sim, program) || (buffer_spec && !parse_buffer(sim, buffer_spec, &config))) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    if (port >= 0) {
+        config.use_port = true;
+        config.port = (uint16_t)port;
+    }
+
+    // Campaigns run silently; a single test case keeps the guest's console
+    if (!input) {
+        const char *outputs[] = {"stdout", "display", "printer"};
+        for (int i = 0; i < 3; i++) {
+            Device *dev = device_find(sim, outputs[i]);
+            if (dev) device_unregister(sim, dev);
+        }
+    }
+
+    // Run the setup code once; everything up to TRACE is shared by all test cases
+    if (marker) {
+        StopReason reason;
+        sim->stop_on_marker = true;
+        if (!simulator_run_for(sim, MARKER_BUDGET, &reason) || reason != STOP_MARKER) {
+            fprintf(stderr, "Error: TRACE marker not reached (%s at PC=0x%04X)\n",
+                    simulator_stop_reason_name(reason), sim->pc);
+            simulator_destroy(sim);
+            return 1;
+        }
+    }
+
+    Fuzzer *fz = fuzzer_create(sim, &config);
+    if (!fz) {
+        fprintf(stderr, "Error: Failed to create fuzzer\n");
+        simulator_destroy(sim);
+        return 1;
+    }
+
+    if (input) {
+        int result = run_one(fz, sim, input);
+        fuzzer_destroy(fz);
+        simulator_destroy(sim);
+        return result;
+    }
+
+    FuzzShared *shared = mmap(NULL, sizeof(FuzzShared), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map shared coverage: %s\n", strerror(errno));
+        return 1;
+    }
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE / 8; i++) {
+        atomic_init(&shared->virgin[i], ~0ULL);
+        atomic_init(&shared->virgin_crash[i], ~0ULL);
+        atomic_init(&shared->virgin_tmout[i], ~0ULL);
+    }
+
+    if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+
+    fprintf(stderr, "[bebofuzz] %ld worker(s), snapshot at PC=0x%04X, output in %s/\n",
+            jobs, sim->pc, out_dir);
+
+    // Workers inherit the snapshot copy-on-write and share only the coverage maps
+    pid_t pids[FUZZ_MAX_WORKERS];
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < jobs; i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % (ncpu > 0 ? ncpu : 1), &cpus);
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+
+            bebo_set_log_callback(quiet_log, NULL);
+            fuzzer_worker(fz, shared, i, in_dir, out_dir, max_execs, &stop_flag);
+            _exit(0);
+        }
+        if (pids[i] < 0) {
+            fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
+            jobs = i;
+            break;
+        }
+    }
+
+    uint64_t start_ns = host_monotonic_ns();
+    uint64_t next_status = start_ns + STATUS_INTERVAL_NS;
+    uint64_t last_execs = 0;
+    double last_seconds = 0;
+    int running = (int)jobs;
+    bool stopping = false;
+
+    while (running > 0) {
+        struct timespec ts = {0, 100000000};
+        nanosleep(&ts, NULL);
+
+        while (waitpid(-1, NULL, WNOHANG) > 0) running--;
+
+        uint64_t now = host_monotonic_ns();
+        if (!stopping && (stop_flag || (time_limit && now - start_ns >= time_limit * 1000000000ULL))) {
+            for (int i = 0; i < jobs; i++) kill(pids[i], SIGTERM);
+            stopping = true;
+        }
+        if (now >= next_status || running == 0) {
+            print_status(shared, (int)jobs, (now - start_ns) / 1e9, &last_execs, &last_seconds);
+            next_status = now + STATUS_INTERVAL_NS;
+        }
+    }
+
+    fuzzer_destroy(fz);
+    simulator_destroy(sim);
+    munmap(shared, sizeof(FuzzShared));
+    return 0;
+}
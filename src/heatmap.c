@@ -0,0 +1,430 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/heatmap.h"
+#include <math.h>
+#include <strings.h>
+
+// Guest memory heatmap: page counters and working-set windows are plain
+// array updates; reuse distances cost a Fenwick tree query per access.
+
+#define HEATMAP_TIMELINE_ROWS   16      // Working-set rows in the report
+#define HEATMAP_CELL            8       // PPM pixels per page
+#define HEATMAP_GRID            64      // Pages per PPM row
+
+// ==========================================
+// Reuse distance
+// ==========================================
+
+static int reuse_init(ReuseStack *r) {
+    r->last = calloc(HEATMAP_LINES, sizeof(uint32_t));
+    r->owner = malloc(HEATMAP_CLOCK_SIZE * sizeof(uint32_t));
+    r->tree = calloc(HEATMAP_CLOCK_SIZE + 1, sizeof(uint32_t));
+    return r->last && r->owner && r->tree;
+}
+
+static void reuse_free(ReuseStack *r) {
+    free(r->last);
+    free(r->owner);
+    free(r->tree);
+}
+
+static void reuse_add(ReuseStack *r, uint32_t t, uint32_t delta) {
+    for (uint32_t i = t + 1; i <= HEATMAP_CLOCK_SIZE; i += i & -i) {
+        r->tree[i] += delta;
+    }
+}
+
+// Marks at timestamps 0..t
+static uint32_t reuse_prefix(ReuseStack *r, uint32_t t) {
+    uint32_t sum = 0;
+    for (uint32_t i = t + 1; i > 0; i -= i & -i) {
+        sum += r->tree[i];
+    }
+    return sum;
+}
+
+// Renumber the live marks 0..live-1 in access order. At most a quarter
+// of the clock is live (one mark per line), so this runs rarely.
+static void reuse_compact(ReuseStack *r) {
+    uint32_t n = 0;
+    for (uint32_t t = 0; t < r->clock; t++) {
+        uint32_t line = r->owner[t];
+        if (r->last[line] == t + 1) {
+            r->owner[n] = line;
+            r->last[line] = ++n;
+        }
+    }
+    memset(r->tree, 0, (HEATMAP_CLOCK_SIZE + 1) * sizeof(uint32_t));
+    for (uint32_t t = 0; t < n; t++) {
+        reuse_add(r, t, 1);
+    }
+    r->clock = n;
+}
+
+static void reuse_access(ReuseStack *r, uint32_t line) {
+    if (r->clock == HEATMAP_CLOCK_SIZE) reuse_compact(r);
+
+    int bucket = HEATMAP_REUSE_BUCKETS;
+    uint32_t t = r->last[line];
+    if (t == 0) {
+        r->live++;
+    } else {
+        uint32_t distance = r->live - reuse_prefix(r, t - 1);
+        reuse_add(r, t - 1, (uint32_t)-1);
+        bucket = distance ? 32 - __builtin_clz(distance) : 0;
+        if (bucket >= HEATMAP_REUSE_BUCKETS) bucket = HEATMAP_REUSE_BUCKETS - 1;
+    }
+    r->histogram[bucket]++;
+
+    reuse_add(r, r->clock, 1);
+    r->owner[r->clock] = line;
+    r->last[line] = ++r->clock;
+}
+
+// ==========================================
+// Lifecycle and hooks
+// ==========================================
+
+int heatmap_start(SimulatorState *sim, uint64_t window) {
+    if (!sim || sim->heatmap) return 0;
+
+    Heatmap *h = calloc(1, sizeof(Heatmap));
+    if (!h) return 0;
+    if (!reuse_init(&h->code) || !reuse_init(&h->data)) {
+        reuse_free(&h->code);
+        reuse_free(&h->data);
+        free(h);
+        return 0;
+    }
+    h->window = window ? window : HEATMAP_DEFAULT_WINDOW;
+    h->window_end = sim->instructions_executed + h->window;
+    h->window_epoch = 1;
+
+    sim->heatmap = h;
+    return 1;
+}
+
+void heatmap_stop(SimulatorState *sim) {
+    if (!sim || !sim->heatmap) return;
+    Heatmap *h = sim->heatmap;
+
+    reuse_free(&h->code);
+    reuse_free(&h->data);
+    free(h->windows);
+    symtab_free(&h->sections);
+    symtab_free(&h->symbols);
+    free(h);
+    sim->heatmap = NULL;
+}
+
+static void heatmap_touch(Heatmap *h, uint32_t page) {
+    if (h->epoch[page] != h->window_epoch) {
+        h->epoch[page] = h->window_epoch;
+        h->window_pages++;
+    }
+}
+
+static void heatmap_close_window(Heatmap *h, uint64_t instructions) {
+    if (h->window_count == h->window_capacity) {
+        int capacity = h->window_capacity ? h->window_capacity * 2 : 256;
+        HeatmapWindow *grown = realloc(h->windows, capacity * sizeof(HeatmapWindow));
+        if (!grown) return;
+        h->windows = grown;
+        h->window_capacity = capacity;
+    }
+    h->windows[h->window_count].instructions = instructions;
+    h->windows[h->window_count++].pages = h->window_pages;
+    h->window_epoch++;
+    h->window_pages = 0;
+}
+
+void heatmap_read(SimulatorState *sim, uint32_t address) {
+    Heatmap *h = sim->heatmap;
+    h->pages[address >> PAGE_SHIFT].reads++;
+    heatmap_touch(h, address >> PAGE_SHIFT);
+    reuse_access(&h->data, address >> HEATMAP_LINE_SHIFT);
+}
+
+void heatmap_write(SimulatorState *sim, uint32_t address) {
+    Heatmap *h = sim->heatmap;
+    h->pages[address >> PAGE_SHIFT].writes++;
+    heatmap_touch(h, address >> PAGE_SHIFT);
+    reuse_access(&h->data, address >> HEATMAP_LINE_SHIFT);
+}
+
+void heatmap_exec(SimulatorState *sim, uint32_t pc) {
+    Heatmap *h = sim->heatmap;
+    if (pc >= MEMORY_SIZE) return;
+    h->pages[pc >> PAGE_SHIFT].execs++;
+    heatmap_touch(h, pc >> PAGE_SHIFT);
+    reuse_access(&h->code, pc >> HEATMAP_LINE_SHIFT);
+
+    if (sim->instructions_executed >= h->window_end) {
+        heatmap_close_window(h, sim->instructions_executed);
+        h->window_end += h->window;
+    }
+}
+
+// ==========================================
+// Sections and symbols
+// ==========================================
+
+#define HEATMAP_SYMBOL_TYPES    (SYM_CODE | SYM_DATA | SYM_BSS)
+
+int heatmap_add_symbols(SimulatorState *sim, AssemblerState *state) {
+    if (!sim || !sim->heatmap || !state) return 0;
+    Heatmap *h = sim->heatmap;
+    return symtab_add_assembler(&h->symbols, &h->sections, state, HEATMAP_SYMBOL_TYPES);
+}
+
+int heatmap_load_map(SimulatorState *sim, const char *path) {
+    if (!sim || !sim->heatmap || !path) return 0;
+    Heatmap *h = sim->heatmap;
+    return symtab_load_map(&h->symbols, &h->sections, path, HEATMAP_SYMBOL_TYPES);
+}
+
+static bool heatmap_overlaps(const SymtabEntry *sec, uint32_t page) {
+    uint32_t start = page << PAGE_SHIFT;
+    return sec->address < start + PAGE_SIZE && sec->address + sec->size > start;
+}
+
+// Sections overlapping the page, joined with '/'
+static const char* heatmap_page_sections(Heatmap *h, uint32_t page, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < h->sections.count; i++) {
+        SymtabEntry *sec = &h->sections.entries[i];
+        if (!heatmap_overlaps(sec, page)) continue;
+        int n = snprintf(buf + len, size - len, "%s%s", len ? "/" : "", sec->name);
+        if (n < 0 || (size_t)n >= size - len) break;
+        len += n;
+    }
+    return len ? buf : "-";
+}
+
+// Up to three symbols inside the page, or for a page inside a section
+// that has none, the symbol it starts in
+static const char* heatmap_page_symbols(Heatmap *h, uint32_t page, char *buf, size_t size) {
+    uint32_t start = page << PAGE_SHIFT;
+    const SymbolTable *symbols = &h->symbols;
+    int first = start ? symtab_find(symbols, start - 1) + 1 : 0;
+
+    size_t len = 0;
+    int shown = 0;
+    buf[0] = '\0';
+    for (int i = first; i < symbols->count && symbols->entries[i].address < start + PAGE_SIZE; i++) {
+        int n = shown == 3 ? snprintf(buf + len, size - len, ", ...")
+                           : snprintf(buf + len, size - len, "%s%s", shown ? ", " : "",
+                                      symbols->entries[i].name);
+        if (n < 0 || (size_t)n >= size - len) break;
+        len += n;
+        if (++shown > 3) break;
+    }
+    if (!shown && first > 0) {
+        for (int i = 0; i < h->sections.count; i++) {
+            if (heatmap_overlaps(&h->sections.entries[i], page)) {
+                snprintf(buf, size, "in %s", symbols->entries[first - 1].name);
+                break;
+            }
+        }
+    }
+    return buf[0] ? buf : "-";
+}
+
+// ==========================================
+// Output
+// ==========================================
+
+static const char* heatmap_size(uint64_t bytes, char *buf, size_t size) {
+    if (bytes >= 1024 * 1024) snprintf(buf, size, "%lu MB", (unsigned long)(bytes >> 20));
+    else if (bytes >= 1024) snprintf(buf, size, "%lu KB", (unsigned long)(bytes >> 10));
+    else snprintf(buf, size, "%lu B", (unsigned long)bytes);
+    return buf;
+}
+
+static void heatmap_report_windows(Heatmap *h) {
+    if (!h->window_count) return;
+
+    uint32_t min = UINT32_MAX, max = 0;
+    uint64_t sum = 0;
+    for (int i = 0; i < h->window_count; i++) {
+        uint32_t pages = h->windows[i].pages;
+        if (pages < min) min = pages;
+        if (pages > max) max = pages;
+        sum += pages;
+    }
+    bebo_log(BEBO_LOG_INFO, "\nWorking set (distinct %d KB pages per %lu instructions):\n",
+             PAGE_SIZE / 1024, (unsigned long)h->window);
+    bebo_log(BEBO_LOG_INFO, "  %d windows: min %u, average %.1f, max %u pages\n",
+             h->window_count, min, (double)sum / h->window_count, max);
+
+    // Long runs are shown as the largest window in each group
+    int group = (h->window_count + HEATMAP_TIMELINE_ROWS - 1) / HEATMAP_TIMELINE_ROWS;
+    bebo_log(BEBO_LOG_INFO, "  %14s %8s %10s\n", "instructions", "pages", "bytes");
+    for (int i = 0; i < h->window_count; i += group) {
+        uint32_t pages = 0;
+        int end = i + group < h->window_count ? i + group : h->window_count;
+        for (int j = i; j < end; j++) {
+            if (h->windows[j].pages > pages) pages = h->windows[j].pages;
+        }
+        char size[32];
+        bebo_log(BEBO_LOG_INFO, "  %14lu %8u %10s\n", (unsigned long)h->windows[end - 1].instructions,
+                 pages, heatmap_size((uint64_t)pages * PAGE_SIZE, size, sizeof(size)));
+    }
+}
+
+static void heatmap_report_pages(Heatmap *h, int max_pages) {
+    uint32_t *order = malloc(NUM_PAGES * sizeof(uint32_t));
+    if (!order) return;
+
+    int n = 0;
+    uint32_t read = 0, written = 0, executed = 0;
+    for (uint32_t p = 0; p < NUM_PAGES; p++) {
+        HeatmapPage *pg = &h->pages[p];
+        if (!pg->reads && !pg->writes && !pg->execs) continue;
+        read += pg->reads != 0;
+        written += pg->writes != 0;
+        executed += pg->execs != 0;
+        order[n++] = p;
+    }
+
+    char size[32];
+    bebo_log(BEBO_LOG_INFO, "Pages touched: %d (%s): %u read, %u written, %u executed\n",
+             n, heatmap_size((uint64_t)n * PAGE_SIZE, size, sizeof(size)), read, written, executed);
+
+    // Partial selection of the hottest pages by total accesses
+    int rows = n < max_pages ? n : max_pages;
+    for (int i = 0; i < rows; i++) {
+        int best = i;
+        for (int j = i + 1; j < n; j++) {
+            HeatmapPage *a = &h->pages[order[j]], *b = &h->pages[order[best]];
+            if (a->reads + a->writes + a->execs > b->reads + b->writes + b->execs) best = j;
+        }
+        uint32_t tmp = order[i];
+        order[i] = order[best];
+        order[best] = tmp;
+    }
+
+    if (rows) {
+        bebo_log(BEBO_LOG_INFO, "\nHottest pages:\n");
+        bebo_log(BEBO_LOG_INFO, "  %8s %12s %12s %12s  %-12s %s\n",
+                 "page", "reads", "writes", "execs", "section", "symbols");
+    }
+    for (int i = 0; i < rows; i++) {
+        HeatmapPage *pg = &h->pages[order[i]];
+        char sections[64], symbols[4 * MAX_LABEL_LEN];
+        bebo_log(BEBO_LOG_INFO, "  0x%06X %12lu %12lu %12lu  %-12s %s\n", order[i] << PAGE_SHIFT,
+                 (unsigned long)pg->reads, (unsigned long)pg->writes, (unsigned long)pg->execs,
+                 heatmap_page_sections(h, order[i], sections, sizeof(sections)),
+                 heatmap_page_symbols(h, order[i], symbols, sizeof(symbols)));
+    }
+    free(order);
+}
+
+// A fully associative LRU cache of 2^k lines hits every access whose
+// reuse distance is below 2^k, i.e. buckets 0..k
+static void heatmap_report_reuse(Heatmap *h) {
+    uint64_t code_total = 0, data_total = 0;
+    for (int b = 0; b <= HEATMAP_REUSE_BUCKETS; b++) {
+        code_total += h->code.histogram[b];
+        data_total += h->data.histogram[b];
+    }
+    if (!code_total && !data_total) return;
+
+    bebo_log(BEBO_LOG_INFO, "\nReuse distance (%d-byte lines, hit rate of a fully associative LRU cache):\n",
+             1 << HEATMAP_LINE_SHIFT);
+    bebo_log(BEBO_LOG_INFO, "  %10s %12s %8s %12s %8s\n", "cache", "code reuse", "hit%", "data reuse", "hit%");
+
+    uint64_t code_hits = 0, data_hits = 0;
+    uint64_t code_reuse = code_total - h->code.histogram[HEATMAP_REUSE_BUCKETS];
+    uint64_t data_reuse = data_total - h->data.histogram[HEATMAP_REUSE_BUCKETS];
+    for (int b = 0; b < HEATMAP_REUSE_BUCKETS; b++) {
+        code_hits += h->code.histogram[b];
+        data_hits += h->data.histogram[b];
+        char size[32];
+        bebo_log(BEBO_LOG_INFO, "  %10s %12lu %7.2f%% %12lu %7.2f%%\n",
+                 heatmap_size((uint64_t)1 << (b + HEATMAP_LINE_SHIFT), size, sizeof(size)),
+                 (unsigned long)h->code.histogram[b], code_total ? 100.0 * code_hits / code_total : 0.0,
+                 (unsigned long)h->data.histogram[b], data_total ? 100.0 * data_hits / data_total : 0.0);
+        if (code_hits == code_reuse && data_hits == data_reuse) break;
+    }
+    bebo_log(BEBO_LOG_INFO, "  %10s %12lu %8s %12lu\n", "first use",
+             (unsigned long)h->code.histogram[HEATMAP_REUSE_BUCKETS], "",
+             (unsigned long)h->data.histogram[HEATMAP_REUSE_BUCKETS]);
+}
+
+void heatmap_report(SimulatorState *sim, int max_pages) {
+    if (!sim || !sim->heatmap) return;
+    Heatmap *h = sim->heatmap;
+
+    // The window still open at exit counts if it saw anything
+    if (h->window_pages) {
+        heatmap_close_window(h, sim->instructions_executed);
+    }
+
+    bebo_log(BEBO_LOG_INFO, "\n=== Memory Heatmap ===\n");
+    heatmap_report_pages(h, max_pages);
+    heatmap_report_windows(h);
+    heatmap_report_reuse(h);
+}
+
+static int heatmap_write_csv(Heatmap *h, FILE *f) {
+    fprintf(f, "page,address,reads,writes,execs,section,symbols\n");
+    for (uint32_t p = 0; p < NUM_PAGES; p++) {
+        HeatmapPage *pg = &h->pages[p];
+        if (!pg->reads && !pg->writes && !pg->execs) continue;
+        char sections[64], symbols[4 * MAX_LABEL_LEN];
+        fprintf(f, "%u,0x%06X,%lu,%lu,%lu,%s,\"%s\"\n", p, p << PAGE_SHIFT,
+                (unsigned long)pg->reads, (unsigned long)pg->writes, (unsigned long)pg->execs,
+                heatmap_page_sections(h, p, sections, sizeof(sections)),
+                heatmap_page_symbols(h, p, symbols, sizeof(symbols)));
+    }
+    return 1;
+}
+
+// One cell per page, HEATMAP_GRID pages to a row: red for writes, green
+// for reads, blue for execution, each on a log scale to its busiest page
+static int heatmap_write_ppm(Heatmap *h, FILE *f) {
+    uint64_t max[3] = {0, 0, 0};
+    for (uint32_t p = 0; p < NUM_PAGES; p++) {
+        if (h->pages[p].writes > max[0]) max[0] = h->pages[p].writes;
+        if (h->pages[p].reads > max[1]) max[1] = h->pages[p].reads;
+        if (h->pages[p].execs > max[2]) max[2] = h->pages[p].execs;
+    }
+
+    int width = HEATMAP_GRID * HEATMAP_CELL;
+    int height = (NUM_PAGES / HEATMAP_GRID) * HEATMAP_CELL;
+    uint8_t *row = malloc(width * 3);
+    if (!row) return 0;
+
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            HeatmapPage *pg = &h->pages[(y / HEATMAP_CELL) * HEATMAP_GRID + x / HEATMAP_CELL];
+            uint64_t v[3] = {pg->writes, pg->reads, pg->execs};
+            for (int c = 0; c < 3; c++) {
+                row[x * 3 + c] = v[c] ? (uint8_t)(64 + 191 * log1p((double)v[c]) / log1p((double)max[c])) : 0;
+            }
+        }
+        fwrite(row, 3, width, f);
+    }
+    free(row);
+    return 1;
+}
+
+int heatmap_export(SimulatorState *sim, const char *path) {
+    if (!sim || !sim->heatmap || !path) return 0;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot create '%s'\n", path);
+        return 0;
+    }
+
+    size_t len = strlen(path);
+    int ok = (len > 4 && strcasecmp(path + len - 4, ".ppm") == 0)
+             ? heatmap_write_ppm(sim->heatmap, f)
+             : heatmap_write_csv(sim->heatmap, f);
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
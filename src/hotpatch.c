@@ -0,0 +1,241 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/symtab.h"
+
+// Hot patching: reassemble a changed source and write only the bytes that
+// differ into the running guest. The image and labels of the last assembly
+// are kept so that runtime changes to guest memory (variables, stack) are
+// left alone, and code addresses can be carried over to where they moved.
+
+#define HOTPATCH_MAX_SECTIONS   16
+#define SECTION_ATTR_EXECUTE    0x01
+
+struct HotPatch {
+    char source[256];
+    uint8_t *image;             // Bytes [0, image_size) as assembled
+    uint32_t image_size;
+    Section sections[HOTPATCH_MAX_SECTIONS];    // data is always NULL
+    int section_count;
+    SymbolTable symbols;        // Code labels
+};
+
+static void hotpatch_destroy(HotPatch *hp) {
+    if (!hp) return;
+    free(hp->image);
+    symtab_free(&hp->symbols);
+    free(hp);
+}
+
+static HotPatch* hotpatch_assemble(const char *source) {
+    AssemblerState *state = assembler_create(true, false);
+    if (!state) return NULL;
+    state->quiet = true;
+
+    if (!assemble_file(state, source)) {
+        assembler_destroy(state);
+        return NULL;
+    }
+
+    HotPatch *hp = calloc(1, sizeof(HotPatch));
+    if (!hp) {
+        assembler_destroy(state);
+        return NULL;
+    }
+    snprintf(hp->source, sizeof(hp->source), "%s", source);
+
+    // Same extent write_binary would produce
+    for (int i = 0; i < state->section_count && i < HOTPATCH_MAX_SECTIONS; i++) {
+        Section *sec = &state->sections[i];
+        memcpy(hp->sections[i].name, sec->name, sizeof(sec->name));
+        hp->sections[i].address = sec->address;
+        hp->sections[i].size = sec->size;
+        hp->sections[i].attributes = sec->attributes;
+        hp->section_count++;
+        if (sec->address + sec->size > hp->image_size) {
+            hp->image_size = sec->address + sec->size;
+        }
+    }
+    if (hp->image_size == 0) hp->image_size = state->pc;
+    if (hp->image_size > MEMORY_SIZE) hp->image_size = MEMORY_SIZE;
+
+    hp->image = malloc(hp->image_size ? hp->image_size : 1);
+    if (!hp->image || !symtab_add_assembler(&hp->symbols, NULL, state, SYM_CODE)) {
+        hotpatch_destroy(hp);
+        assembler_destroy(state);
+        return NULL;
+    }
+    memcpy(hp->image, state->memory, hp->image_size);
+
+    assembler_destroy(state);
+    return hp;
+}
+
+static bool hotpatch_in_code(HotPatch *hp, uint32_t address) {
+    for (int i = 0; i < hp->section_count; i++) {
+        Section *sec = &hp->sections[i];
+        if ((sec->attributes & SECTION_ATTR_EXECUTE) &&
+            address >= sec->address && address < sec->address + sec->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Carry a code address across a reassembly: keep its offset from the
+// nearest label at or below it. Returns false if there is no such label
+// or the label no longer exists.
+static bool hotpatch_remap(HotPatch *old, HotPatch *new, uint32_t address, uint32_t *out) {
+    if (!hotpatch_in_code(old, address)) return false;
+
+    int found = symtab_find(&old->symbols, address);
+    if (found < 0) return false;
+
+    const SymtabEntry *base = &old->symbols.entries[found];
+    const SymtabEntry *label = symtab_lookup(&new->symbols, base->name);
+    if (!label) return false;
+
+    *out = label->address + (address - base->address);
+    return true;
+}
+
+int hotpatch_load(SimulatorState *sim, const char *source) {
+    if (!sim || !source) return 0;
+
+    HotPatch *hp = hotpatch_assemble(source);
+    if (!hp) return 0;
+
+    if (!memory_write_block(sim, 0, hp->image, hp->image_size)) {
+        hotpatch_destroy(hp);
+        return 0;
+    }
+
+    hotpatch_free(sim);
+    sim->hotpatch = hp;
+    bebo_log(BEBO_LOG_INFO, "Assembled %u bytes from %s\n", hp->image_size, source);
+    return 1;
+}
+
+// Reassemble 'source' (or the last loaded source if NULL) and patch the
+// running guest. Bytes are compared against the previous assembly, or
+// against guest memory if the guest was loaded from a binary. The PC and
+// breakpoints follow their labels; return addresses already on the guest
+// stack are not touched.
+int hotpatch_reload(SimulatorState *sim, const char *source) {
+    if (!sim) return 0;
+
+    HotPatch *old = sim->hotpatch;
+    if (!source) {
+        if (!old) {
+            bebo_log(BEBO_LOG_ERROR, "No source file to reload\n");
+            return 0;
+        }
+        source = old->source;
+    }
+
+    HotPatch *new = hotpatch_assemble(source);
+    if (!new) {
+        bebo_log(BEBO_LOG_ERROR, "Reassembly of %s failed; guest left unchanged\n", source);
+        return 0;
+    }
+
+    // Zero-extend the new image so a shrinking section clears its old tail
+    uint32_t limit = new->image_size;
+    if (old && old->image_size > limit) limit = old->image_size;
+    if (limit > new->image_size) {
+        uint8_t *grown = realloc(new->image, limit);
+        if (!grown) {
+            hotpatch_destroy(new);
+            return 0;
+        }
+        memset(grown + new->image_size, 0, limit - new->image_size);
+        new->image = grown;
+    }
+
+    uint32_t total_bytes = 0;
+    uint32_t total_runs = 0;
+
+    for (int i = 0; i < new->section_count; i++) {
+        Section *sec = &new->sections[i];
+        uint32_t start = sec->address;
+        uint32_t end = sec->address + sec->size;
+
+        // A section that shrank still owns its old extent
+        if (old) {
+            for (int j = 0; j < old->section_count; j++) {
+                Section *prev = &old->sections[j];
+                if (strcmp(prev->name, sec->name) == 0 && prev->address == start &&
+                    prev->address + prev->size > end) {
+                    end = prev->address + prev->size;
+                }
+            }
+        }
+        if (end > limit) end = limit;
+
+        uint32_t bytes = 0;
+        uint32_t runs = 0;
+        uint32_t addr = start;
+        while (addr < end) {
+            uint8_t was = old ? (addr < old->image_size ? old->image[addr] : 0) : sim->memory[addr];
+            if (new->image[addr] == was) {
+                addr++;
+                continue;
+            }
+
+            uint32_t run = addr;
+            while (addr < end) {
+                was = old ? (addr < old->image_size ? old->image[addr] : 0) : sim->memory[addr];
+                if (new->image[addr] == was) break;
+                addr++;
+            }
+            memory_write_block(sim, run, new->image + run, addr - run);
+            bytes += addr - run;
+            runs++;
+        }
+
+        if (bytes) {
+            bebo_log(BEBO_LOG_INFO, "  %-8s %u bytes in %u range(s)\n", sec->name, bytes, runs);
+        }
+        total_bytes += bytes;
+        total_runs += runs;
+    }
+
+    // Labels that moved take the PC and breakpoints with them
+    if (old) {
+        uint32_t moved;
+        if (hotpatch_remap(old, new, sim->pc, &moved) && moved != sim->pc) {
+            bebo_log(BEBO_LOG_INFO, "  PC 0x%04X -> 0x%04X\n", sim->pc, moved);
+            sim->pc = moved;
+            sim->registers[REG_PC] = moved;
+        }
+        for (int i = 0; i < sim->breakpoint_count; i++) {
+            if (hotpatch_remap(old, new, sim->breakpoints[i], &moved) && moved != sim->breakpoints[i]) {
+                bebo_log(BEBO_LOG_INFO, "  Breakpoint 0x%04X -> 0x%04X\n", sim->breakpoints[i], moved);
+                sim->breakpoints[i] = moved;
+            }
+        }
+    }
+
+    // The idle-loop detector's snapshot may describe code that just changed
+    sim->idle.armed = false;
+
+    bebo_log(BEBO_LOG_INFO, "Patched %u bytes in %u range(s) from %s\n", total_bytes, total_runs, source);
+
+    hotpatch_destroy(old);
+    sim->hotpatch = new;
+    return 1;
+}
+
+int hotpatch_symbol_address(SimulatorState *sim, const char *name, uint32_t *address) {
+    if (!sim || !sim->hotpatch || !name) return 0;
+
+    const SymtabEntry *sym = symtab_lookup(&sim->hotpatch->symbols, name);
+    if (!sym) return 0;
+    *address = sym->address;
+    return 1;
+}
+
+void hotpatch_free(SimulatorState *sim) {
+    if (!sim) return;
+    hotpatch_destroy(sim->hotpatch);
+    sim->hotpatch = NULL;
+}
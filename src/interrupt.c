@@ -0,0 +1,336 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include "../include/profiler.h"
+#include "../include/cycles.h"
+
+// ==========================================
+// Event Queue (min-heap keyed on clock_cycles)
+// ==========================================
+
+typedef struct {
+    uint64_t cycle;
+    uint32_t id;
+    bool observer;              // Host-side: invisible to the guest and to WAIT
+    EventCallback callback;
+    void *opaque;
+} Event;
+
+struct EventQueue {
+    Event *heap;
+    int count;
+    int capacity;
+    uint32_t next_id;
+};
+
+static void event_swap(Event *a, Event *b) {
+    Event tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void event_sift_up(EventQueue *q, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (q->heap[parent].cycle <= q->heap[i].cycle) break;
+        event_swap(&q->heap[parent], &q->heap[i]);
+        i = parent;
+    }
+}
+
+static void event_sift_down(EventQueue *q, int i) {
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+        if (left < q->count && q->heap[left].cycle < q->heap[smallest].cycle) smallest = left;
+        if (right < q->count && q->heap[right].cycle < q->heap[smallest].cycle) smallest = right;
+        if (smallest == i) break;
+        event_swap(&q->heap[smallest], &q->heap[i]);
+        i = smallest;
+    }
+}
+
+static void event_remove_at(EventQueue *q, int i) {
+    q->count--;
+    if (i == q->count) return;
+    q->heap[i] = q->heap[q->count];
+    event_sift_down(q, i);
+    event_sift_up(q, i);
+}
+
+// Recompute the single comparison the CPU loop makes per instruction
+static void event_update_deadline(SimulatorState *sim) {
+    EventQueue *q = sim->events;
+    uint64_t next = (q && q->count) ? q->heap[0].cycle : UINT64_MAX;
+
+    // Deliverable interrupts need servicing right away
+    if (sim->interrupt.enabled && (sim->interrupt.pending & ~sim->interrupt.mask)) {
+        next = 0;
+    }
+    sim->next_event_cycle = next;
+}
+
+EventQueue* event_queue_create(void) {
+    EventQueue *q = calloc(1, sizeof(EventQueue));
+    if (!q) return NULL;
+
+    q->capacity = 16;
+    q->heap = calloc(q->capacity, sizeof(Event));
+    if (!q->heap) {
+        free(q);
+        return NULL;
+    }
+    q->next_id = 1;
+    return q;
+}
+
+static int event_queue_copy(EventQueue *q, const EventQueue *saved) {
+    if (saved->count > q->capacity) {
+        Event *heap = realloc(q->heap, saved->capacity * sizeof(Event));
+        if (!heap) return 0;
+        q->heap = heap;
+        q->capacity = saved->capacity;
+    }
+    memcpy(q->heap, saved->heap, saved->count * sizeof(Event));
+    q->count = saved->count;
+    if (saved->next_id > q->next_id) q->next_id = saved->next_id;
+    return 1;
+}
+
+void event_queue_destroy(EventQueue *q) {
+    if (!q) return;
+    free(q->heap);
+    free(q);
+}
+
+// Copy of the pending events, for rewinding with event_queue_restore
+EventQueue* event_queue_save(SimulatorState *sim) {
+    EventQueue *q = event_queue_create();
+    if (!q || !sim->events) return q;
+    if (!event_queue_copy(q, sim->events)) {
+        event_queue_destroy(q);
+        return NULL;
+    }
+    return q;
+}
+
+// Replace the pending events with a saved set. Ids keep counting up from
+// the live queue, so an id a device still holds from before the rewind
+// can never name a newer event.
+int event_queue_restore(SimulatorState *sim, const EventQueue *saved) {
+    if (!sim->events || !saved) return 0;
+    if (!event_queue_copy(sim->events, saved)) return 0;
+    event_update_deadline(sim);
+    return 1;
+}
+
+static uint32_t event_push(SimulatorState *sim, uint64_t cycle, EventCallback callback, void *opaque,
+                           bool observer) {
+    EventQueue *q = sim->events;
+    if (!q || !callback) return 0;
+
+    if (q->count >= q->capacity) {
+        int capacity = q->capacity * 2;
+        Event *heap = realloc(q->heap, capacity * sizeof(Event));
+        if (!heap) return 0;
+        q->heap = heap;
+        q->capacity = capacity;
+    }
+
+    uint32_t id = q->next_id++;
+    if (q->next_id == 0) q->next_id = 1;
+
+    Event *ev = &q->heap[q->count];
+    ev->cycle = cycle;
+    ev->id = id;
+    ev->callback = callback;
+    ev->opaque = opaque;
+    ev->observer = observer;
+    event_sift_up(q, q->count++);
+
+    event_update_deadline(sim);
+    return id;
+}
+
+uint32_t event_schedule(SimulatorState *sim, uint64_t cycle, EventCallback callback, void *opaque) {
+    return event_push(sim, cycle, callback, opaque, false);
+}
+
+// For profilers, pacing and exports: fires like any event, but WAIT
+// neither wakes for it nor counts it as pending work
+uint32_t event_schedule_observer(SimulatorState *sim, uint64_t cycle, EventCallback callback, void *opaque) {
+    return event_push(sim, cycle, callback, opaque, true);
+}
+
+void event_cancel(SimulatorState *sim, uint32_t id) {
+    EventQueue *q = sim->events;
+    if (!q || id == 0) return;
+
+    for (int i = 0; i < q->count; i++) {
+        if (q->heap[i].id == id) {
+            event_remove_at(q, i);
+            break;
+        }
+    }
+    event_update_deadline(sim);
+}
+
+uint64_t event_next_cycle(SimulatorState *sim) {
+    EventQueue *q = sim->events;
+    return (q && q->count) ? q->heap[0].cycle : UINT64_MAX;
+}
+
+// Earliest cycle at which something can happen that the guest sees: a
+// deliverable interrupt (now) or a guest event. UINT64_MAX if none.
+uint64_t event_next_guest_cycle(SimulatorState *sim) {
+    if (sim->interrupt.enabled && (sim->interrupt.pending & ~sim->interrupt.mask)) return 0;
+
+    EventQueue *q = sim->events;
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; q && i < q->count; i++) {
+        if (!q->heap[i].observer && q->heap[i].cycle < next) next = q->heap[i].cycle;
+    }
+    return next;
+}
+
+// Slow path taken when clock_cycles reaches next_event_cycle: fire every
+// due event, then deliver the highest-priority pending interrupt.
+void simulator_service_events(SimulatorState *sim) {
+    EventQueue *q = sim->events;
+
+    while (q && q->count && q->heap[0].cycle <= sim->clock_cycles) {
+        Event ev = q->heap[0];
+        event_remove_at(q, 0);
+        ev.callback(sim, ev.opaque);
+    }
+
+    interrupt_deliver(sim);
+    event_update_deadline(sim);
+}
+
+// ==========================================
+// Interrupt Controller
+// ==========================================
+
+// Latch an interrupt request line. Delivery happens in the CPU loop.
+void interrupt_raise(SimulatorState *sim, int irq) {
+    if (!sim || irq < 0 || irq >= NUM_IRQS) return;
+    sim->interrupt.pending |= (uint8_t)(1 << irq);
+    event_update_deadline(sim);
+}
+
+void interrupt_clear(SimulatorState *sim, int irq) {
+    if (!sim || irq < 0 || irq >= NUM_IRQS) return;
+    sim->interrupt.pending &= (uint8_t)~(1 << irq);
+    event_update_deadline(sim);
+}
+
+void interrupt_set_enabled(SimulatorState *sim, bool enabled) {
+    sim->interrupt.enabled = enabled;
+    if (enabled) {
+        sim->flags |= FLAG_INTERRUPT;
+    } else {
+        sim->flags &= ~FLAG_INTERRUPT;
+    }
+    event_update_deadline(sim);
+}
+
+static void interrupt_push(SimulatorState *sim, uint32_t value) {
+    sim->registers[REG_SP] -= 4;
+    memory_write_dword(sim, sim->registers[REG_SP], value);
+}
+
+static uint32_t interrupt_pop(SimulatorState *sim) {
+    uint32_t value = memory_read_dword(sim, sim->registers[REG_SP]);
+    sim->registers[REG_SP] += 4;
+    return value;
+}
+
+// Enter the handler for the lowest-numbered pending, unmasked IRQ. Host
+// handlers in interrupt.handlers[] take precedence over the guest vector
+// table; guest handlers run with interrupts disabled and return with RETI.
+void interrupt_deliver(SimulatorState *sim) {
+    if (!sim->interrupt.enabled) return;
+
+    uint8_t ready = sim->interrupt.pending & ~sim->interrupt.mask;
+    if (!ready) return;
+
+    int irq = __builtin_ctz(ready);
+    sim->interrupt.pending &= (uint8_t)~(1 << irq);
+
+    if (sim->interrupt.handlers[irq]) {
+        sim->interrupt.handlers[irq](sim);
+        return;
+    }
+
+    interrupt_push(sim, sim->pc);
+    interrupt_push(sim, sim->flags);
+    interrupt_set_enabled(sim, false);
+
+    uint32_t entry = sim->interrupt.vector_base + (uint32_t)irq * 4;
+    uint32_t handler = memory_read_dword(sim, entry);
+
+    if (sim->profiler) profiler_interrupt(sim, handler, sim->pc);
+    sim->pc = handler;
+    sim->interrupts_delivered++;
+    sim->clock_cycles += cycle_table.interrupt;
+}
+
+// RETI / IRET: restore flags (including the interrupt enable) and PC
+void interrupt_return(SimulatorState *sim) {
+    uint32_t flags = interrupt_pop(sim);
+    sim->pc = interrupt_pop(sim);
+    sim->flags = flags;
+    interrupt_set_enabled(sim, (flags & FLAG_INTERRUPT) != 0);
+}
+
+// Controller ports
+#define PIC_REG_PENDING     0   // Read: pending IRQs, Write: acknowledge (clear) bits
+#define PIC_REG_MASK        1   // Bit set = IRQ masked
+#define PIC_REG_VECTOR      2   // Guest address of the 32-bit handler table
+#define PIC_REG_ENABLE      3   // Write 1 to enable delivery, 0 to disable
+
+static uint32_t pic_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)opaque;
+    switch (port - PORT_PIC_BASE) {
+        case PIC_REG_PENDING: return sim->interrupt.pending;
+        case PIC_REG_MASK:    return sim->interrupt.mask;
+        case PIC_REG_VECTOR:  return sim->interrupt.vector_base;
+        case PIC_REG_ENABLE:  return sim->interrupt.enabled;
+    }
+    return 0;
+}
+
+static void pic_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    (void)opaque;
+    switch (port - PORT_PIC_BASE) {
+        case PIC_REG_PENDING:
+            sim->interrupt.pending &= (uint8_t)~value;
+            break;
+        case PIC_REG_MASK:
+            sim->interrupt.mask = (uint8_t)value;
+            break;
+        case PIC_REG_VECTOR:
+            sim->interrupt.vector_base = value;
+            break;
+        case PIC_REG_ENABLE:
+            interrupt_set_enabled(sim, value != 0);
+            break;
+    }
+    event_update_deadline(sim);
+}
+
+static void pic_print_stats(SimulatorState *sim, void *opaque) {
+    (void)opaque;
+    if (sim->interrupts_delivered) {
+        bebo_log(BEBO_LOG_INFO, "Interrupts delivered: %lu\n", (unsigned long)sim->interrupts_delivered);
+    }
+}
+
+void interrupt_controller_attach(SimulatorState *sim) {
+    Device *dev = device_register(sim, "pic", PORT_PIC_BASE, PORT_PIC_COUNT, pic_read, pic_write, NULL);
+    if (dev) {
+        dev->print_stats = pic_print_stats;
+        dev->idle_reads = ~0ULL;
+    }
+}
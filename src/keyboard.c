@@ -0,0 +1,229 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+// Keyboard status register
+#define KBD_ST_DATA         0x01    // At least one byte waiting
+#define KBD_ST_EOF          0x02    // Input source closed and ring drained
+
+// Keyboard control register
+#define KBD_CTRL_IRQ        0x01    // Raise IRQ_KEYBOARD while data is waiting
+
+#define KBD_RING_SIZE       4096    // Power of two
+#define KBD_POLL_CYCLES     1000    // How often the CPU side checks the ring
+#define KBD_POLL_MS         50      // Reader thread wakeup for shutdown checks
+
+// The reader thread is the only producer and the CPU loop the only
+// consumer, so the ring needs no lock: each side owns one index and
+// publishes it with release/acquire ordering.
+typedef struct {
+    uint8_t buf[KBD_RING_SIZE];
+    _Atomic uint32_t head;          // Written by the reader thread
+    _Atomic uint32_t tail;          // Written by the CPU
+    atomic_bool eof;
+    atomic_bool stop;
+
+    int fd;
+    bool owns_fd;
+    pthread_t thread;
+    bool thread_started;
+
+    uint32_t control;
+    uint32_t event_id;
+
+    // Statistics
+    uint64_t bytes_read;
+} Keyboard;
+
+static bool kbd_ring_empty(Keyboard *kbd) {
+    return atomic_load_explicit(&kbd->head, memory_order_acquire) ==
+           atomic_load_explicit(&kbd->tail, memory_order_relaxed);
+}
+
+static int kbd_ring_pop(Keyboard *kbd) {
+    uint32_t tail = atomic_load_explicit(&kbd->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&kbd->head, memory_order_acquire)) return -1;
+
+    uint8_t value = kbd->buf[tail & (KBD_RING_SIZE - 1)];
+    atomic_store_explicit(&kbd->tail, tail + 1, memory_order_release);
+    return value;
+}
+
+// Blocks only the reader thread: waits for ring space rather than dropping input
+static bool kbd_ring_push(Keyboard *kbd, uint8_t value) {
+    uint32_t head = atomic_load_explicit(&kbd->head, memory_order_relaxed);
+
+    while (head - atomic_load_explicit(&kbd->tail, memory_order_acquire) >= KBD_RING_SIZE) {
+        if (atomic_load(&kbd->stop)) return false;
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+
+    kbd->buf[head & (KBD_RING_SIZE - 1)] = value;
+    atomic_store_explicit(&kbd->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void *kbd_reader(void *arg) {
+    Keyboard *kbd = (Keyboard *)arg;
+    uint8_t chunk[256];
+
+    while (!atomic_load(&kbd->stop)) {
+        struct pollfd pfd = {kbd->fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, KBD_POLL_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        ssize_t n = read(kbd->fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break;
+        }
+        if (n == 0) break;
+
+        for (ssize_t i = 0; i < n; i++) {
+            if (!kbd_ring_push(kbd, chunk[i])) return NULL;
+        }
+    }
+
+    atomic_store(&kbd->eof, true);
+    return NULL;
+}
+
+// Periodic check from the CPU side; never touches the input source itself
+static void kbd_poll(SimulatorState *sim, void *opaque) {
+    Keyboard *kbd = (Keyboard *)opaque;
+    kbd->event_id = 0;
+
+    bool empty = kbd_ring_empty(kbd);
+    if (!empty && (kbd->control & KBD_CTRL_IRQ)) {
+        interrupt_raise(sim, IRQ_KEYBOARD);
+    }
+
+    // Once the source is closed and drained nothing can arrive, so stop
+    // polling and let WAIT see an empty event queue.
+    if (!empty || !atomic_load(&kbd->eof)) {
+        kbd->event_id = event_schedule(sim, sim->clock_cycles + KBD_POLL_CYCLES, kbd_poll, kbd);
+    }
+}
+
+static uint32_t kbd_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim;
+    Keyboard *kbd = (Keyboard *)opaque;
+
+    switch (port) {
+        case PORT_KEYBOARD: {
+            int value = kbd_ring_pop(kbd);
+            if (value < 0) return 0;
+            kbd->bytes_read++;
+            return (uint32_t)value;
+        }
+        case PORT_KEYBOARD_STATUS: {
+            uint32_t status = 0;
+            if (!kbd_ring_empty(kbd)) {
+                status |= KBD_ST_DATA;
+            } else if (atomic_load(&kbd->eof)) {
+                status |= KBD_ST_EOF;
+            }
+            return status;
+        }
+        case PORT_KEYBOARD_CONTROL:
+            return kbd->control;
+    }
+    return 0;
+}
+
+static void kbd_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    (void)sim;
+    Keyboard *kbd = (Keyboard *)opaque;
+    if (port == PORT_KEYBOARD_CONTROL) {
+        kbd->control = value;
+    }
+}
+
+static void kbd_reset(SimulatorState *sim, void *opaque) {
+    Keyboard *kbd = (Keyboard *)opaque;
+    kbd->control = 0;
+    if (kbd->event_id) event_cancel(sim, kbd->event_id);
+    kbd->event_id = event_schedule(sim, sim->clock_cycles + KBD_POLL_CYCLES, kbd_poll, kbd);
+}
+
+static void kbd_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    Keyboard *kbd = (Keyboard *)opaque;
+    if (kbd->bytes_read) {
+        bebo_log(BEBO_LOG_INFO, "Keyboard bytes read: %lu\n", (unsigned long)kbd->bytes_read);
+    }
+}
+
+static uint64_t kbd_counter(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    return ((Keyboard *)opaque)->bytes_read;
+}
+
+static void kbd_destroy(void *opaque) {
+    Keyboard *kbd = (Keyboard *)opaque;
+
+    atomic_store(&kbd->stop, true);
+    if (kbd->thread_started) {
+        pthread_join(kbd->thread, NULL);
+    }
+    if (kbd->owns_fd) {
+        close(kbd->fd);
+    }
+    free(kbd);
+}
+
+int keyboard_attach(SimulatorState *sim, const char *path) {
+    Keyboard *kbd = calloc(1, sizeof(Keyboard));
+    if (!kbd) return 0;
+
+    // "-" or NULL reads the host's stdin
+    if (!path || strcmp(path, "-") == 0) {
+        kbd->fd = STDIN_FILENO;
+    } else {
+        kbd->fd = open(path, O_RDONLY);
+        if (kbd->fd < 0) {
+            bebo_log(BEBO_LOG_ERROR, "Error: Cannot open input '%s': %s\n", path, strerror(errno));
+            free(kbd);
+            return 0;
+        }
+        kbd->owns_fd = true;
+    }
+
+    // Replace the placeholder device
+    Device *stub = device_find(sim, "keyboard");
+    if (stub) device_unregister(sim, stub);
+
+    Device *dev = device_register(sim, "keyboard", PORT_KEYBOARD, 1, kbd_read, NULL, kbd);
+    Device *ctl = device_register(sim, "keyboard-ctl", PORT_KEYBOARD_STATUS, 2, kbd_read, kbd_write, kbd);
+    if (!dev || !ctl) {
+        if (dev) device_unregister(sim, dev);
+        if (kbd->owns_fd) close(kbd->fd);
+        free(kbd);
+        return 0;
+    }
+    ctl->idle_reads = ~0ULL;
+    dev->reset = kbd_reset;
+    dev->print_stats = kbd_print_stats;
+    dev->counter = kbd_counter;
+    dev->counter_name = "keyboard_bytes";
+    dev->destroy = kbd_destroy;
+
+    if (pthread_create(&kbd->thread, NULL, kbd_reader, kbd) != 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot start input reader thread\n");
+        device_unregister(sim, ctl);
+        device_unregister(sim, dev);
+        return 0;
+    }
+    kbd->thread_started = true;
+
+    kbd->event_id = event_schedule(sim, sim->clock_cycles + KBD_POLL_CYCLES, kbd_poll, kbd);
+    return 1;
+}
@@ -0,0 +1,124 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include "../include/libbebo.h"
+
+// Stable C API over the simulator internals (see include/libbebo.h)
+
+BeboSim* bebo_create(void) {
+    SimulatorState *sim = simulator_create(NULL);
+    if (sim) {
+        sim->running = true;
+    }
+    return sim;
+}
+
+BeboSim* bebo_create_from_source(const char *source) {
+    AssemblerState *state = assembler_create(true, false);
+    if (!state) return NULL;
+    state->quiet = true;
+
+    SimulatorState *sim = NULL;
+    if (assemble_string(state, source)) {
+        sim = simulator_create(state);
+        if (sim) {
+            sim->running = true;
+        }
+    }
+    assembler_destroy(state);
+    return sim;
+}
+
+int bebo_run_source(const char *source, uint64_t max_instructions,
+                    BeboStopReason *reason, int *exit_code) {
+    BeboSim *sim = bebo_create_from_source(source);
+    if (!sim) return 0;
+
+    int result = bebo_run_for(sim, max_instructions, reason);
+    if (exit_code) *exit_code = sim->exit_code;
+    simulator_destroy(sim);
+    return result;
+}
+
+void bebo_destroy(BeboSim *sim) {
+    simulator_destroy(sim);
+}
+
+int bebo_load(BeboSim *sim, uint32_t address, const void *data, size_t len) {
+    if (!sim || !data || len > MEMORY_SIZE) return 0;
+    return memory_write_block(sim, address, (const uint8_t *)data, (uint32_t)len);
+}
+
+int bebo_run_for(BeboSim *sim, uint64_t max_instructions, BeboStopReason *reason) {
+    StopReason stop;
+    if (!sim) return 0;
+
+    int result = simulator_run_for(sim, max_instructions, &stop);
+    if (reason) *reason = (BeboStopReason)stop;
+    return result;
+}
+
+void bebo_request_stop(BeboSim *sim) {
+    simulator_request_stop(sim);
+}
+
+int bebo_exit_code(BeboSim *sim) {
+    return sim->exit_code;
+}
+
+uint64_t bebo_instructions(BeboSim *sim) {
+    return sim->instructions_executed;
+}
+
+uint64_t bebo_cycles(BeboSim *sim) {
+    return sim->clock_cycles;
+}
+
+uint32_t bebo_get_register(BeboSim *sim, int reg) {
+    if (reg < 0 || reg >= NUM_REGISTERS) return 0;
+    return sim->registers[reg];
+}
+
+void bebo_set_register(BeboSim *sim, int reg, uint32_t value) {
+    if (reg < 0 || reg >= NUM_REGISTERS) return;
+    sim->registers[reg] = value;
+}
+
+uint32_t bebo_get_pc(BeboSim *sim) {
+    return sim->pc;
+}
+
+void bebo_set_pc(BeboSim *sim, uint32_t pc) {
+    sim->pc = pc;
+}
+
+int bebo_read_memory(BeboSim *sim, uint32_t address, void *dst, size_t len) {
+    if (!sim || !dst || len > MEMORY_SIZE) return 0;
+    return memory_read_block(sim, address, (uint8_t *)dst, (uint32_t)len);
+}
+
+int bebo_write_memory(BeboSim *sim, uint32_t address, const void *src, size_t len) {
+    if (!sim || !src || len > MEMORY_SIZE) return 0;
+    return memory_write_block(sim, address, (const uint8_t *)src, (uint32_t)len);
+}
+
+int bebo_register_device(BeboSim *sim, const char *name, uint16_t base, uint32_t count,
+                         BeboPortReadFn read, BeboPortWriteFn write, void *opaque) {
+    return device_register(sim, name, base, count, read, write, opaque) != NULL;
+}
+
+int bebo_unregister_device(BeboSim *sim, const char *name) {
+    Device *dev = device_find(sim, name);
+    return dev ? device_unregister(sim, dev) : 0;
+}
+
+uint32_t bebo_schedule_event(BeboSim *sim, uint64_t cycle, BeboEventFn callback, void *opaque) {
+    return event_schedule(sim, cycle, callback, opaque);
+}
+
+void bebo_cancel_event(BeboSim *sim, uint32_t id) {
+    event_cancel(sim, id);
+}
+
+void bebo_raise_irq(BeboSim *sim, int irq) {
+    interrupt_raise(sim, irq);
+}
@@ -0,0 +1,42 @@
+#include "../include/beboasm.h"
+#include <stdarg.h>
+
+// Library output sink. With no callback installed output goes to
+// stdout/stderr exactly as before; embedders can capture or drop it.
+static BeboLogFn log_callback = NULL;
+static void *log_user = NULL;
+
+void bebo_set_log_callback(BeboLogFn callback, void *user) {
+    log_callback = callback;
+    log_user = user;
+}
+
+void bebo_log(BeboLogLevel level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!log_callback) {
+        vfprintf(level == BEBO_LOG_ERROR ? stderr : stdout, format, args);
+        va_end(args);
+        return;
+    }
+
+    char buffer[512];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+
+    if (len >= (int)sizeof(buffer)) {
+        char *text = malloc((size_t)len + 1);
+        if (text) {
+            vsnprintf(text, (size_t)len + 1, format, copy);
+            log_callback(log_user, level, text);
+            free(text);
+        }
+    } else if (len > 0) {
+        log_callback(log_user, level, buffer);
+    }
+
+    va_end(copy);
+    va_end(args);
+}
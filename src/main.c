@@ -1,20 +1,87 @@
 #include "../include/beboasm.h"
 #include "../include/opcodes.h"
+#include "../include/cycles.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 
+// Assemble and execute in one process: the simulator adopts the assembled
+// image directly, so nothing touches the disk. Only guest output and
+// errors are printed; the guest's exit code becomes ours.
+static int assemble_and_run(const char *input_file, bool stats) {
+    AssemblerState *state = assembler_create(true, false);
+    if (!state) {
+        fprintf(stderr, "Error: Failed to create assembler state\n");
+        return 1;
+    }
+    state->quiet = true;
+    
+    uint64_t start_ns = host_monotonic_ns();
+    if (!assemble_file(state, input_file)) {
+        assembler_destroy(state);
+        return 1;
+    }
+    
+    SimulatorState *sim = simulator_create(state);
+    assembler_destroy(state);
+    if (!sim) {
+        fprintf(stderr, "Error: Failed to create simulator\n");
+        return 1;
+    }
+    uint64_t ready_ns = host_monotonic_ns();
+    
+    StopReason reason;
+    int ok = simulator_run_for(sim, UINT64_MAX, &reason);
+    uint64_t done_ns = host_monotonic_ns();
+    int exit_code = ok ? sim->exit_code : 1;
+    
+    if (stats) {
+        fprintf(stderr, "[beboasm] %s after %lu instructions; assemble+load %.1f us, run %.1f us\n",
+                simulator_stop_reason_name(reason), (unsigned long)sim->instructions_executed,
+                (ready_ns - start_ns) / 1e3, (done_ns - ready_ns) / 1e3);
+    }
+    
+    simulator_destroy(sim);
+    return exit_code;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc >= 3 && (strcmp(argv[1], "--run") == 0 || strcmp(argv[1], "--run-stats") == 0)) {
+        return assemble_and_run(argv[2], strcmp(argv[1], "--run-stats") == 0);
+    }
+    
     printf("BeboAsm Assembler - Version 1.0\nCreated by Abanoub\n\n");
     
-    if (argc < 2) {
-        printf("Usage: beboasm <input file> [output file]\n");
-        return 1;
+    const char *input_file = NULL;
+    const char *output_file = "output.bin";
+    const char *map_file = NULL;
+    const char *list_file = NULL;
+    int positional = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            map_file = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            list_file = argv[++i];
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            if (!cycles_load(argv[++i])) return 1;
+        } else if (positional == 0) {
+            input_file = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            output_file = argv[i];
+            positional++;
+        }
     }
     
-    const char *input_file = argv[1];
-    const char *output_file = (argc >= 3) ? argv[2] : "output.bin";
+    if (!input_file) {
+        printf("Usage: beboasm <input file> [output file] [--map map file]\n"
+               "               [--list listing file] [--cycles cycle table]\n"
+               "       beboasm --run <input file>          assemble and execute in-process\n"
+               "       beboasm --run-stats <input file>    same, with timing on stderr\n");
+        return 1;
+    }
     
     // Check if input file is binary (based on extension)
     size_t len = strlen(input_file);
@@ -31,6 +98,7 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Error: Failed to create assembler state\n");
         return 1;
     }
+    state->generate_listing = list_file != NULL;
     
     // Assemble
     if (assemble_file(state, input_file)) {
@@ -40,6 +108,12 @@ int main(int argc, char *argv[]) {
         } else {
             fprintf(stderr, "\nFailed to write output file\n");
         }
+        if (map_file && !write_map(state, map_file)) {
+            fprintf(stderr, "Failed to write map file %s\n", map_file);
+        }
+        if (list_file && !write_listing(state, list_file)) {
+            fprintf(stderr, "Failed to write listing file %s\n", list_file);
+        }
     } else {
         fprintf(stderr, "\nAssembly failed\n");
     }
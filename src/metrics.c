@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include "../include/beboasm.h"
+#include "../include/cache.h"
+#include "../include/devices.h"
+#include "../include/metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Live metrics. The CPU thread only ever stores into the snapshot; all
+// formatting and I/O happens on the sampler thread.
+
+// ==========================================
+// CPU side
+// ==========================================
+
+void metrics_publish(SimulatorState *sim) {
+    Metrics *m = sim->metrics;
+    uint64_t values[METRIC_COUNT] = {0};
+    values[METRIC_INSTRUCTIONS] = sim->instructions_executed;
+    values[METRIC_CYCLES] = sim->clock_cycles;
+    values[METRIC_MEMORY_ACCESSES] = sim->memory_accesses;
+    values[METRIC_MEMORY_WRITES] = sim->memory_writes;
+    values[METRIC_IO_READS] = sim->io_reads;
+    values[METRIC_IO_EFFECTS] = sim->io_effects;
+    values[METRIC_INTERRUPTS] = sim->interrupts_delivered;
+    values[METRIC_IDLE_CYCLES] = sim->idle.skipped_cycles;
+    if (sim->cache) {
+        values[METRIC_L1I_ACCESSES] = sim->cache->l1i.accesses;
+        values[METRIC_L1I_MISSES] = sim->cache->l1i.misses;
+        values[METRIC_L1D_ACCESSES] = sim->cache->l1d.accesses;
+        values[METRIC_L1D_MISSES] = sim->cache->l1d.misses;
+        values[METRIC_L2_ACCESSES] = sim->cache->l2.accesses;
+        values[METRIC_L2_MISSES] = sim->cache->l2.misses;
+    }
+    values[METRIC_HALTED] = sim->halted;
+    for (int i = 0; i < m->device_count; i++) {
+        Device *dev = &sim->bus->devices[m->devices[i].slot];
+        if (dev->active && dev->counter) {
+            values[METRIC_DEVICE_FIRST + i] = dev->counter(sim, dev->opaque);
+        }
+    }
+
+    uint64_t seq = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        atomic_store_explicit(&m->values[i], values[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&m->seq, seq + 2, memory_order_release);
+
+    m->next_publish = sim->instructions_executed + METRICS_PUBLISH_INSTRUCTIONS;
+}
+
+// ==========================================
+// Sampler side
+// ==========================================
+
+static void metrics_snapshot(Metrics *m, uint64_t values[METRIC_COUNT]) {
+    for (;;) {
+        uint64_t before = atomic_load_explicit(&m->seq, memory_order_acquire);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        for (int i = 0; i < METRIC_COUNT; i++) {
+            values[i] = atomic_load_explicit(&m->values[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&m->seq, memory_order_relaxed) == before) return;
+    }
+}
+
+static int metrics_connect(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    size_t len = strlen(path);
+    if (len >= sizeof(addr.sun_path)) {
+        close(fd);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr.sun_path, path, len);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int metrics_open(Metrics *m) {
+    if (m->socket) return metrics_connect(m->path);
+    return open(m->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+static double metrics_hit_rate(uint64_t accesses, uint64_t misses) {
+    return accesses ? 1.0 - (double)misses / accesses : 1.0;
+}
+
+static void metrics_sample(Metrics *m) {
+    uint64_t v[METRIC_COUNT];
+    metrics_snapshot(m, v);
+
+    uint64_t now = host_monotonic_ns();
+    double seconds = (now - m->last_ns) / 1e9;
+    double ips = seconds > 0 ? (v[METRIC_INSTRUCTIONS] - m->last_instructions) / seconds : 0.0;
+    m->last_ns = now;
+    m->last_instructions = v[METRIC_INSTRUCTIONS];
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+
+    char line[1024];
+    int len = snprintf(line, sizeof(line),
+                       "bebosim ts_ms=%lu instructions=%lu cycles=%lu ips=%.0f memory_accesses=%lu "
+                       "memory_writes=%lu io_reads=%lu io_effects=%lu interrupts=%lu idle_cycles=%lu",
+                       (unsigned long)wall.tv_sec * 1000 + wall.tv_nsec / 1000000,
+                       (unsigned long)v[METRIC_INSTRUCTIONS], (unsigned long)v[METRIC_CYCLES], ips,
+                       (unsigned long)v[METRIC_MEMORY_ACCESSES], (unsigned long)v[METRIC_MEMORY_WRITES],
+                       (unsigned long)v[METRIC_IO_READS], (unsigned long)v[METRIC_IO_EFFECTS],
+                       (unsigned long)v[METRIC_INTERRUPTS], (unsigned long)v[METRIC_IDLE_CYCLES]);
+    if (m->cache) {
+        len += snprintf(line + len, sizeof(line) - len, " l1i_hit=%.4f l1d_hit=%.4f l2_hit=%.4f",
+                        metrics_hit_rate(v[METRIC_L1I_ACCESSES], v[METRIC_L1I_MISSES]),
+                        metrics_hit_rate(v[METRIC_L1D_ACCESSES], v[METRIC_L1D_MISSES]),
+                        metrics_hit_rate(v[METRIC_L2_ACCESSES], v[METRIC_L2_MISSES]));
+    }
+    for (int i = 0; i < m->device_count; i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %s=%lu", m->devices[i].name,
+                        (unsigned long)v[METRIC_DEVICE_FIRST + i]);
+    }
+    len += snprintf(line + len, sizeof(line) - len, " halted=%d\n", v[METRIC_HALTED] ? 1 : 0);
+
+    // A collector that went away is reconnected on a later sample
+    if (m->fd < 0) m->fd = metrics_open(m);
+    if (m->fd < 0) return;
+    ssize_t n = m->socket ? send(m->fd, line, len, MSG_NOSIGNAL) : write(m->fd, line, len);
+    if (n != len) {
+        close(m->fd);
+        m->fd = -1;
+        return;
+    }
+    m->lines++;
+}
+
+static void *metrics_sampler(void *arg) {
+    Metrics *m = (Metrics *)arg;
+
+#ifdef SCHED_IDLE
+    // Only runs when the CPU thread leaves a core free
+    struct sched_param param = {0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    uint64_t next = host_monotonic_ns() + (uint64_t)m->interval_ms * 1000000;
+    while (!atomic_load(&m->stop)) {
+        uint64_t now = host_monotonic_ns();
+        if (now >= next) {
+            metrics_sample(m);
+            next += (uint64_t)m->interval_ms * 1000000;
+            if (next < now) next = now + (uint64_t)m->interval_ms * 1000000;
+            continue;
+        }
+        uint64_t wait = next - now;
+        if (wait > METRICS_POLL_MS * 1000000ULL) wait = METRICS_POLL_MS * 1000000ULL;
+        struct timespec ts = {wait / 1000000000, wait % 1000000000};
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+int metrics_start(SimulatorState *sim, const char *destination, uint32_t interval_ms) {
+    if (!sim || sim->metrics || !destination) return 0;
+    if (interval_ms == 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Metrics interval must be at least 1 ms\n");
+        return 0;
+    }
+
+    Metrics *m = calloc(1, sizeof(Metrics));
+    if (!m) return 0;
+    m->socket = strncmp(destination, "unix:", 5) == 0;
+    strncpy(m->path, m->socket ? destination + 5 : destination, sizeof(m->path) - 1);
+    m->interval_ms = interval_ms;
+    m->cache = sim->cache != NULL;
+    for (int i = 0; i < sim->bus->device_count && m->device_count < METRICS_MAX_DEVICES; i++) {
+        Device *dev = &sim->bus->devices[i];
+        if (!dev->active || !dev->counter || !dev->counter_name) continue;
+        m->devices[m->device_count].slot = i;
+        snprintf(m->devices[m->device_count++].name, sizeof(m->devices[0].name), "%s",
+                 dev->counter_name);
+    }
+    m->fd = metrics_open(m);
+    if (m->fd < 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot open metrics %s %s: %s\n",
+                 m->socket ? "socket" : "file", m->path, strerror(errno));
+        free(m);
+        return 0;
+    }
+
+    sim->metrics = m;
+    metrics_publish(sim);
+    m->last_instructions = sim->instructions_executed;
+    m->last_ns = host_monotonic_ns();
+
+    if (pthread_create(&m->thread, NULL, metrics_sampler, m) != 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot start metrics thread\n");
+        close(m->fd);
+        free(m);
+        sim->metrics = NULL;
+        return 0;
+    }
+    m->thread_started = true;
+    return 1;
+}
+
+void metrics_stop(SimulatorState *sim) {
+    if (!sim || !sim->metrics) return;
+    Metrics *m = sim->metrics;
+
+    if (m->thread_started) {
+        atomic_store(&m->stop, true);
+        pthread_join(m->thread, NULL);
+    }
+
+    // Final state, so a collector sees where the run ended
+    metrics_publish(sim);
+    metrics_sample(m);
+
+    if (m->fd >= 0) close(m->fd);
+    free(m);
+    sim->metrics = NULL;
+}
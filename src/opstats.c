@@ -0,0 +1,124 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/opstats.h"
+
+// Instruction mix: the counters are filled in by the inline hooks in
+// opstats.h; this file owns their lifetime and the reports.
+
+int opstats_start(SimulatorState *sim) {
+    if (!sim || sim->opstats) return 0;
+#ifdef BEBO_OPCODE_STATS
+    size_t size = (sizeof(OpcodeStats) + 63) & ~(size_t)63;
+    OpcodeStats *s = aligned_alloc(64, size);
+    if (!s) return 0;
+    memset(s, 0, sizeof(OpcodeStats));
+    sim->opstats = s;
+    return 1;
+#else
+    bebo_log(BEBO_LOG_ERROR, "Error: Opcode statistics need a build with OPCODE_STATS=1\n");
+    return 0;
+#endif
+}
+
+void opstats_stop(SimulatorState *sim) {
+    if (!sim || !sim->opstats) return;
+    free(sim->opstats);
+    sim->opstats = NULL;
+}
+
+// Executed opcodes, most frequent first; returns how many
+static int opstats_sorted(OpcodeStats *s, uint8_t order[256], uint64_t *count, uint64_t *cycles) {
+    int n = 0;
+    *count = *cycles = 0;
+    for (int op = 0; op < 256; op++) {
+        if (!s->counters[op].count) continue;
+        order[n++] = (uint8_t)op;
+        *count += s->counters[op].count;
+        *cycles += s->counters[op].cycles;
+    }
+    for (int i = 1; i < n; i++) {
+        uint8_t op = order[i];
+        int j = i;
+        for (; j > 0 && s->counters[order[j - 1]].count < s->counters[op].count; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = op;
+    }
+    return n;
+}
+
+static const char* opstats_name(uint8_t opcode) {
+    OpcodeMetadata *meta = opcode_by_value((Opcode)opcode);
+    return meta ? meta->mnemonic : "?";
+}
+
+void opstats_report(SimulatorState *sim) {
+    if (!sim || !sim->opstats) return;
+    OpcodeStats *s = sim->opstats;
+    uint8_t order[256];
+    uint64_t total, cycles;
+    int n = opstats_sorted(s, order, &total, &cycles);
+    if (!total) return;
+
+    bebo_log(BEBO_LOG_INFO, "\n=== Instruction Mix ===\n");
+    bebo_log(BEBO_LOG_INFO, "%lu instructions, %lu cycles, %d opcodes\n",
+             (unsigned long)total, (unsigned long)cycles, n);
+    bebo_log(BEBO_LOG_INFO, "%-8s %4s %12s %7s %12s %7s %5s %11s %11s %11s %11s\n",
+             "opcode", "hex", "count", "%", "cycles", "%", "CPI",
+             "register", "immediate", "taken", "not taken");
+    for (int i = 0; i < n; i++) {
+        OpcodeCounter *c = &s->counters[order[i]];
+        bebo_log(BEBO_LOG_INFO, "%-8s 0x%02X %12lu %6.2f%% %12lu %6.2f%% %5.2f",
+                 opstats_name(order[i]), order[i],
+                 (unsigned long)c->count, 100.0 * c->count / total,
+                 (unsigned long)c->cycles, cycles ? 100.0 * c->cycles / cycles : 0.0,
+                 (double)c->cycles / c->count);
+        if (c->modes[OPSTATS_MODE_REG] || c->modes[OPSTATS_MODE_IMM]) {
+            bebo_log(BEBO_LOG_INFO, " %11lu %11lu", (unsigned long)c->modes[OPSTATS_MODE_REG],
+                     (unsigned long)c->modes[OPSTATS_MODE_IMM]);
+        } else {
+            bebo_log(BEBO_LOG_INFO, " %11s %11s", "-", "-");
+        }
+        if (c->taken || c->not_taken) {
+            bebo_log(BEBO_LOG_INFO, " %11lu %11lu", (unsigned long)c->taken,
+                     (unsigned long)c->not_taken);
+        }
+        bebo_log(BEBO_LOG_INFO, "\n");
+    }
+}
+
+int opstats_write_json(SimulatorState *sim, const char *path) {
+    if (!sim || !sim->opstats || !path) return 0;
+    OpcodeStats *s = sim->opstats;
+    uint8_t order[256];
+    uint64_t total, cycles;
+    int n = opstats_sorted(s, order, &total, &cycles);
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot create '%s'\n", path);
+        return 0;
+    }
+
+    fprintf(f, "{\n  \"instructions\": %lu,\n  \"cycles\": %lu,\n  \"opcodes\": [",
+            (unsigned long)total, (unsigned long)cycles);
+    for (int i = 0; i < n; i++) {
+        OpcodeCounter *c = &s->counters[order[i]];
+        fprintf(f, "%s\n    {\"opcode\": %u, \"mnemonic\": \"%s\", \"count\": %lu, \"cycles\": %lu",
+                i ? "," : "", order[i], opstats_name(order[i]),
+                (unsigned long)c->count, (unsigned long)c->cycles);
+        if (c->modes[OPSTATS_MODE_REG] || c->modes[OPSTATS_MODE_IMM]) {
+            fprintf(f, ", \"register\": %lu, \"immediate\": %lu",
+                    (unsigned long)c->modes[OPSTATS_MODE_REG],
+                    (unsigned long)c->modes[OPSTATS_MODE_IMM]);
+        }
+        if (order[i] >= OP_JZ && order[i] <= OP_JNO) {
+            fprintf(f, ", \"taken\": %lu, \"not_taken\": %lu",
+                    (unsigned long)c->taken, (unsigned long)c->not_taken);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    return fclose(f) == 0;
+}
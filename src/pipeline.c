@@ -0,0 +1,277 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/cache.h"
+#include "../include/branch.h"
+#include "../include/pipeline.h"
+
+// Pipeline timing: each retired instruction is decoded again from memory
+// for its source and destination registers, and scheduled against a
+// scoreboard of when each register's value becomes available.
+
+static const char *pipeline_stall_names[PIPE_STALL_COUNT] = {
+    "data hazard", "load-use", "branch flush", "jump/return flush", "memory"
+};
+
+typedef struct {
+    uint8_t srcs[3];
+    uint8_t dsts[3];
+    int src_count;
+    int dst_count;
+    bool load;
+    bool conditional;           // Conditional branch
+    bool jump;                  // JMP or CALL
+    bool ret;                   // RET, RETI, IRET
+    bool predicted;             // Seen by the branch predictor model
+    bool wait;
+} PipelineOp;
+
+void pipeline_default_config(PipelineConfig *config) {
+    config->forwarding = true;
+    config->branch_penalty = 2;
+    config->jump_penalty = 1;
+    config->return_penalty = 2;
+}
+
+int pipeline_parse_option(PipelineConfig *config, const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return 0;
+    size_t len = eq - spec;
+    const char *value = eq + 1;
+
+    if (len == 10 && strncmp(spec, "forwarding", len) == 0) {
+        if (strcmp(value, "on") == 0) config->forwarding = true;
+        else if (strcmp(value, "off") == 0) config->forwarding = false;
+        else return 0;
+        return 1;
+    }
+
+    char *end;
+    unsigned long cycles = strtoul(value, &end, 0);
+    if (!*value || *end || cycles > 1000) return 0;
+    if (len == 6 && strncmp(spec, "branch", len) == 0) config->branch_penalty = cycles;
+    else if (len == 4 && strncmp(spec, "jump", len) == 0) config->jump_penalty = cycles;
+    else if (len == 6 && strncmp(spec, "return", len) == 0) config->return_penalty = cycles;
+    else return 0;
+    return 1;
+}
+
+int pipeline_start(SimulatorState *sim, const PipelineConfig *config) {
+    if (!sim || sim->pipeline.model) return 0;
+
+    PipelineModel *p = calloc(1, sizeof(PipelineModel));
+    if (!p) return 0;
+    p->config = *config;
+    p->memory_cycles = sim->cache ? sim->cache->cycles : 0;
+
+    sim->pipeline.model = p;
+    return 1;
+}
+
+void pipeline_stop(SimulatorState *sim) {
+    if (!sim || !sim->pipeline.model) return;
+    free(sim->pipeline.model);
+    sim->pipeline.model = NULL;
+}
+
+static uint8_t pipeline_byte(SimulatorState *sim, uint32_t address) {
+    return address < MEMORY_SIZE ? sim->memory[address] : 0;
+}
+
+static void pipeline_src(PipelineOp *op, uint8_t reg) {
+    if (op->src_count < 3) op->srcs[op->src_count++] = reg < NUM_REGISTERS ? reg : 0;
+}
+
+static void pipeline_dst(PipelineOp *op, uint8_t reg) {
+    if (op->dst_count < 3) op->dsts[op->dst_count++] = reg < NUM_REGISTERS ? reg : 0;
+}
+
+// Register operands follow the encodings execute_* reads
+static void pipeline_decode(SimulatorState *sim, uint32_t pc, PipelineOp *op) {
+    uint8_t opcode = pipeline_byte(sim, pc);
+    uint8_t a = pipeline_byte(sim, pc + 1);
+    uint8_t b = pipeline_byte(sim, pc + 2);
+    uint8_t c = pipeline_byte(sim, pc + 3);
+    uint8_t d = pipeline_byte(sim, pc + 4);
+    memset(op, 0, sizeof(*op));
+
+    switch (opcode) {
+        case OP_MOV:
+        case OP_MOVW:
+            if (b == 0) pipeline_src(op, c);
+            pipeline_dst(op, a);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_SHL:
+        case OP_SHR:
+            pipeline_src(op, b);
+            if (c == 0) pipeline_src(op, d);
+            pipeline_dst(op, a);
+            op->dsts[op->dst_count++] = PIPE_REG_FLAGS;
+            break;
+        case OP_CMP:
+            pipeline_src(op, a);
+            if (b == 0) pipeline_src(op, c);
+            op->dsts[op->dst_count++] = PIPE_REG_FLAGS;
+            break;
+        case OP_INC:
+        case OP_DEC:
+        case OP_NOT:
+            pipeline_src(op, a);
+            pipeline_dst(op, a);
+            op->dsts[op->dst_count++] = PIPE_REG_FLAGS;
+            break;
+        case OP_LOAD:
+        case OP_LOADB:
+        case OP_LOADH:
+            if (b == 0) pipeline_src(op, c);
+            pipeline_dst(op, a);
+            op->load = true;
+            break;
+        case OP_STORE:
+        case OP_STOREB:
+        case OP_STOREH:
+            pipeline_src(op, a);
+            if (b == 0) pipeline_src(op, c);
+            break;
+        case OP_PUSH:
+            pipeline_src(op, a);
+            pipeline_src(op, REG_SP);
+            pipeline_dst(op, REG_SP);
+            break;
+        case OP_POP:
+            pipeline_src(op, REG_SP);
+            pipeline_dst(op, a);
+            pipeline_dst(op, REG_SP);
+            op->load = true;
+            break;
+        case OP_IN:
+        case OP_INB:
+            pipeline_dst(op, a);
+            break;
+        case OP_OUT:
+        case OP_OUTB:
+            pipeline_src(op, c);
+            break;
+        case OP_JZ: case OP_JNZ: case OP_JE: case OP_JNE: case OP_JG: case OP_JGE:
+        case OP_JL: case OP_JLE: case OP_JC: case OP_JNC: case OP_JO: case OP_JNO:
+            op->srcs[op->src_count++] = PIPE_REG_FLAGS;
+            op->conditional = true;
+            op->predicted = true;
+            break;
+        case OP_WAIT:
+            op->wait = true;
+            break;
+        case OP_JMP:
+            op->jump = true;
+            op->predicted = true;
+            break;
+        case OP_CALL:
+            op->srcs[op->src_count++] = PIPE_REG_CALL_SP;
+            op->dsts[op->dst_count++] = PIPE_REG_CALL_SP;
+            op->jump = true;
+            op->predicted = true;
+            break;
+        case OP_RET:
+            op->predicted = true;
+            // fall through
+        case OP_RETI:
+        case OP_IRET:
+            op->srcs[op->src_count++] = PIPE_REG_CALL_SP;
+            op->dsts[op->dst_count++] = PIPE_REG_CALL_SP;
+            op->ret = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void pipeline_retire(SimulatorState *sim, uint32_t pc, uint64_t cycles_before) {
+    PipelineModel *p = sim->pipeline.model;
+    PipelineOp op;
+    pipeline_decode(sim, pc, &op);
+
+    // Bubbles from the previous control transfer come first
+    uint64_t earliest = p->issue + 1 + p->flush;
+    p->stalls[p->flush_cause] += p->flush;
+    if (p->flush_mispredict) p->mispredict_cycles += p->flush;
+    uint64_t issue = earliest;
+    PipelineStall cause = PIPE_STALL_DATA;
+    for (int i = 0; i < op.src_count; i++) {
+        uint8_t r = op.srcs[i];
+        if (p->ready[r] > issue) {
+            issue = p->ready[r];
+            cause = p->from_load[r] ? PIPE_STALL_LOAD_USE : PIPE_STALL_DATA;
+        }
+    }
+    p->stalls[cause] += issue - earliest;
+
+    // Memory latency holds this instruction (and everything behind it);
+    // time WAIT slept through passes without counting as a stall. Idle
+    // loops are not fast-forwarded while the model runs.
+    uint64_t memory = (sim->cache ? sim->cache->cycles : 0) - p->memory_cycles;
+    uint64_t wait = op.wait ? sim->clock_cycles - cycles_before - memory : 0;
+    p->memory_cycles += memory;
+    p->stalls[PIPE_STALL_MEMORY] += memory;
+    issue += memory + wait;
+
+    // Results reach a consumer's EX via forwarding, or through the
+    // register file once written back
+    for (int i = 0; i < op.dst_count; i++) {
+        uint8_t r = op.dsts[i];
+        p->ready[r] = issue + (p->config.forwarding ? (op.load ? 2 : 1) : 3);
+        p->from_load[r] = op.load;
+    }
+
+    bool taken = op.conditional ? sim->pc != pc + 3 : (op.jump || op.ret);
+    // With a branch predictor only mispredictions flush
+    p->flush_mispredict = sim->branch && op.predicted;
+    if (p->flush_mispredict) taken = sim->branch->mispredicted;
+    p->flush = 0;
+    if (taken) {
+        p->flush = op.conditional ? p->config.branch_penalty
+                 : op.jump ? p->config.jump_penalty : p->config.return_penalty;
+        p->flush_cause = op.conditional ? PIPE_STALL_BRANCH : PIPE_STALL_JUMP;
+    }
+
+    uint64_t elapsed = issue - p->issue;
+    p->issue = issue;
+    p->instructions++;
+    p->cycles += elapsed - wait;
+    sim->clock_cycles = cycles_before + elapsed;
+
+    // Stage view after this instruction issued
+    sim->pipeline.writeback = sim->pipeline.execute;
+    sim->pipeline.execute = pc;
+    sim->pipeline.decode = sim->pc;
+    sim->pipeline.fetch = sim->pc;
+    sim->pipeline.stalled = issue - memory - wait > earliest;
+}
+
+void pipeline_report(SimulatorState *sim) {
+    if (!sim || !sim->pipeline.model) return;
+    PipelineModel *p = sim->pipeline.model;
+    if (!p->instructions) return;
+
+    uint64_t total = 0;
+    for (int i = 0; i < PIPE_STALL_COUNT; i++) total += p->stalls[i];
+
+    bebo_log(BEBO_LOG_INFO, "\n=== Pipeline Model ===\n");
+    bebo_log(BEBO_LOG_INFO, "5-stage in-order, forwarding %s, penalties: branch %u, jump %u, return %u\n",
+             p->config.forwarding ? "on" : "off", p->config.branch_penalty,
+             p->config.jump_penalty, p->config.return_penalty);
+    bebo_log(BEBO_LOG_INFO, "Instructions: %lu, cycles: %lu, CPI: %.3f\n",
+             (unsigned long)p->instructions, (unsigned long)p->cycles,
+             (double)p->cycles / p->instructions);
+    bebo_log(BEBO_LOG_INFO, "%-20s %14s %8s %8s\n", "stall", "cycles", "%", "CPI");
+    for (int i = 0; i < PIPE_STALL_COUNT; i++) {
+        bebo_log(BEBO_LOG_INFO, "%-20s %14lu %7.2f%% %8.3f\n", pipeline_stall_names[i],
+                 (unsigned long)p->stalls[i], p->cycles ? 100.0 * p->stalls[i] / p->cycles : 0.0,
+                 (double)p->stalls[i] / p->instructions);
+    }
+    bebo_log(BEBO_LOG_INFO, "%-20s %14lu %7.2f%% %8.3f\n", "total stalls", (unsigned long)total,
+             p->cycles ? 100.0 * total / p->cycles : 0.0, (double)total / p->instructions);
+}
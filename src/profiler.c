@@ -0,0 +1,525 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/profiler.h"
+
+// Guest profiler: per-PC counters (exact) or periodic PC samples, plus a
+// tree of call stacks built from CALL/RET and interrupt entry/return.
+// Reports are symbolised with code labels from the assembler or from a
+// beboasm --map file.
+
+typedef struct {
+    uint32_t caller;
+    uint32_t entry;
+    uint64_t calls;
+    uint64_t self;
+    uint64_t total;
+    uint64_t self_instructions;
+    uint64_t total_instructions;
+} ProfileTotals;
+
+typedef struct {
+    uint32_t pc;
+    uint64_t instructions;
+    uint64_t cycles;
+} ProfileHotspot;
+
+static ProfileFrame* profile_frame_child(ProfileFrame *parent, uint32_t entry) {
+    for (ProfileFrame *f = parent->child; f; f = f->sibling) {
+        if (f->entry == entry) return f;
+    }
+    ProfileFrame *f = calloc(1, sizeof(ProfileFrame));
+    if (!f) return NULL;
+    f->entry = entry;
+    f->parent = parent;
+    f->sibling = parent->child;
+    parent->child = f;
+    return f;
+}
+
+static void profile_frame_free(ProfileFrame *f) {
+    while (f) {
+        ProfileFrame *next = f->sibling;
+        profile_frame_free(f->child);
+        free(f);
+        f = next;
+    }
+}
+
+// Next sample in [period/2, 3*period/2) so a loop whose length divides
+// the period is not always caught at the same instruction
+static uint64_t profiler_interval(Profiler *p) {
+    p->jitter ^= p->jitter << 13;
+    p->jitter ^= p->jitter >> 17;
+    p->jitter ^= p->jitter << 5;
+    uint64_t interval = p->period / 2 + p->jitter % p->period;
+    return interval ? interval : 1;
+}
+
+static void profiler_sample(SimulatorState *sim, void *opaque) {
+    Profiler *p = (Profiler *)opaque;
+
+    uint32_t i = sim->pc - p->code_base;
+    if (i < p->code_size) {
+        p->instructions[i]++;
+    } else {
+        p->other_instructions++;
+    }
+    p->top->weight++;
+
+    p->event_id = event_schedule_observer(sim, sim->clock_cycles + profiler_interval(p), profiler_sample, p);
+}
+
+int profiler_start(SimulatorState *sim, ProfileMode mode, uint64_t period,
+                   uint32_t code_base, uint32_t code_size) {
+    if (!sim || sim->profiler) return 0;
+    if (mode == PROFILE_SAMPLE && period == 0) return 0;
+    if (code_base >= MEMORY_SIZE) code_size = 0;
+    if (code_size > MEMORY_SIZE - code_base) code_size = MEMORY_SIZE - code_base;
+
+    Profiler *p = calloc(1, sizeof(Profiler));
+    if (!p) return 0;
+    p->mode = mode;
+    p->period = period;
+    p->jitter = 0x2545F491;
+    p->code_base = code_base;
+    p->code_size = code_size;
+
+    p->root = calloc(1, sizeof(ProfileFrame));
+    p->instructions = calloc(code_size ? code_size : 1, sizeof(uint64_t));
+    if (mode == PROFILE_EXACT) p->cycles = calloc(code_size ? code_size : 1, sizeof(uint64_t));
+    if (!p->root || !p->instructions || (mode == PROFILE_EXACT && !p->cycles)) {
+        free(p->root);
+        free(p->instructions);
+        free(p->cycles);
+        free(p);
+        return 0;
+    }
+    p->root->entry = sim->pc;
+    p->top = p->current = p->root;
+
+    if (mode == PROFILE_SAMPLE) {
+        p->event_id = event_schedule_observer(sim, sim->clock_cycles + profiler_interval(p), profiler_sample, p);
+    }
+
+    sim->profiler = p;
+    return 1;
+}
+
+void profiler_stop(SimulatorState *sim) {
+    if (!sim || !sim->profiler) return;
+    Profiler *p = sim->profiler;
+
+    if (p->event_id) event_cancel(sim, p->event_id);
+    profile_frame_free(p->root);
+    free(p->instructions);
+    free(p->cycles);
+    symtab_free(&p->symbols);
+    free(p);
+    sim->profiler = NULL;
+}
+
+// ==========================================
+// Call stack
+// ==========================================
+
+void profiler_call(SimulatorState *sim, uint32_t target, uint32_t return_addr) {
+    Profiler *p = sim->profiler;
+    ProfileFrame *f = p->depth < PROFILE_MAX_DEPTH ? profile_frame_child(p->top, target) : NULL;
+    if (!f) {
+        // Too deep (or out of memory): the call still counts, against
+        // the innermost frame that has one
+        p->top->calls++;
+        p->folded++;
+        return;
+    }
+    f->calls++;
+    p->stack[p->depth].frame = f;
+    p->stack[p->depth].return_addr = return_addr;
+    p->depth++;
+    p->top = f;
+}
+
+// RET pops back to the innermost frame expecting 'target'. Frames above
+// it were abandoned (the guest reset SP or returned past them) and are
+// unwound; a RET to an address no frame expects is a computed jump
+// (PUSH addr / RET) and leaves the stack alone.
+void profiler_ret(SimulatorState *sim, uint32_t target) {
+    Profiler *p = sim->profiler;
+    if (p->folded) {
+        p->folded--;
+        return;
+    }
+    for (int i = p->depth - 1; i >= 0; i--) {
+        if (p->stack[i].return_addr == target) {
+            p->unwound += p->depth - 1 - i;
+            p->depth = i;
+            p->top = i ? p->stack[i - 1].frame : p->root;
+            return;
+        }
+    }
+    p->mismatched++;
+}
+
+// Interrupt entry is a call made between instructions, so the handler's
+// first instruction is charged to the handler
+void profiler_interrupt(SimulatorState *sim, uint32_t handler, uint32_t return_addr) {
+    profiler_call(sim, handler, return_addr);
+    sim->profiler->current = sim->profiler->top;
+}
+
+// ==========================================
+// Symbols
+// ==========================================
+
+int profiler_add_symbols(SimulatorState *sim, AssemblerState *state) {
+    if (!sim || !sim->profiler || !state) return 0;
+    return symtab_add_assembler(&sim->profiler->symbols, NULL, state, SYM_CODE);
+}
+
+int profiler_load_map(SimulatorState *sim, const char *path) {
+    if (!sim || !sim->profiler || !path) return 0;
+    return symtab_load_map(&sim->profiler->symbols, NULL, path, SYM_CODE);
+}
+
+// ==========================================
+// Output
+// ==========================================
+
+// Per-function rows have caller == PROFILE_NO_CALLER; per-edge rows
+// are keyed on (caller, callee)
+#define PROFILE_NO_CALLER       0xFFFFFFFF
+#define PROFILE_TREE_MIN_SHARE  0.005   // Call tree hides subtrees below 0.5%
+
+typedef struct {
+    ProfileTotals *rows;
+    int count;
+    int capacity;
+} TotalsTable;
+
+static ProfileTotals* totals_find(TotalsTable *t, uint32_t caller, uint32_t entry) {
+    for (int i = 0; i < t->count; i++) {
+        if (t->rows[i].entry == entry && t->rows[i].caller == caller) return &t->rows[i];
+    }
+    if (t->count == t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : 64;
+        ProfileTotals *grown = realloc(t->rows, capacity * sizeof(ProfileTotals));
+        if (!grown) return NULL;
+        t->rows = grown;
+        t->capacity = capacity;
+    }
+    ProfileTotals *row = &t->rows[t->count++];
+    memset(row, 0, sizeof(*row));
+    row->caller = caller;
+    row->entry = entry;
+    return row;
+}
+
+// Inclusive cost of every frame
+static void frame_sum(ProfileFrame *f) {
+    f->total = f->weight;
+    f->total_instructions = f->instructions;
+    for (ProfileFrame *c = f->child; c; c = c->sibling) {
+        frame_sum(c);
+        f->total += c->total;
+        f->total_instructions += c->total_instructions;
+    }
+}
+
+// Fold frames into per-function and per-edge rows. A recursive frame
+// adds to inclusive totals only at its outermost activation, so time
+// is not counted once per level of recursion.
+static void totals_collect(TotalsTable *functions, TotalsTable *edges, ProfileFrame *f) {
+    bool outermost = true;
+    for (ProfileFrame *a = f->parent; a; a = a->parent) {
+        if (a->entry == f->entry) {
+            outermost = false;
+            break;
+        }
+    }
+
+    ProfileTotals *fn = totals_find(functions, PROFILE_NO_CALLER, f->entry);
+    if (fn) {
+        fn->calls += f->calls;
+        fn->self += f->weight;
+        fn->self_instructions += f->instructions;
+        if (outermost) {
+            fn->total += f->total;
+            fn->total_instructions += f->total_instructions;
+        }
+    }
+
+    ProfileTotals *edge = f->parent ? totals_find(edges, f->parent->entry, f->entry) : NULL;
+    if (edge) {
+        edge->calls += f->calls;
+        if (outermost) {
+            edge->total += f->total;
+            edge->total_instructions += f->total_instructions;
+        }
+    }
+
+    for (ProfileFrame *c = f->child; c; c = c->sibling) {
+        totals_collect(functions, edges, c);
+    }
+}
+
+static int totals_by_self(const void *a, const void *b) {
+    const ProfileTotals *x = (const ProfileTotals *)a;
+    const ProfileTotals *y = (const ProfileTotals *)b;
+    if (x->self != y->self) return x->self < y->self ? 1 : -1;
+    return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+static int totals_by_total(const void *a, const void *b) {
+    const ProfileTotals *x = (const ProfileTotals *)a;
+    const ProfileTotals *y = (const ProfileTotals *)b;
+    if (x->total != y->total) return x->total < y->total ? 1 : -1;
+    return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+static int frame_by_total(const void *a, const void *b) {
+    const ProfileFrame *x = *(const ProfileFrame * const *)a;
+    const ProfileFrame *y = *(const ProfileFrame * const *)b;
+    if (x->total != y->total) return x->total < y->total ? 1 : -1;
+    return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+static int frame_by_self(const void *a, const void *b) {
+    const ProfileFrame *x = *(const ProfileFrame * const *)a;
+    const ProfileFrame *y = *(const ProfileFrame * const *)b;
+    if (x->weight != y->weight) return x->weight < y->weight ? 1 : -1;
+    return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+static int hotspot_compare(const void *a, const void *b) {
+    const ProfileHotspot *x = (const ProfileHotspot *)a;
+    const ProfileHotspot *y = (const ProfileHotspot *)b;
+    uint64_t cx = x->cycles ? x->cycles : x->instructions;
+    uint64_t cy = y->cycles ? y->cycles : y->instructions;
+    if (cx != cy) return cx < cy ? 1 : -1;
+    return (x->pc > y->pc) - (x->pc < y->pc);
+}
+
+static void report_tree(Profiler *p, ProfileFrame *f, int depth, uint64_t total) {
+    char name[MAX_LABEL_LEN + 16];
+    if (p->mode == PROFILE_EXACT) {
+        bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu %12lu %10lu  %*s%s\n",
+                 (unsigned long)f->total, 100.0 * f->total / total, (unsigned long)f->weight,
+                 (unsigned long)f->total_instructions, (unsigned long)f->calls,
+                 depth * 2, "", symtab_format(&p->symbols, f->entry, name, sizeof(name)));
+    } else {
+        bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu %10lu  %*s%s\n",
+                 (unsigned long)f->total, 100.0 * f->total / total, (unsigned long)f->weight,
+                 (unsigned long)f->calls, depth * 2, "",
+                 symtab_format(&p->symbols, f->entry, name, sizeof(name)));
+    }
+
+    int count = 0;
+    for (ProfileFrame *c = f->child; c; c = c->sibling) count++;
+    if (count == 0) return;
+
+    ProfileFrame **children = malloc(count * sizeof(ProfileFrame *));
+    if (!children) return;
+    count = 0;
+    for (ProfileFrame *c = f->child; c; c = c->sibling) children[count++] = c;
+    qsort(children, count, sizeof(ProfileFrame *), frame_by_total);
+
+    for (int i = 0; i < count; i++) {
+        if (children[i]->total < total * PROFILE_TREE_MIN_SHARE) break;
+        report_tree(p, children[i], depth + 1, total);
+    }
+    free(children);
+}
+
+static void collect_frames(ProfileFrame *f, ProfileFrame **out, int *count) {
+    if (f->weight) out[(*count)++] = f;
+    for (ProfileFrame *c = f->child; c; c = c->sibling) collect_frames(c, out, count);
+}
+
+static int count_frames(ProfileFrame *f) {
+    int count = 1;
+    for (ProfileFrame *c = f->child; c; c = c->sibling) count += count_frames(c);
+    return count;
+}
+
+// The call stacks where the most self cost was spent, outermost first
+static void report_paths(Profiler *p, int max_rows, uint64_t total) {
+    int count = 0;
+    ProfileFrame **frames = malloc(count_frames(p->root) * sizeof(ProfileFrame *));
+    if (!frames) return;
+    collect_frames(p->root, frames, &count);
+    qsort(frames, count, sizeof(ProfileFrame *), frame_by_self);
+
+    char path[1024];
+    char name[MAX_LABEL_LEN + 16];
+    ProfileFrame *chain[PROFILE_MAX_DEPTH + 1];
+    for (int i = 0; i < count && i < max_rows; i++) {
+        int depth = 0;
+        for (ProfileFrame *f = frames[i]; f && depth <= PROFILE_MAX_DEPTH; f = f->parent) {
+            chain[depth++] = f;
+        }
+
+        size_t len = 0;
+        path[0] = '\0';
+        for (int d = depth - 1; d >= 0 && len < sizeof(path); d--) {
+            int n = snprintf(path + len, sizeof(path) - len, "%s%s", d == depth - 1 ? "" : " > ",
+                             symtab_format(&p->symbols, chain[d]->entry, name, sizeof(name)));
+            if (n < 0) break;
+            len += n;
+        }
+        bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%%  %s\n", (unsigned long)frames[i]->weight,
+                 100.0 * frames[i]->weight / total, path);
+    }
+    free(frames);
+}
+
+void profiler_report(SimulatorState *sim, int max_rows) {
+    if (!sim || !sim->profiler) return;
+    Profiler *p = sim->profiler;
+    bool exact = p->mode == PROFILE_EXACT;
+    const char *unit = exact ? "cycles" : "samples";
+    char name[MAX_LABEL_LEN + 16];
+    char caller[MAX_LABEL_LEN + 16];
+
+    frame_sum(p->root);
+    uint64_t total = p->root->total ? p->root->total : 1;
+
+    TotalsTable functions = {0};
+    TotalsTable edges = {0};
+    totals_collect(&functions, &edges, p->root);
+
+    if (exact) {
+        bebo_log(BEBO_LOG_INFO, "\n=== Profile: exact ===\n");
+    } else {
+        bebo_log(BEBO_LOG_INFO, "\n=== Profile: sampled every %lu cycles ===\n", (unsigned long)p->period);
+    }
+
+    qsort(functions.rows, functions.count, sizeof(ProfileTotals), totals_by_self);
+    if (exact) {
+        bebo_log(BEBO_LOG_INFO, "%12s %7s %12s %7s %12s %12s %10s  function\n",
+                 "cycles", "self%", "total", "total%", "instrs", "total instrs", "calls");
+    } else {
+        bebo_log(BEBO_LOG_INFO, "%12s %7s %12s %7s %10s  function\n",
+                 "samples", "self%", "total", "total%", "calls");
+    }
+    for (int i = 0; i < functions.count && i < max_rows; i++) {
+        ProfileTotals *fn = &functions.rows[i];
+        symtab_format(&p->symbols, fn->entry, name, sizeof(name));
+        if (exact) {
+            bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu %6.2f%% %12lu %12lu %10lu  %s\n",
+                     (unsigned long)fn->self, 100.0 * fn->self / total,
+                     (unsigned long)fn->total, 100.0 * fn->total / total,
+                     (unsigned long)fn->self_instructions, (unsigned long)fn->total_instructions,
+                     (unsigned long)fn->calls, name);
+        } else {
+            bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu %6.2f%% %10lu  %s\n",
+                     (unsigned long)fn->self, 100.0 * fn->self / total,
+                     (unsigned long)fn->total, 100.0 * fn->total / total,
+                     (unsigned long)fn->calls, name);
+        }
+    }
+
+    if (p->call_graph) {
+        bebo_log(BEBO_LOG_INFO, "\nCall tree:\n");
+        if (exact) {
+            bebo_log(BEBO_LOG_INFO, "%12s %7s %12s %12s %10s  function\n",
+                     "total", "%", "self", "total instrs", "calls");
+        } else {
+            bebo_log(BEBO_LOG_INFO, "%12s %7s %12s %10s  function\n", "total", "%", "self", "calls");
+        }
+        report_tree(p, p->root, 0, total);
+
+        qsort(edges.rows, edges.count, sizeof(ProfileTotals), totals_by_total);
+        bebo_log(BEBO_LOG_INFO, "\nCall edges:\n%12s %7s %12s  caller -> callee\n", unit, "%", "calls");
+        for (int i = 0; i < edges.count && i < max_rows; i++) {
+            ProfileTotals *e = &edges.rows[i];
+            bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu  %s -> %s\n",
+                     (unsigned long)e->total, 100.0 * e->total / total, (unsigned long)e->calls,
+                     symtab_format(&p->symbols, e->caller, caller, sizeof(caller)),
+                     symtab_format(&p->symbols, e->entry, name, sizeof(name)));
+        }
+
+        bebo_log(BEBO_LOG_INFO, "\nTop call paths (self %s):\n", unit);
+        report_paths(p, max_rows, total);
+
+        if (p->unwound || p->mismatched) {
+            bebo_log(BEBO_LOG_INFO, "\nShadow stack: %lu frames unwound by RET to an outer caller, "
+                     "%lu RETs to no caller on the stack\n",
+                     (unsigned long)p->unwound, (unsigned long)p->mismatched);
+        }
+    }
+    free(functions.rows);
+    free(edges.rows);
+
+    // Hottest addresses
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < p->code_size; i++) {
+        if (p->instructions[i]) used++;
+    }
+    ProfileHotspot *spots = malloc((used ? used : 1) * sizeof(ProfileHotspot));
+    if (!spots) return;
+    used = 0;
+    for (uint32_t i = 0; i < p->code_size; i++) {
+        if (!p->instructions[i]) continue;
+        spots[used].pc = p->code_base + i;
+        spots[used].instructions = p->instructions[i];
+        spots[used].cycles = exact ? p->cycles[i] : 0;
+        used++;
+    }
+    qsort(spots, used, sizeof(ProfileHotspot), hotspot_compare);
+
+    if (exact) {
+        bebo_log(BEBO_LOG_INFO, "\n%12s %7s %12s  address   symbol\n", "cycles", "%", "count");
+    } else {
+        bebo_log(BEBO_LOG_INFO, "\n%12s %7s  address   symbol\n", "samples", "%");
+    }
+    for (uint32_t i = 0; i < used && i < (uint32_t)max_rows; i++) {
+        ProfileHotspot *s = &spots[i];
+        symtab_format(&p->symbols, s->pc, name, sizeof(name));
+        if (exact) {
+            bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%% %12lu  0x%06X  %s\n", (unsigned long)s->cycles,
+                     100.0 * s->cycles / total, (unsigned long)s->instructions, s->pc, name);
+        } else {
+            bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%%  0x%06X  %s\n", (unsigned long)s->instructions,
+                     100.0 * s->instructions / total, s->pc, name);
+        }
+    }
+    if (p->other_instructions) {
+        bebo_log(BEBO_LOG_INFO, "%12lu %6.2f%%  outside 0x%06X-0x%06X\n",
+                 (unsigned long)(exact ? p->other_cycles : p->other_instructions),
+                 100.0 * (exact ? p->other_cycles : p->other_instructions) / total,
+                 p->code_base, p->code_base + p->code_size);
+    }
+    free(spots);
+}
+
+static void profile_write_frame(Profiler *p, FILE *f, ProfileFrame *frame,
+                                char *path, size_t len, size_t size) {
+    char name[MAX_LABEL_LEN + 16];
+    int n = snprintf(path + len, size - len, "%s%s", len ? ";" : "",
+                     symtab_format(&p->symbols, frame->entry, name, sizeof(name)));
+    if (n < 0 || (size_t)n >= size - len) return;
+    len += n;
+
+    if (frame->weight) fprintf(f, "%s %lu\n", path, (unsigned long)frame->weight);
+    for (ProfileFrame *c = frame->child; c; c = c->sibling) {
+        profile_write_frame(p, f, c, path, len, size);
+    }
+}
+
+int profiler_write_collapsed(SimulatorState *sim, const char *path) {
+    if (!sim || !sim->profiler || !path) return 0;
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot create '%s'\n", path);
+        return 0;
+    }
+
+    size_t size = (PROFILE_MAX_DEPTH + 1) * (MAX_LABEL_LEN + 16);
+    char *stack = malloc(size);
+    int ok = stack != NULL;
+    if (stack) profile_write_frame(sim->profiler, f, sim->profiler->root, stack, 0, size);
+    free(stack);
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
@@ -0,0 +1,158 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include <time.h>
+
+// RTC register offsets from PORT_RTC_BASE. Reading a _LO register latches
+// the matching _HI half so 64-bit values can be read without tearing.
+#define RTC_REG_SIM_US_LO   0   // Simulated microseconds (clock_cycles / clock_hz)
+#define RTC_REG_SIM_US_HI   1
+#define RTC_REG_HOST_US_LO  2   // Host monotonic microseconds since start
+#define RTC_REG_HOST_US_HI  3
+#define RTC_REG_CLOCK_HZ    4   // Simulated clock frequency
+#define RTC_REG_EPOCH       5   // Host wall clock, seconds since 1970
+
+#define PACE_SLICES_PER_SEC 100         // Throttle granularity (10ms of simulated time)
+#define NSEC_PER_SEC        1000000000ULL
+
+typedef struct {
+    uint64_t start_ns;
+    uint32_t latched_hi;
+
+    // Pacing / throughput reporting
+    bool throttle;
+    bool report;
+    uint32_t event_id;
+    uint64_t pace_start_ns;
+    uint64_t pace_start_cycles;
+    uint64_t report_ns;
+    uint64_t report_cycles;
+    uint64_t report_instructions;
+    uint64_t sleep_ns;
+} Rtc;
+
+uint64_t host_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static uint64_t rtc_sim_us(SimulatorState *sim) {
+    uint64_t hz = sim->clock_hz ? sim->clock_hz : DEFAULT_CLOCK_HZ;
+    return sim->clock_cycles / hz * 1000000 + (sim->clock_cycles % hz) * 1000000 / hz;
+}
+
+static uint32_t rtc_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    Rtc *rtc = (Rtc *)opaque;
+
+    switch (port - PORT_RTC_BASE) {
+        case RTC_REG_SIM_US_LO: {
+            uint64_t us = rtc_sim_us(sim);
+            rtc->latched_hi = (uint32_t)(us >> 32);
+            return (uint32_t)us;
+        }
+        case RTC_REG_HOST_US_LO: {
+            uint64_t us = (host_monotonic_ns() - rtc->start_ns) / 1000;
+            rtc->latched_hi = (uint32_t)(us >> 32);
+            return (uint32_t)us;
+        }
+        case RTC_REG_SIM_US_HI:
+        case RTC_REG_HOST_US_HI:
+            return rtc->latched_hi;
+        case RTC_REG_CLOCK_HZ:
+            return (uint32_t)sim->clock_hz;
+        case RTC_REG_EPOCH:
+            return (uint32_t)time(NULL);
+    }
+    return 0;
+}
+
+// Runs every 1/PACE_SLICES_PER_SEC of simulated time. When throttling,
+// sleeps until the host catches up with the simulated clock; when
+// reporting, prints throughput once per second of host time.
+static void rtc_pace(SimulatorState *sim, void *opaque) {
+    Rtc *rtc = (Rtc *)opaque;
+    uint64_t now = host_monotonic_ns();
+
+    if (rtc->throttle) {
+        uint64_t cycles = sim->clock_cycles - rtc->pace_start_cycles;
+        uint64_t target = rtc->pace_start_ns +
+                          cycles / sim->clock_hz * NSEC_PER_SEC +
+                          (cycles % sim->clock_hz) * NSEC_PER_SEC / sim->clock_hz;
+        if (target > now) {
+            struct timespec ts = {(time_t)((target - now) / NSEC_PER_SEC),
+                                  (long)((target - now) % NSEC_PER_SEC)};
+            nanosleep(&ts, NULL);
+            rtc->sleep_ns += target - now;
+            now = target;
+        }
+    }
+
+    if (rtc->report && now - rtc->report_ns >= NSEC_PER_SEC) {
+        double seconds = (double)(now - rtc->report_ns) / NSEC_PER_SEC;
+        bebo_log(BEBO_LOG_ERROR, "[bebosim] %.2f MIPS, %.2f MHz effective\n",
+                 (sim->instructions_executed - rtc->report_instructions) / seconds / 1e6,
+                 (sim->clock_cycles - rtc->report_cycles) / seconds / 1e6);
+        rtc->report_ns = now;
+        rtc->report_cycles = sim->clock_cycles;
+        rtc->report_instructions = sim->instructions_executed;
+    }
+
+    uint64_t slice = sim->clock_hz / PACE_SLICES_PER_SEC;
+    rtc->event_id = event_schedule_observer(sim, sim->clock_cycles + (slice ? slice : 1), rtc_pace, rtc);
+}
+
+static void rtc_print_stats(SimulatorState *sim, void *opaque) {
+    Rtc *rtc = (Rtc *)opaque;
+    bebo_log(BEBO_LOG_INFO, "Simulated time: %.6f seconds at %.2f MHz\n",
+             (double)rtc_sim_us(sim) / 1e6, sim->clock_hz / 1e6);
+    if (rtc->throttle) {
+        bebo_log(BEBO_LOG_INFO, "Throttle sleep: %.3f seconds\n", (double)rtc->sleep_ns / NSEC_PER_SEC);
+    }
+}
+
+static void rtc_destroy(void *opaque) {
+    free(opaque);
+}
+
+int rtc_attach(SimulatorState *sim) {
+    Rtc *rtc = calloc(1, sizeof(Rtc));
+    if (!rtc) return 0;
+
+    rtc->start_ns = host_monotonic_ns();
+
+    Device *dev = device_register(sim, "rtc", PORT_RTC_BASE, PORT_RTC_COUNT, rtc_read, NULL, rtc);
+    if (!dev) {
+        free(rtc);
+        return 0;
+    }
+    dev->idle_reads = ~0ULL;
+    dev->state_size = sizeof(Rtc);
+    dev->print_stats = rtc_print_stats;
+    dev->destroy = rtc_destroy;
+    return 1;
+}
+
+// Throttle to sim->clock_hz and/or print per-second throughput. With both
+// off no pacing event is scheduled and the simulator runs flat out.
+int rtc_set_pacing(SimulatorState *sim, bool throttle, bool report) {
+    Device *dev = device_find(sim, "rtc");
+    if (!dev || !sim->clock_hz) return 0;
+
+    Rtc *rtc = (Rtc *)dev->opaque;
+    if (rtc->event_id) {
+        event_cancel(sim, rtc->event_id);
+        rtc->event_id = 0;
+    }
+
+    rtc->throttle = throttle;
+    rtc->report = report;
+    rtc->pace_start_ns = rtc->report_ns = host_monotonic_ns();
+    rtc->pace_start_cycles = rtc->report_cycles = sim->clock_cycles;
+    rtc->report_instructions = sim->instructions_executed;
+
+    if (throttle || report) {
+        uint64_t slice = sim->clock_hz / PACE_SLICES_PER_SEC;
+        rtc->event_id = event_schedule_observer(sim, sim->clock_cycles + (slice ? slice : 1), rtc_pace, rtc);
+    }
+    return 1;
+}
@@ -0,0 +1,170 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// Semihosting: SVC #0 / TRAP #0 with the function number in R0 and
+// arguments in R1-R3. The result is returned in R0 (0xFFFFFFFF on error).
+
+static struct timespec semihost_epoch;
+static bool semihost_epoch_set = false;
+
+static int semihost_host_fd(SimulatorState *sim, uint32_t handle) {
+    if (handle < SEMIHOST_MAX_FILES) {
+        return sim->semihost_fds[handle];
+    }
+    return -1;
+}
+
+// Copy a NUL-terminated guest string into a host buffer
+static bool semihost_guest_string(SimulatorState *sim, uint32_t address, char *out, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (address + i >= MEMORY_SIZE) return false;
+        out[i] = (char)sim->memory[address + i];
+        if (out[i] == '\0') return true;
+    }
+    return false;
+}
+
+static uint32_t semihost_write(SimulatorState *sim, uint32_t handle, uint32_t address, uint32_t len) {
+    uint8_t *buf = memory_map_block(sim, address, len, false);
+    if (!buf) return SEMIHOST_ERROR;
+
+    // Console handles share stdio buffering with the character devices
+    if (handle == 1 || handle == 2) {
+        FILE *out = (handle == 1) ? stdout : stderr;
+        size_t n = fwrite(buf, 1, len, out);
+        fflush(out);
+        return (uint32_t)n;
+    }
+
+    int fd = semihost_host_fd(sim, handle);
+    if (fd < 0) return SEMIHOST_ERROR;
+
+    uint32_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return done ? done : SEMIHOST_ERROR;
+        }
+        done += (uint32_t)n;
+    }
+    return done;
+}
+
+static uint32_t semihost_read(SimulatorState *sim, uint32_t handle, uint32_t address, uint32_t len) {
+    int fd = semihost_host_fd(sim, handle);
+    if (fd < 0) return SEMIHOST_ERROR;
+
+    uint8_t *buf = memory_map_block(sim, address, len, true);
+    if (!buf) return SEMIHOST_ERROR;
+
+    ssize_t n;
+    do {
+        n = read(fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+    return n < 0 ? SEMIHOST_ERROR : (uint32_t)n;
+}
+
+static uint32_t semihost_open(SimulatorState *sim, uint32_t path_addr, uint32_t mode) {
+    char path[256];
+    if (!semihost_guest_string(sim, path_addr, path, sizeof(path))) return SEMIHOST_ERROR;
+
+    int flags;
+    switch (mode) {
+        case SEMIHOST_MODE_READ:   flags = O_RDONLY; break;
+        case SEMIHOST_MODE_WRITE:  flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+        case SEMIHOST_MODE_RDWR:   flags = O_RDWR | O_CREAT; break;
+        case SEMIHOST_MODE_APPEND: flags = O_WRONLY | O_CREAT | O_APPEND; break;
+        default: return SEMIHOST_ERROR;
+    }
+
+    // Handles 0-2 are the console
+    for (uint32_t handle = 3; handle < SEMIHOST_MAX_FILES; handle++) {
+        if (sim->semihost_fds[handle] < 0) {
+            int fd = open(path, flags, 0644);
+            if (fd < 0) return SEMIHOST_ERROR;
+            sim->semihost_fds[handle] = fd;
+            return handle;
+        }
+    }
+    return SEMIHOST_ERROR;
+}
+
+static uint32_t semihost_close(SimulatorState *sim, uint32_t handle) {
+    if (handle < 3 || handle >= SEMIHOST_MAX_FILES || sim->semihost_fds[handle] < 0) {
+        return SEMIHOST_ERROR;
+    }
+    close(sim->semihost_fds[handle]);
+    sim->semihost_fds[handle] = -1;
+    return 0;
+}
+
+void semihost_init(SimulatorState *sim) {
+    sim->semihost_fds[0] = STDIN_FILENO;
+    sim->semihost_fds[1] = STDOUT_FILENO;
+    sim->semihost_fds[2] = STDERR_FILENO;
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        sim->semihost_fds[i] = -1;
+    }
+
+    if (!semihost_epoch_set) {
+        clock_gettime(CLOCK_MONOTONIC, &semihost_epoch);
+        semihost_epoch_set = true;
+    }
+}
+
+void semihost_cleanup(SimulatorState *sim) {
+    for (int i = 3; i < SEMIHOST_MAX_FILES; i++) {
+        if (sim->semihost_fds[i] >= 0) {
+            close(sim->semihost_fds[i]);
+            sim->semihost_fds[i] = -1;
+        }
+    }
+}
+
+int semihost_call(SimulatorState *sim) {
+    uint32_t function = sim->registers[0];
+    uint32_t arg1 = sim->registers[1];
+    uint32_t arg2 = sim->registers[2];
+    uint32_t arg3 = sim->registers[3];
+    uint32_t result = 0;
+
+    switch (function) {
+        case SYS_WRITE:
+            result = semihost_write(sim, arg1, arg2, arg3);
+            break;
+        case SYS_READ:
+            result = semihost_read(sim, arg1, arg2, arg3);
+            break;
+        case SYS_OPEN:
+            result = semihost_open(sim, arg1, arg2);
+            break;
+        case SYS_CLOSE:
+            result = semihost_close(sim, arg1);
+            break;
+        case SYS_CLOCK: {
+            // R0 = host milliseconds since start, R1 = cycle counter (low 32 bits)
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            uint64_t ms = (uint64_t)(now.tv_sec - semihost_epoch.tv_sec) * 1000 +
+                          (now.tv_nsec - semihost_epoch.tv_nsec) / 1000000;
+            result = (uint32_t)ms;
+            sim->registers[1] = (uint32_t)sim->clock_cycles;
+            break;
+        }
+        case SYS_EXIT:
+            sim->exit_code = (int)arg1;
+            sim->halted = true;
+            break;
+        default:
+            bebo_log(BEBO_LOG_ERROR, "Unknown semihosting call: 0x%02X at PC=0x%04X\n", function, sim->pc);
+            return 0;
+    }
+
+    sim->registers[0] = result;
+    return 1;
+}
@@ -1,5 +1,15 @@
 #include "../include/beboasm.h"
 #include "../include/opcodes.h"
+#include "../include/devices.h"
+#include "../include/tracer.h"
+#include "../include/profiler.h"
+#include "../include/opstats.h"
+#include "../include/heatmap.h"
+#include "../include/cache.h"
+#include "../include/pipeline.h"
+#include "../include/branch.h"
+#include "../include/cycles.h"
+#include "../include/metrics.h"
 #include <signal.h>
 #include <termios.h>
 #include <unistd.h>
@@ -18,27 +28,53 @@ int execute_jg(SimulatorState *sim);
 int execute_jl(SimulatorState *sim);
 int execute_call(SimulatorState *sim);
 int execute_ret(SimulatorState *sim);
+static int execute_wait(SimulatorState *sim);
+
+// Record the control transfer to 'target' in the coverage map (AFL's
+// cur_location ^ prev_location scheme, with the address hashed so nearby
+// blocks spread across the map). Conditional branches record the path
+// taken either way, so fall-through blocks are covered too.
+static inline void coverage_edge(SimulatorState *sim, uint32_t target) {
+    if (sim->coverage) {
+        uint32_t cur = ((target * 0x9E3779B1u) >> 16) & (COVERAGE_MAP_SIZE - 1);
+        sim->coverage[cur ^ sim->coverage_prev]++;
+        sim->coverage_prev = cur >> 1;
+    }
+}
 uint8_t memory_read_byte(SimulatorState *sim, uint32_t address);
 uint16_t memory_read_word(SimulatorState *sim, uint32_t address);
 void memory_write_byte(SimulatorState *sim, uint32_t address, uint8_t value);
 void memory_write_word(SimulatorState *sim, uint32_t address, uint16_t value);
+static uint32_t memory_read_data(SimulatorState *sim, uint32_t address, uint32_t size);
+static void memory_write_data(SimulatorState *sim, uint32_t address, uint32_t value, uint32_t size);
+static uint8_t memory_fetch_byte(SimulatorState *sim, uint32_t address);
+static uint16_t memory_fetch_word(SimulatorState *sim, uint32_t address);
+
+// Operand mode byte (0x00 register, 0x01 immediate)
+static inline uint8_t fetch_mode(SimulatorState *sim) {
+    uint8_t mode = memory_fetch_byte(sim, sim->pc++);
+    opstats_mode(sim, mode);
+    return mode;
+}
 
 SimulatorState* simulator_create(AssemblerState *state) {
     SimulatorState *sim = calloc(1, sizeof(SimulatorState));
     if (!sim) return NULL;
     
-    // Allocate memory
-    sim->memory = calloc(MEMORY_SIZE, 1);
+    // Adopt the assembled image rather than copying it: the assembler's
+    // memory becomes the guest memory and state->memory is cleared, so
+    // the AssemblerState can still be destroyed (or inspected) afterwards.
+    if (state && state->memory) {
+        sim->memory = state->memory;
+        state->memory = NULL;
+    } else {
+        sim->memory = calloc(MEMORY_SIZE, 1);
+    }
     if (!sim->memory) {
         free(sim);
         return NULL;
     }
     
-    // Copy assembled code if provided
-    if (state) {
-        memcpy(sim->memory, state->memory, MEMORY_SIZE);
-    }
-    
     // Initialize registers
     for (int i = 0; i < NUM_REGISTERS; i++) {
         sim->registers[i] = 0;
@@ -64,21 +100,40 @@ SimulatorState* simulator_create(AssemblerState *state) {
     sim->pipeline.writeback = 0;
     sim->pipeline.stalled = false;
     
-    // Initialize I/O ports
-    memset(sim->io_ports, 0, sizeof(sim->io_ports));
-    
     // Initialize interrupt controller
     sim->interrupt.enabled = false;
     sim->interrupt.mask = 0xFF; // All interrupts masked initially
     sim->interrupt.pending = 0;
+    sim->interrupt.vector_base = 0;
+    
+    // Initialize event queue
+    sim->events = event_queue_create();
+    sim->next_event_cycle = UINT64_MAX;
+    sim->clock_hz = DEFAULT_CLOCK_HZ;
+    sim->instruction_limit = UINT64_MAX;
+    
+    // Initialize I/O ports
+    memset(sim->io_ports, 0, sizeof(sim->io_ports));
+    sim->bus = device_bus_create();
+    if (!sim->bus || !sim->events) {
+        event_queue_destroy(sim->events);
+        free(sim->bus);
+        free(sim->memory);
+        free(sim);
+        return NULL;
+    }
+    devices_register_builtin(sim);
     
     // Initialize debug state
     sim->single_step = false;
-    sim->trace = false;
-    sim->trace_file = NULL;
+    sim->tracer = NULL;
+    sim->profiler = NULL;
+    
+    semihost_init(sim);
     
     sim->running = true;
     sim->halted = false;
+    sim->exit_code = 0;
     
     return sim;
 }
@@ -86,70 +141,175 @@ SimulatorState* simulator_create(AssemblerState *state) {
 void simulator_destroy(SimulatorState *sim) {
     if (!sim) return;
     
+    metrics_stop(sim);
+    semihost_cleanup(sim);
+    hotpatch_free(sim);
+    profiler_stop(sim);
+    opstats_stop(sim);
+    heatmap_stop(sim);
+    cache_stop(sim);
+    pipeline_stop(sim);
+    branch_stop(sim);
+    device_bus_destroy(sim, sim->bus);
+    event_queue_destroy(sim->events);
+    tracer_stop(sim);
     if (sim->memory) free(sim->memory);
-    if (sim->trace_file) fclose(sim->trace_file);
     free(sim);
 }
 
+static bool simulator_at_breakpoint(SimulatorState *sim) {
+    for (int i = 0; i < sim->breakpoint_count; i++) {
+        if (sim->pc == sim->breakpoints[i]) return true;
+    }
+    return false;
+}
+
+// Run at most max_instructions and report why execution stopped. The
+// budget is the loop condition; the stop flag is polled at backward
+// branches (every loop iteration of the guest) so straight-line code pays
+// nothing for it. A breakpoint at the starting PC is stepped over, so
+// calling this again resumes after a breakpoint stop.
+int simulator_run_for(SimulatorState *sim, uint64_t max_instructions, StopReason *stop_reason) {
+    StopReason reason = STOP_BUDGET;
+    int result = 1;
+    
+    uint64_t start = sim->instructions_executed;
+    sim->instruction_limit = (max_instructions > UINT64_MAX - start) ? UINT64_MAX : start + max_instructions;
+    
+    if (sim->halted) {
+        reason = STOP_HALT;
+    } else if (atomic_exchange(&sim->stop_requested, 0)) {
+        reason = STOP_EXTERNAL;
+    } else {
+        bool resume = true;
+        
+        while (sim->instructions_executed < sim->instruction_limit) {
+            if (sim->breakpoint_count && !resume && simulator_at_breakpoint(sim)) {
+                reason = STOP_BREAKPOINT;
+                break;
+            }
+            resume = false;
+            
+            uint32_t pc = sim->pc;
+            uint64_t cycles = sim->clock_cycles;
+            if (!simulator_execute_instruction(sim)) {
+                reason = STOP_FAULT;
+                result = 0;
+                break;
+            }
+            sim->instructions_executed++;
+            if (sim->branch) branch_retire(sim, pc);
+            if (sim->pipeline.model) pipeline_retire(sim, pc, cycles);
+            if (sim->tracer) tracer_record(sim, pc);
+            if (sim->profiler) profiler_record(sim, pc, sim->clock_cycles - cycles);
+            opstats_record(sim, pc, sim->clock_cycles - cycles);
+            if (sim->heatmap) heatmap_exec(sim, pc);
+            
+            // Backward branches may close a device polling loop, and are
+            // where an external stop request is noticed
+            if (sim->pc <= pc) {
+                simulator_idle_check(sim, pc);
+                if (sim->metrics) metrics_tick(sim);
+                if (atomic_load_explicit(&sim->stop_requested, memory_order_relaxed)) {
+                    atomic_store(&sim->stop_requested, 0);
+                    reason = STOP_EXTERNAL;
+                    break;
+                }
+            }
+            
+            // Timers, device events and interrupt delivery
+            if (sim->clock_cycles >= sim->next_event_cycle) {
+                simulator_service_events(sim);
+            }
+            
+            if (sim->halted) {
+                reason = STOP_HALT;
+                break;
+            }
+        }
+        
+        if (sim->marker_hit) {
+            sim->marker_hit = false;
+            reason = STOP_MARKER;
+        }
+    }
+    
+    sim->instruction_limit = UINT64_MAX;
+    if (sim->metrics) metrics_publish(sim);
+    if (stop_reason) *stop_reason = reason;
+    return result;
+}
+
+// Async-signal-safe: only stores to a lock-free atomic
+void simulator_request_stop(SimulatorState *sim) {
+    atomic_store(&sim->stop_requested, 1);
+}
+
+const char* simulator_stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case STOP_HALT:       return "halt";
+        case STOP_BREAKPOINT: return "breakpoint";
+        case STOP_BUDGET:     return "budget";
+        case STOP_FAULT:      return "fault";
+        case STOP_EXTERNAL:   return "external";
+        case STOP_MARKER:     return "marker";
+    }
+    return "unknown";
+}
+
 int simulator_run(SimulatorState *sim) {
     if (!sim) return 0;
     
-    printf("Starting simulation...\n");
-    printf("PC=0x%04X, SP=0x%04X\n", sim->pc, sim->sp);
+    bebo_log(BEBO_LOG_INFO, "Starting simulation...\n");
+    bebo_log(BEBO_LOG_INFO, "PC=0x%04X, SP=0x%04X\n", sim->pc, sim->sp);
     
-    clock_t start_time = clock();
+    uint64_t start_ns = host_monotonic_ns();
+    StopReason reason;
     
-    while (sim->running) {
-        // Check for breakpoints
-        for (int i = 0; i < sim->breakpoint_count; i++) {
-            if (sim->pc == sim->breakpoints[i]) {
-                printf("\nBreakpoint hit at 0x%04X\n", sim->pc);
+    // Single step mode: hand control back after one instruction
+    uint64_t budget = sim->single_step ? 1 : UINT64_MAX;
+    if (!simulator_run_for(sim, budget, &reason)) {
+        bebo_log(BEBO_LOG_ERROR, "\nExecution error at PC=0x%04X\n", sim->pc);
+        return 0;
+    }
+    
+    switch (reason) {
+        case STOP_BREAKPOINT:
+            bebo_log(BEBO_LOG_INFO, "\nBreakpoint hit at 0x%04X\n", sim->pc);
+            debugger_print_registers(sim);
+            return 1;
+        case STOP_BUDGET:
+            if (sim->single_step) {
                 debugger_print_registers(sim);
                 return 1;
             }
-        }
-        
-        // Execute one instruction
-        if (!simulator_execute_instruction(sim)) {
-            printf("\nExecution error at PC=0x%04X\n", sim->pc);
-            return 0;
-        }
-        
-        // Update statistics
-        sim->instructions_executed++;
-        
-        // Check for halt
-        if (sim->halted) {
-            printf("\nProcessor halted\n");
+            bebo_log(BEBO_LOG_INFO, "\nInstruction limit reached\n");
             break;
-        }
-        
-        // Single step mode
-        if (sim->single_step) {
-            debugger_print_registers(sim);
-            printf("Press Enter to continue, 'q' to quit...\n");
-            char c = getchar();
-            if (c == 'q' || c == 'Q') break;
-        }
-        
-        // Instruction limit (removed for OS)
-        /*
-        if (sim->instructions_executed > 1000000) {
-            printf("\nInstruction limit reached\n");
+        case STOP_EXTERNAL:
+            bebo_log(BEBO_LOG_INFO, "\nStopped at PC=0x%04X\n", sim->pc);
+            break;
+        case STOP_MARKER:
+            bebo_log(BEBO_LOG_INFO, "\nTrace marker reached at PC=0x%04X\n", sim->pc);
+            return 1;
+        default:
+            bebo_log(BEBO_LOG_INFO, "\nProcessor halted\n");
             break;
-        }
-        */
     }
     
-    clock_t end_time = clock();
-    double elapsed = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+    double elapsed = (double)(host_monotonic_ns() - start_ns) / 1e9;
     
-    printf("\n=== Simulation Statistics ===\n");
-    printf("Instructions executed: %lu\n", (unsigned long)sim->instructions_executed);
-    printf("Clock cycles: %lu\n", (unsigned long)sim->clock_cycles);
-    printf("Memory accesses: %lu\n", (unsigned long)sim->memory_accesses);
-    printf("Execution time: %.3f seconds\n", elapsed);
-    printf("IPS: %.0f\n", sim->instructions_executed / elapsed);
+    bebo_log(BEBO_LOG_INFO, "\n=== Simulation Statistics ===\n");
+    bebo_log(BEBO_LOG_INFO, "Instructions executed: %lu\n", (unsigned long)sim->instructions_executed);
+    bebo_log(BEBO_LOG_INFO, "Clock cycles: %lu\n", (unsigned long)sim->clock_cycles);
+    bebo_log(BEBO_LOG_INFO, "Memory accesses: %lu\n", (unsigned long)sim->memory_accesses);
+    bebo_log(BEBO_LOG_INFO, "Execution time: %.3f seconds\n", elapsed);
+    bebo_log(BEBO_LOG_INFO, "IPS: %.0f\n", sim->instructions_executed / elapsed);
+    if (sim->idle.skipped_cycles) {
+        bebo_log(BEBO_LOG_INFO, "Idle cycles skipped: %lu (%lu instructions)\n",
+                 (unsigned long)sim->idle.skipped_cycles,
+                 (unsigned long)sim->idle.skipped_instructions);
+    }
+    device_bus_print_stats(sim);
     
     return 1;
 }
@@ -160,44 +320,110 @@ int simulator_step(SimulatorState *sim) {
     // Check for breakpoints
     for (int i = 0; i < sim->breakpoint_count; i++) {
         if (sim->pc == sim->breakpoints[i]) {
-            printf("\nBreakpoint hit at 0x%04X\n", sim->pc);
+            bebo_log(BEBO_LOG_INFO, "\nBreakpoint hit at 0x%04X\n", sim->pc);
             return 0;
         }
     }
     
+    uint32_t pc = sim->pc;
+    uint64_t cycles = sim->clock_cycles;
     if (!simulator_execute_instruction(sim)) {
         return 0;
     }
     
     sim->instructions_executed++;
+    if (sim->branch) branch_retire(sim, pc);
+    if (sim->pipeline.model) pipeline_retire(sim, pc, cycles);
+    if (sim->tracer) tracer_record(sim, pc);
+    if (sim->profiler) profiler_record(sim, pc, sim->clock_cycles - cycles);
+    opstats_record(sim, pc, sim->clock_cycles - cycles);
+    if (sim->heatmap) heatmap_exec(sim, pc);
+    if (sim->clock_cycles >= sim->next_event_cycle) {
+        simulator_service_events(sim);
+    }
     return 1;
 }
 
+// Called after a backward control transfer. A short loop that comes back
+// through the same branch with identical registers, flags and SP, no memory
+// writes and only side-effect-free port reads is polling a device: nothing
+// it observes can change before the next scheduled event. Whole iterations
+// up to that cycle are then accounted without being executed, so counters
+// end up exactly where plain execution would have left them.
+void simulator_idle_check(SimulatorState *sim, uint32_t branch_pc) {
+    uint64_t instructions = sim->instructions_executed - sim->idle.instructions;
+    bool candidate = sim->idle.head == sim->pc && sim->idle.tail == branch_pc &&
+                     instructions <= IDLE_MAX_LOOP &&
+                     (sim->io_reads != sim->idle.io_reads || sim->pc == branch_pc) &&
+                     sim->memory_writes == sim->idle.memory_writes &&
+                     sim->io_effects == sim->idle.io_effects;
+    
+    if (!candidate) {
+        sim->idle.armed = false;
+    } else if (sim->idle.armed && sim->flags == sim->idle.flags && sim->sp == sim->idle.sp &&
+               memcmp(sim->registers, sim->idle.registers, sizeof(sim->registers)) == 0) {
+        uint64_t cycles = sim->clock_cycles - sim->idle.cycles;
+        
+        if (cycles && sim->next_event_cycle != UINT64_MAX &&
+            sim->next_event_cycle > sim->clock_cycles &&
+            sim->breakpoint_count == 0 && !sim->single_step && !sim->tracer && !sim->opstats &&
+            !sim->heatmap && !sim->cache && !sim->pipeline.model && !sim->branch &&
+            (!sim->profiler || sim->profiler->mode == PROFILE_SAMPLE)) {
+            uint64_t iterations = (sim->next_event_cycle - sim->clock_cycles) / cycles;
+            uint64_t budget = (sim->instruction_limit - sim->instructions_executed) / instructions;
+            if (iterations > budget) iterations = budget;
+            
+            sim->clock_cycles += iterations * cycles;
+            sim->instructions_executed += iterations * instructions;
+            sim->memory_accesses += iterations * (sim->memory_accesses - sim->idle.memory_accesses);
+            sim->io_reads += iterations * (sim->io_reads - sim->idle.io_reads);
+            sim->idle.skipped_cycles += iterations * cycles;
+            sim->idle.skipped_instructions += iterations * instructions;
+        }
+    } else {
+        memcpy(sim->idle.registers, sim->registers, sizeof(sim->registers));
+        sim->idle.flags = sim->flags;
+        sim->idle.sp = sim->sp;
+        sim->idle.armed = true;
+    }
+    
+    sim->idle.head = sim->pc;
+    sim->idle.tail = branch_pc;
+    sim->idle.instructions = sim->instructions_executed;
+    sim->idle.cycles = sim->clock_cycles;
+    sim->idle.memory_accesses = sim->memory_accesses;
+    sim->idle.memory_writes = sim->memory_writes;
+    sim->idle.io_reads = sim->io_reads;
+    sim->idle.io_effects = sim->io_effects;
+}
+
 int simulator_execute_instruction(SimulatorState *sim) {
     // Fetch instruction
-    uint8_t opcode = memory_read_byte(sim, sim->pc++);
+    if (sim->cache) sim->cache->pc = sim->pc;
+    uint8_t opcode = memory_fetch_byte(sim, sim->pc++);
+    opstats_fetch(sim, opcode);
     
     // Decode and execute
     switch (opcode) {
         case OP_MOV:
             return execute_mov(sim);
         case OP_MOVW: {
-            uint8_t dest_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dest_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             if (mode == 0x01) { // Immediate
-                uint32_t val = memory_read_byte(sim, sim->pc++);
-                val |= (uint32_t)memory_read_byte(sim, sim->pc++) << 8;
-                val |= (uint32_t)memory_read_byte(sim, sim->pc++) << 16;
-                val |= (uint32_t)memory_read_byte(sim, sim->pc++) << 24;
+                uint32_t val = memory_fetch_byte(sim, sim->pc++);
+                val |= (uint32_t)memory_fetch_byte(sim, sim->pc++) << 8;
+                val |= (uint32_t)memory_fetch_byte(sim, sim->pc++) << 16;
+                val |= (uint32_t)memory_fetch_byte(sim, sim->pc++) << 24;
                 sim->registers[dest_reg] = val;
             } else if (mode == 0x00) { // Register
-                uint8_t src_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
                 sim->registers[dest_reg] = sim->registers[src_reg];
             } else {
-                printf("Invalid MOVW mode: 0x%02X\n", mode);
+                bebo_log(BEBO_LOG_ERROR, "Invalid MOVW mode: 0x%02X\n", mode);
                 return 0;
             }
-            sim->clock_cycles += 4;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_ADD:
@@ -218,289 +444,294 @@ int simulator_execute_instruction(SimulatorState *sim) {
             return execute_call(sim);
         case OP_RET:
             return execute_ret(sim);
+        case OP_RETI:
+        case OP_IRET:
+            interrupt_return(sim);
+            coverage_edge(sim, sim->pc);
+            if (sim->profiler) profiler_ret(sim, sim->pc);
+            sim->clock_cycles += cycle_cost(opcode, 0);
+            return 1;
         case OP_HALT:
             sim->halted = true;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         case OP_NOP:
-            sim->clock_cycles++;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
+        case OP_WAIT:
+            sim->clock_cycles += cycle_cost(opcode, 0);
+            return execute_wait(sim);
+        case OP_TRACE:
+            // Snapshot marker for bebofuzz: end the current run right after it
+            sim->clock_cycles += cycle_cost(opcode, 0);
+            if (sim->stop_on_marker) {
+                sim->marker_hit = true;
+                sim->instruction_limit = sim->instructions_executed + 1;
+            }
+            return 1;
+        case OP_SVC:
+        case OP_TRAP: {
+            uint8_t vector = memory_fetch_byte(sim, sim->pc++);
+            sim->clock_cycles += cycle_cost(opcode, 0);
+            sim->io_effects++;
+            if (vector == SEMIHOST_VECTOR) {
+                return semihost_call(sim);
+            }
+            bebo_log(BEBO_LOG_ERROR, "Unhandled %s vector 0x%02X at PC=0x%04X\n",
+                      (opcode == OP_SVC) ? "SVC" : "TRAP", vector, sim->pc - 2);
+            return 0;
+        }
         case OP_OUT:
         case OP_OUTB: {
-            uint32_t port = memory_read_byte(sim, sim->pc++);
-            port |= (uint32_t)memory_read_byte(sim, sim->pc++) << 8;
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
-            uint32_t value = sim->registers[reg];
-            
-            if (port == 0x01) { // Standard Output
-                putchar((char)value);
-                fflush(stdout);
-            } else if (port >= 0x1F0 && port <= 0x1F7) {
-                // Mock ATA disk port
-                // Just log for now
-                // printf("[SIM] ATA Write Port 0x%X: 0x%X\n", port, value);
-            } else {
-                // printf("OUTPUT [Port 0x%04X]: %d (0x%X) '%c'\n", port, value, value, (char)value);
-            }
-            sim->clock_cycles += 2;
+            uint32_t port = memory_fetch_byte(sim, sim->pc++);
+            port |= (uint32_t)memory_fetch_byte(sim, sim->pc++) << 8;
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
+            device_write(sim, (uint16_t)port, sim->registers[reg]);
+            sim->io_effects++;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_IN:
         case OP_INB: {
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
-            uint32_t port = memory_read_byte(sim, sim->pc++);
-            port |= (uint32_t)memory_read_byte(sim, sim->pc++) << 8;
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
+            uint32_t port = memory_fetch_byte(sim, sim->pc++);
+            port |= (uint32_t)memory_fetch_byte(sim, sim->pc++) << 8;
             
-            uint32_t value = 0;
-            if (port == 0x1F7) {
-                value = 0x40; // DRV_READY
-            } else {
-                // value = 0;
-            }
-            sim->registers[reg] = value;
-            sim->clock_cycles += 2;
+            sim->registers[reg] = device_read(sim, (uint16_t)port);
+            sim->io_reads++;
+            if (device_read_has_effects(sim, (uint16_t)port)) sim->io_effects++;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_INC: {
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
             sim->registers[reg]++;
             update_flags(sim, sim->registers[reg]);
-            sim->clock_cycles += 1;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_DEC: {
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
             sim->registers[reg]--;
             update_flags(sim, sim->registers[reg]);
-            sim->clock_cycles += 1;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_LOAD: {
-            uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) { // Indirect Register
-                uint8_t src_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[src_reg];
             } else { // Direct Memory
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
             // Load 32-bit value (Little Endian)
-            uint32_t val = memory_read_byte(sim, addr);
-            val |= (uint32_t)memory_read_byte(sim, addr + 1) << 8;
-            val |= (uint32_t)memory_read_byte(sim, addr + 2) << 16;
-            val |= (uint32_t)memory_read_byte(sim, addr + 3) << 24;
+            uint32_t val = memory_read_dword(sim, addr);
             sim->registers[dst_reg] = val;
-            sim->clock_cycles += 4;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_LOADB: {
-            uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) {
-                uint8_t src_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[src_reg];
             } else {
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
             sim->registers[dst_reg] = memory_read_byte(sim, addr);
-            sim->clock_cycles += 2;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_LOADH: {
-            uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) {
-                uint8_t src_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[src_reg];
             } else {
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
-            uint32_t val = memory_read_byte(sim, addr);
-            val |= (uint32_t)memory_read_byte(sim, addr + 1) << 8;
+            uint32_t val = memory_read_data(sim, addr, 2);
             sim->registers[dst_reg] = val;
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_STORE: {
-            uint8_t src_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) { // Indirect Register
-                uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[dst_reg];
             } else { // Direct Memory
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
             uint32_t val = sim->registers[src_reg];
-            memory_write_byte(sim, addr, val & 0xFF);
-            memory_write_byte(sim, addr + 1, (val >> 8) & 0xFF);
-            memory_write_byte(sim, addr + 2, (val >> 16) & 0xFF);
-            memory_write_byte(sim, addr + 3, (val >> 24) & 0xFF);
-            sim->clock_cycles += 4;
+            memory_write_dword(sim, addr, val);
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_STOREB: {
-            uint8_t src_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) {
-                uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[dst_reg];
             } else {
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
             memory_write_byte(sim, addr, sim->registers[src_reg] & 0xFF);
-            sim->clock_cycles += 2;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_STOREH: {
-            uint8_t src_reg = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t addr;
             if (mode == 0) {
-                uint8_t dst_reg = memory_read_byte(sim, sim->pc++);
+                uint8_t dst_reg = memory_fetch_byte(sim, sim->pc++);
                 addr = sim->registers[dst_reg];
             } else {
-                 addr = memory_read_word(sim, sim->pc);
+                 addr = memory_fetch_word(sim, sim->pc);
                  sim->pc += 2;
             }
             uint32_t val = sim->registers[src_reg];
-            memory_write_byte(sim, addr, val & 0xFF);
-            memory_write_byte(sim, addr + 1, (val >> 8) & 0xFF);
-            sim->clock_cycles += 3;
+            memory_write_data(sim, addr, val, 2);
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_PUSH: {
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
             uint32_t val = sim->registers[reg];
             sim->registers[REG_SP] -= 4;
             uint32_t sp = sim->registers[REG_SP];
-            memory_write_byte(sim, sp, val & 0xFF);
-            memory_write_byte(sim, sp + 1, (val >> 8) & 0xFF);
-            memory_write_byte(sim, sp + 2, (val >> 16) & 0xFF);
-            memory_write_byte(sim, sp + 3, (val >> 24) & 0xFF);
-            sim->clock_cycles += 2;
+            memory_write_dword(sim, sp, val);
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_POP: {
-            uint8_t reg = memory_read_byte(sim, sim->pc++);
+            uint8_t reg = memory_fetch_byte(sim, sim->pc++);
             uint32_t sp = sim->registers[REG_SP];
-            uint32_t val = memory_read_byte(sim, sp);
-            val |= (uint32_t)memory_read_byte(sim, sp + 1) << 8;
-            val |= (uint32_t)memory_read_byte(sim, sp + 2) << 16;
-            val |= (uint32_t)memory_read_byte(sim, sp + 3) << 24;
+            uint32_t val = memory_read_dword(sim, sp);
             sim->registers[reg] = val;
             sim->registers[REG_SP] += 4;
-            sim->clock_cycles += 2;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_AND: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             sim->registers[dst] = sim->registers[reg1] & val2;
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_OR: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             sim->registers[dst] = sim->registers[reg1] | val2;
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_XOR: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             sim->registers[dst] = sim->registers[reg1] ^ val2;
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_NOT: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
             sim->registers[dst] = ~sim->registers[dst];
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 2;
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_SHL: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             sim->registers[dst] = sim->registers[reg1] << (val2 & 0x1F);
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_SHR: {
-            uint8_t dst = memory_read_byte(sim, sim->pc++);
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t dst = memory_fetch_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             sim->registers[dst] = sim->registers[reg1] >> (val2 & 0x1F);
             update_flags(sim, sim->registers[dst]);
-            sim->clock_cycles += 3;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_CMP: {
-            uint8_t reg1 = memory_read_byte(sim, sim->pc++);
-            uint8_t mode = memory_read_byte(sim, sim->pc++);
+            uint8_t reg1 = memory_fetch_byte(sim, sim->pc++);
+            uint8_t mode = fetch_mode(sim);
             uint32_t val1 = sim->registers[reg1];
             uint32_t val2;
-            if (mode == 0) val2 = sim->registers[memory_read_byte(sim, sim->pc++)];
-            else { val2 = memory_read_word(sim, sim->pc); sim->pc += 2; }
+            if (mode == 0) val2 = sim->registers[memory_fetch_byte(sim, sim->pc++)];
+            else { val2 = memory_fetch_word(sim, sim->pc); sim->pc += 2; }
             update_flags(sim, val1 - val2);
-            sim->clock_cycles += 2;
+            sim->clock_cycles += cycle_cost(opcode, mode);
             return 1;
         }
         case OP_JGE: {
-            uint16_t target = memory_read_word(sim, sim->pc);
+            uint16_t target = memory_fetch_word(sim, sim->pc);
             sim->pc += 2;
             if (!(sim->flags & FLAG_NEGATIVE) || (sim->flags & FLAG_ZERO)) {
                 sim->pc = target;
-                sim->clock_cycles += 1;
+                sim->clock_cycles += cycle_table.taken[opcode];
             }
-            sim->clock_cycles += 2;
+            coverage_edge(sim, sim->pc);
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         case OP_JLE: {
-            uint16_t target = memory_read_word(sim, sim->pc);
+            uint16_t target = memory_fetch_word(sim, sim->pc);
             sim->pc += 2;
             if ((sim->flags & FLAG_NEGATIVE) || (sim->flags & FLAG_ZERO)) {
                 sim->pc = target;
-                sim->clock_cycles += 1;
+                sim->clock_cycles += cycle_table.taken[opcode];
             }
-            sim->clock_cycles += 2;
+            coverage_edge(sim, sim->pc);
+            sim->clock_cycles += cycle_cost(opcode, 0);
             return 1;
         }
         default:
-            printf("Unknown opcode: 0x%02X at PC=0x%04X\n", opcode, sim->pc - 1);
+            bebo_log(BEBO_LOG_ERROR, "Unknown opcode: 0x%02X at PC=0x%04X\n", opcode, sim->pc - 1);
             return 0;
     }
     return 1;
@@ -509,42 +740,42 @@ int simulator_execute_instruction(SimulatorState *sim) {
 // MOV instruction: MOV Rdst, Rsrc or MOV Rdst, #imm
 int execute_mov(SimulatorState *sim) {
     // Read operands
-    uint8_t dest_reg = memory_read_byte(sim, sim->pc++);
-    uint8_t mode = memory_read_byte(sim, sim->pc++);
+    uint8_t dest_reg = memory_fetch_byte(sim, sim->pc++);
+    uint8_t mode = fetch_mode(sim);
     
     if (mode == 0x00) { // Register mode
-        uint8_t src_reg = memory_read_byte(sim, sim->pc++);
+        uint8_t src_reg = memory_fetch_byte(sim, sim->pc++);
         sim->registers[dest_reg] = sim->registers[src_reg];
     } else if (mode == 0x01) { // Immediate mode
-        uint16_t imm = memory_read_word(sim, sim->pc);
+        uint16_t imm = memory_fetch_word(sim, sim->pc);
         sim->pc += 2;
         sim->registers[dest_reg] = imm;
     } else {
-        printf("Invalid MOV mode: 0x%02X\n", mode);
+        bebo_log(BEBO_LOG_ERROR, "Invalid MOV mode: 0x%02X\n", mode);
         return 0;
     }
     
-    sim->clock_cycles += 2;
+    sim->clock_cycles += cycle_cost(OP_MOV, mode);
     return 1;
 }
 
 // ADD instruction: ADD Rdst, Rsrc1, Rsrc2 or ADD Rdst, Rsrc1, #imm
 int execute_add(SimulatorState *sim) {
-    uint8_t dest_reg = memory_read_byte(sim, sim->pc++);
-    uint8_t src1_reg = memory_read_byte(sim, sim->pc++);
-    uint8_t mode = memory_read_byte(sim, sim->pc++);
+    uint8_t dest_reg = memory_fetch_byte(sim, sim->pc++);
+    uint8_t src1_reg = memory_fetch_byte(sim, sim->pc++);
+    uint8_t mode = fetch_mode(sim);
     
     uint32_t src1 = sim->registers[src1_reg];
     uint32_t src2;
     
     if (mode == 0x00) { // Register mode
-        uint8_t src2_reg = memory_read_byte(sim, sim->pc++);
+        uint8_t src2_reg = memory_fetch_byte(sim, sim->pc++);
         src2 = sim->registers[src2_reg];
     } else if (mode == 0x01) { // Immediate mode
-        src2 = memory_read_word(sim, sim->pc);
+        src2 = memory_fetch_word(sim, sim->pc);
         sim->pc += 2;
     } else {
-        printf("Invalid ADD mode: 0x%02X\n", mode);
+        bebo_log(BEBO_LOG_ERROR, "Invalid ADD mode: 0x%02X\n", mode);
         return 0;
     }
     
@@ -559,51 +790,55 @@ int execute_add(SimulatorState *sim) {
     }
     
     sim->registers[dest_reg] = result & 0xFFFFFFFF;
-    sim->clock_cycles += 3;
+    sim->clock_cycles += cycle_cost(OP_ADD, mode);
     
     return 1;
 }
 
 // JMP instruction: JMP address
 int execute_jmp(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
     sim->pc = target;
-    sim->clock_cycles += 3;
+    coverage_edge(sim, target);
+    sim->clock_cycles += cycle_cost(OP_JMP, 0);
     return 1;
 }
 
 // CALL instruction: CALL address
 int execute_call(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
+    uint16_t return_addr = sim->pc + 2;
     
     // Push return address
     sim->sp -= 2;
-    memory_write_word(sim, sim->sp, sim->pc + 2);
+    memory_write_word(sim, sim->sp, return_addr);
     
     // Jump to target
     sim->pc = target;
-    sim->clock_cycles += 5;
+    coverage_edge(sim, target);
+    if (sim->profiler) profiler_call(sim, target, return_addr);
+    sim->clock_cycles += cycle_cost(OP_CALL, 0);
     
     return 1;
 }
 
 // SUB instruction: SUB Rdst, Rsrc1, Rsrc2 or SUB Rdst, Rsrc1, #imm
 int execute_sub(SimulatorState *sim) {
-    uint8_t dest_reg = memory_read_byte(sim, sim->pc++);
-    uint8_t src1_reg = memory_read_byte(sim, sim->pc++);
-    uint8_t mode = memory_read_byte(sim, sim->pc++);
+    uint8_t dest_reg = memory_fetch_byte(sim, sim->pc++);
+    uint8_t src1_reg = memory_fetch_byte(sim, sim->pc++);
+    uint8_t mode = fetch_mode(sim);
     
     uint32_t src1 = sim->registers[src1_reg];
     uint32_t src2;
     
     if (mode == 0x00) { // Register mode
-        uint8_t src2_reg = memory_read_byte(sim, sim->pc++);
+        uint8_t src2_reg = memory_fetch_byte(sim, sim->pc++);
         src2 = sim->registers[src2_reg];
     } else if (mode == 0x01) { // Immediate mode
-        src2 = memory_read_word(sim, sim->pc);
+        src2 = memory_fetch_word(sim, sim->pc);
         sim->pc += 2;
     } else {
-        printf("Invalid SUB mode: 0x%02X\n", mode);
+        bebo_log(BEBO_LOG_ERROR, "Invalid SUB mode: 0x%02X\n", mode);
         return 0;
     }
     
@@ -611,7 +846,7 @@ int execute_sub(SimulatorState *sim) {
     update_flags(sim, result);
     
     sim->registers[dest_reg] = result;
-    sim->clock_cycles += 3;
+    sim->clock_cycles += cycle_cost(OP_SUB, mode);
     
     return 1;
 }
@@ -624,7 +859,9 @@ int execute_ret(SimulatorState *sim) {
     
     // Return
     sim->pc = return_addr;
-    sim->clock_cycles += 4;
+    coverage_edge(sim, return_addr);
+    if (sim->profiler) profiler_ret(sim, return_addr);
+    sim->clock_cycles += cycle_cost(OP_RET, 0);
     
     return 1;
 }
@@ -646,95 +883,315 @@ void update_flags(SimulatorState *sim, uint32_t result) {
     }
 }
 
-// Memory access functions
-uint8_t memory_read_byte(SimulatorState *sim, uint32_t address) {
-    if (address >= MEMORY_SIZE) {
-        printf("Memory read out of bounds: 0x%08X\n", address);
-        return 0;
-    }
-    
-    // Check watchpoints
+// Memory access functions. Each call is one architectural access: the
+// heatmap and the L1D see it once whatever its width.
+static void watch_read(SimulatorState *sim, uint32_t address, uint32_t size) {
     for (int i = 0; i < sim->watchpoint_count; i++) {
-        if (sim->watchpoints[i].address == address && 
+        if (sim->watchpoints[i].address - address < size && 
             (sim->watchpoints[i].watch_type == 'r' || sim->watchpoints[i].watch_type == 'x')) {
-            printf("Watchpoint hit: read from 0x%08X\n", address);
+            bebo_log(BEBO_LOG_INFO, "Watchpoint hit: read from 0x%08X\n", sim->watchpoints[i].address);
+        }
+    }
+}
+
+static void watch_write(SimulatorState *sim, uint32_t address, uint32_t value, uint32_t size) {
+    for (int i = 0; i < sim->watchpoint_count; i++) {
+        uint32_t offset = sim->watchpoints[i].address - address;
+        if (offset < size && sim->watchpoints[i].watch_type == 'w') {
+            bebo_log(BEBO_LOG_INFO, "Watchpoint hit: write to 0x%08X = 0x%02X\n",
+                     sim->watchpoints[i].address, (value >> (8 * offset)) & 0xFF);
         }
     }
+}
+
+uint8_t memory_read_byte(SimulatorState *sim, uint32_t address) {
+    if (address >= MEMORY_SIZE) {
+        bebo_log(BEBO_LOG_ERROR, "Memory read out of bounds: 0x%08X\n", address);
+        return 0;
+    }
     
+    watch_read(sim, address, 1);
+    if (sim->heatmap) heatmap_read(sim, address);
+    if (sim->cache) cache_read(sim, address, 1);
     sim->memory_accesses++;
     return sim->memory[address];
 }
 
 uint16_t memory_read_word(SimulatorState *sim, uint32_t address) {
     if (address >= MEMORY_SIZE - 1) {
-        printf("Memory read out of bounds: 0x%08X\n", address);
+        bebo_log(BEBO_LOG_ERROR, "Memory read out of bounds: 0x%08X\n", address);
         return 0;
     }
     
     uint16_t value = sim->memory[address] | (sim->memory[address + 1] << 8);
+    if (sim->heatmap) heatmap_read(sim, address);
+    if (sim->cache) cache_read(sim, address, 2);
     sim->memory_accesses += 2;
     return value;
 }
 
-void memory_write_byte(SimulatorState *sim, uint32_t address, uint8_t value) {
-    if (address >= MEMORY_SIZE) {
-        printf("Memory write out of bounds: 0x%08X\n", address);
-        return;
+// Loads and stores of 'size' bytes (LOAD, LOADH, STORE, STOREH, PUSH, POP)
+static uint32_t memory_read_data(SimulatorState *sim, uint32_t address, uint32_t size) {
+    uint32_t value = 0;
+    if (address > MEMORY_SIZE - size) {
+        for (uint32_t i = 0; i < size; i++) {
+            value |= (uint32_t)memory_read_byte(sim, address + i) << (8 * i);
+        }
+        return value;
     }
     
-    // Check watchpoints
-    for (int i = 0; i < sim->watchpoint_count; i++) {
-        if (sim->watchpoints[i].address == address && 
-            sim->watchpoints[i].watch_type == 'w') {
-            printf("Watchpoint hit: write to 0x%08X = 0x%02X\n", address, value);
+    watch_read(sim, address, size);
+    for (uint32_t i = 0; i < size; i++) {
+        value |= (uint32_t)sim->memory[address + i] << (8 * i);
+    }
+    if (sim->heatmap) heatmap_read(sim, address);
+    if (sim->cache) cache_read(sim, address, size);
+    sim->memory_accesses += size;
+    return value;
+}
+
+static void memory_write_data(SimulatorState *sim, uint32_t address, uint32_t value, uint32_t size) {
+    if (address > MEMORY_SIZE - size) {
+        for (uint32_t i = 0; i < size; i++) {
+            memory_write_byte(sim, address + i, (value >> (8 * i)) & 0xFF);
         }
+        return;
+    }
+    
+    watch_write(sim, address, value, size);
+    for (uint32_t i = 0; i < size; i++) {
+        sim->memory[address + i] = (value >> (8 * i)) & 0xFF;
+    }
+    if (sim->tracer) tracer_note_write(sim->tracer, address, value, size);
+    if (sim->heatmap) heatmap_write(sim, address);
+    if (sim->cache) cache_write(sim, address, size);
+    memory_mark_dirty(sim, address, size);
+    sim->memory_accesses += size;
+    sim->memory_writes += size;
+}
+
+uint32_t memory_read_dword(SimulatorState *sim, uint32_t address) {
+    return memory_read_data(sim, address, 4);
+}
+
+void memory_write_dword(SimulatorState *sim, uint32_t address, uint32_t value) {
+    memory_write_data(sim, address, value, 4);
+}
+
+// Instruction stream, read only by the decode path. The heatmap counts
+// each instruction once in heatmap_exec; the L1I is probed for the opcode
+// and again only when the instruction runs into the next line.
+static uint8_t memory_fetch_byte(SimulatorState *sim, uint32_t address) {
+    if (address >= MEMORY_SIZE) {
+        bebo_log(BEBO_LOG_ERROR, "Memory read out of bounds: 0x%08X\n", address);
+        return 0;
     }
     
+    watch_read(sim, address, 1);
+    if (sim->cache) cache_fetch(sim, address);
+    sim->memory_accesses++;
+    return sim->memory[address];
+}
+
+static uint16_t memory_fetch_word(SimulatorState *sim, uint32_t address) {
+    if (address >= MEMORY_SIZE - 1) {
+        bebo_log(BEBO_LOG_ERROR, "Memory read out of bounds: 0x%08X\n", address);
+        return 0;
+    }
+    
+    if (sim->cache) {
+        cache_fetch(sim, address);
+        cache_fetch(sim, address + 1);
+    }
+    sim->memory_accesses += 2;
+    return sim->memory[address] | (sim->memory[address + 1] << 8);
+}
+
+void memory_write_byte(SimulatorState *sim, uint32_t address, uint8_t value) {
+    if (address >= MEMORY_SIZE) {
+        bebo_log(BEBO_LOG_ERROR, "Memory write out of bounds: 0x%08X\n", address);
+        return;
+    }
+    
+    watch_write(sim, address, value, 1);
     sim->memory[address] = value;
+    if (sim->tracer) tracer_note_write(sim->tracer, address, value, 1);
+    if (sim->heatmap) heatmap_write(sim, address);
+    if (sim->cache) cache_write(sim, address, 1);
+    sim->dirty_pages[address >> (PAGE_SHIFT + 6)] |= 1ULL << ((address >> PAGE_SHIFT) & 63);
+    if (address - sim->fb_watch.base < sim->fb_watch.size) {
+        framebuffer_mark_dirty(sim, address, 1);
+    }
     sim->memory_accesses++;
+    sim->memory_writes++;
 }
 
 void memory_write_word(SimulatorState *sim, uint32_t address, uint16_t value) {
     if (address >= MEMORY_SIZE - 1) {
-        printf("Memory write out of bounds: 0x%08X\n", address);
+        bebo_log(BEBO_LOG_ERROR, "Memory write out of bounds: 0x%08X\n", address);
         return;
     }
     
     sim->memory[address] = value & 0xFF;
     sim->memory[address + 1] = (value >> 8) & 0xFF;
+    if (sim->tracer) tracer_note_write(sim->tracer, address, value, 2);
+    if (sim->heatmap) heatmap_write(sim, address);
+    if (sim->cache) cache_write(sim, address, 2);
+    memory_mark_dirty(sim, address, 2);
     sim->memory_accesses += 2;
+    sim->memory_writes++;
 }
+
+// Bulk transfers used by devices (no per-byte access accounting)
+static void watch_block(SimulatorState *sim, uint32_t address, uint32_t len, bool write) {
+    for (int i = 0; i < sim->watchpoint_count; i++) {
+        if (sim->watchpoints[i].address - address >= len) continue;
+        
+        char type = sim->watchpoints[i].watch_type;
+        if (write && type == 'w') {
+            bebo_log(BEBO_LOG_INFO, "Watchpoint hit: block write to 0x%08X\n", sim->watchpoints[i].address);
+        } else if (!write && (type == 'r' || type == 'x')) {
+            bebo_log(BEBO_LOG_INFO, "Watchpoint hit: block read from 0x%08X\n", sim->watchpoints[i].address);
+        }
+    }
+}
+
+static bool block_in_bounds(uint32_t address, uint32_t len) {
+    return address < MEMORY_SIZE && len <= MEMORY_SIZE - address;
+}
+
+int memory_read_block(SimulatorState *sim, uint32_t address, uint8_t *dst, uint32_t len) {
+    if (!block_in_bounds(address, len)) {
+        bebo_log(BEBO_LOG_ERROR, "Memory block read out of bounds: 0x%08X+%u\n", address, len);
+        return 0;
+    }
+    
+    watch_block(sim, address, len, false);
+    memcpy(dst, sim->memory + address, len);
+    return 1;
+}
+
+int memory_write_block(SimulatorState *sim, uint32_t address, const uint8_t *src, uint32_t len) {
+    if (!block_in_bounds(address, len)) {
+        bebo_log(BEBO_LOG_ERROR, "Memory block write out of bounds: 0x%08X+%u\n", address, len);
+        return 0;
+    }
+    
+    watch_block(sim, address, len, true);
+    memcpy(sim->memory + address, src, len);
+    memory_mark_dirty(sim, address, len);
+    return 1;
+}
+
+int memory_copy_block(SimulatorState *sim, uint32_t dst, uint32_t src, uint32_t len) {
+    if (!block_in_bounds(src, len) || !block_in_bounds(dst, len)) {
+        bebo_log(BEBO_LOG_ERROR, "Memory block copy out of bounds: 0x%08X -> 0x%08X+%u\n", src, dst, len);
+        return 0;
+    }
+    
+    watch_block(sim, src, len, false);
+    watch_block(sim, dst, len, true);
+    memmove(sim->memory + dst, sim->memory + src, len);
+    memory_mark_dirty(sim, dst, len);
+    return 1;
+}
+
+int memory_fill_block(SimulatorState *sim, uint32_t address, uint8_t value, uint32_t len) {
+    if (!block_in_bounds(address, len)) {
+        bebo_log(BEBO_LOG_ERROR, "Memory block fill out of bounds: 0x%08X+%u\n", address, len);
+        return 0;
+    }
+    
+    watch_block(sim, address, len, true);
+    memset(sim->memory + address, value, len);
+    memory_mark_dirty(sim, address, len);
+    return 1;
+}
+
+// Direct pointer into guest memory for zero-copy device I/O. A write
+// mapping is marked dirty up front.
+uint8_t* memory_map_block(SimulatorState *sim, uint32_t address, uint32_t len, bool write) {
+    if (!block_in_bounds(address, len)) {
+        bebo_log(BEBO_LOG_ERROR, "Memory block map out of bounds: 0x%08X+%u\n", address, len);
+        return NULL;
+    }
+    
+    watch_block(sim, address, len, write);
+    if (write) memory_mark_dirty(sim, address, len);
+    return sim->memory + address;
+}
+
+void memory_mark_dirty(SimulatorState *sim, uint32_t address, uint32_t len) {
+    if (len == 0) return;
+    
+    uint32_t first = address >> PAGE_SHIFT;
+    uint32_t last = (address + len - 1) >> PAGE_SHIFT;
+    for (uint32_t page = first; page <= last && page < NUM_PAGES; page++) {
+        sim->dirty_pages[page >> 6] |= 1ULL << (page & 63);
+    }
+    
+    if (sim->fb_watch.size && address < sim->fb_watch.base + sim->fb_watch.size &&
+        address + len > sim->fb_watch.base) {
+        framebuffer_mark_dirty(sim, address, len);
+    }
+}
+
+void memory_clear_dirty(SimulatorState *sim) {
+    memset(sim->dirty_pages, 0, sizeof(sim->dirty_pages));
+}
+
+// WAIT: sleep until the next event. Simulated time jumps straight to the
+// next scheduled event instead of spinning through the idle cycles.
+static int execute_wait(SimulatorState *sim) {
+    // Observer events (profiler samples, pacing, exports) fire on the way
+    // but neither wake the guest nor keep it alive
+    uint64_t next = event_next_guest_cycle(sim);
+    if (next == UINT64_MAX) {
+        bebo_log(BEBO_LOG_INFO, "WAIT with no pending events at PC=0x%04X\n", sim->pc - 1);
+        sim->halted = true;
+        return 1;
+    }
+    
+    if (next > sim->clock_cycles) {
+        sim->idle.skipped_cycles += next - sim->clock_cycles;
+        sim->clock_cycles = next;
+    }
+    return 1;
+}
+
 // JE instruction: JE address
 int execute_je(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
     sim->pc += 2; // Jump over address if not taken
     
     if (sim->flags & FLAG_ZERO) {
         sim->pc = target;
-        sim->clock_cycles += 1; // Penalty for taken branch
+        sim->clock_cycles += cycle_table.taken[OP_JE]; // Penalty for taken branch
     }
+    coverage_edge(sim, sim->pc);
     
-    sim->clock_cycles += 2;
+    sim->clock_cycles += cycle_cost(OP_JE, 0);
     return 1;
 }
 
 // JNE instruction: JNE address
 int execute_jne(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
     sim->pc += 2;
     
     if (!(sim->flags & FLAG_ZERO)) {
         sim->pc = target;
-        sim->clock_cycles += 1;
+        sim->clock_cycles += cycle_table.taken[OP_JNE];
     }
+    coverage_edge(sim, sim->pc);
     
-    sim->clock_cycles += 2;
+    sim->clock_cycles += cycle_cost(OP_JNE, 0);
     return 1;
 }
 
 // JG instruction: JG address
 int execute_jg(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
     sim->pc += 2;
     
     // Greater (Signed): Z=0 and N=V
@@ -744,16 +1201,17 @@ int execute_jg(SimulatorState *sim) {
     
     if (!zero && (neg == ovf)) {
         sim->pc = target;
-        sim->clock_cycles += 1;
+        sim->clock_cycles += cycle_table.taken[OP_JG];
     }
+    coverage_edge(sim, sim->pc);
     
-    sim->clock_cycles += 2;
+    sim->clock_cycles += cycle_cost(OP_JG, 0);
     return 1;
 }
 
 // JL instruction: JL address
 int execute_jl(SimulatorState *sim) {
-    uint16_t target = memory_read_word(sim, sim->pc);
+    uint16_t target = memory_fetch_word(sim, sim->pc);
     sim->pc += 2;
     
     // Less (Signed): N!=V
@@ -762,9 +1220,10 @@ int execute_jl(SimulatorState *sim) {
     
     if (neg != ovf) {
         sim->pc = target;
-        sim->clock_cycles += 1;
+        sim->clock_cycles += cycle_table.taken[OP_JL];
     }
+    coverage_edge(sim, sim->pc);
     
-    sim->clock_cycles += 2;
+    sim->clock_cycles += cycle_cost(OP_JL, 0);
     return 1;
 }
@@ -1,63 +1,424 @@
 #include "../include/beboasm.h"
 #include "../include/opcodes.h"
+#include "../include/devices.h"
+#include "../include/tracer.h"
+#include "../include/profiler.h"
+#include "../include/opstats.h"
+#include "../include/heatmap.h"
+#include "../include/cache.h"
+#include "../include/pipeline.h"
+#include "../include/branch.h"
+#include "../include/cycles.h"
+#include "../include/metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+
+static SimulatorState *active_sim = NULL;
+
+// SIGINT and SIGALRM ask the running guest to stop at its next backward
+// branch; statistics are still printed on the way out.
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    if (active_sim) simulator_request_stop(active_sim);
+}
 
 int main(int argc, char *argv[]) {
     printf("BeboAsm Simulator - Version 1.0\nCreated by Abanoub\n\n");
     
-    if (argc < 2) {
-        printf("Usage: bebosim <binary file>\n");
+    const char *filename = NULL;
+    const char *disk_image = NULL;
+    const char *virtq_in = NULL;
+    const char *virtq_out = NULL;
+    const char *input = NULL;
+    const char *fb_prefix = NULL;
+    uint64_t fb_interval = 0;
+    double mhz = 0;
+    bool throttle = false;
+    bool report = false;
+    unsigned int timeout = 0;
+    const char *trace_path = NULL;
+    uint32_t trace_flags = 0;
+    bool profile = false;
+    bool profile_calls = false;
+    uint64_t profile_period = 0;
+    const char *profile_out = NULL;
+    const char *map_file = NULL;
+    bool opcode_stats = false;
+    const char *opcode_json = NULL;
+    bool heatmap = false;
+    uint64_t heatmap_window = 0;
+    const char *heatmap_out = NULL;
+    bool cache = false;
+    CacheConfig cache_config;
+    cache_default_config(&cache_config);
+    bool pipeline = false;
+    PipelineConfig pipeline_config;
+    pipeline_default_config(&pipeline_config);
+    const char *metrics_out = NULL;
+    uint32_t metrics_interval = 1000;
+    bool branch = false;
+    BranchConfig branch_config;
+    branch_default_config(&branch_config);
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--disk") == 0 && i + 1 < argc) {
+            disk_image = argv[++i];
+        } else if (strcmp(argv[i], "--virtq-in") == 0 && i + 1 < argc) {
+            virtq_in = argv[++i];
+        } else if (strcmp(argv[i], "--virtq-out") == 0 && i + 1 < argc) {
+            virtq_out = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (strcmp(argv[i], "--mhz") == 0 && i + 1 < argc) {
+            mhz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--throttle") == 0 && i + 1 < argc) {
+            mhz = atof(argv[++i]);
+            throttle = true;
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--report") == 0) {
+            report = true;
+        } else if (strcmp(argv[i], "--fb-export") == 0 && i + 1 < argc) {
+            fb_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--fb-interval") == 0 && i + 1 < argc) {
+            fb_interval = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace-regs") == 0) {
+            trace_flags |= TRACE_F_REGS;
+        } else if (strcmp(argv[i], "--trace-mem") == 0) {
+            trace_flags |= TRACE_F_MEM;
+        } else if (strcmp(argv[i], "--trace-compress") == 0) {
+            trace_flags |= TRACE_F_COMPRESS;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--profile-calls") == 0) {
+            profile = true;
+            profile_calls = true;
+        } else if (strcmp(argv[i], "--profile-sample") == 0 && i + 1 < argc) {
+            profile = true;
+            profile_period = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc) {
+            profile = true;
+            profile_out = argv[++i];
+        } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            map_file = argv[++i];
+        } else if (strcmp(argv[i], "--heatmap") == 0) {
+            heatmap = true;
+        } else if (strcmp(argv[i], "--heatmap-window") == 0 && i + 1 < argc) {
+            heatmap = true;
+            heatmap_window = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--heatmap-out") == 0 && i + 1 < argc) {
+            heatmap = true;
+            heatmap_out = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            cache = true;
+        } else if (strcmp(argv[i], "--cache-config") == 0 && i + 1 < argc) {
+            cache = true;
+            if (!cache_parse_option(&cache_config, argv[++i])) {
+                fprintf(stderr, "Error: Invalid cache option '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = true;
+        } else if (strcmp(argv[i], "--pipeline-config") == 0 && i + 1 < argc) {
+            pipeline = true;
+            if (!pipeline_parse_option(&pipeline_config, argv[++i])) {
+                fprintf(stderr, "Error: Invalid pipeline option '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--branch") == 0 && i + 1 < argc) {
+            branch = true;
+            if (!branch_parse_kind(&branch_config, argv[++i])) {
+                fprintf(stderr, "Error: Unknown branch predictor '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--branch-config") == 0 && i + 1 < argc) {
+            branch = true;
+            if (!branch_parse_option(&branch_config, argv[++i])) {
+                fprintf(stderr, "Error: Invalid branch predictor option '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_out = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+            metrics_interval = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            if (!cycles_load(argv[++i])) return 1;
+        } else if (strcmp(argv[i], "--cycles-dump") == 0 && i + 1 < argc) {
+            // Template for --cycles, with any table loaded so far applied
+            FILE *f = fopen(argv[++i], "w");
+            if (!f) {
+                fprintf(stderr, "Error: Cannot write %s\n", argv[i]);
+                return 1;
+            }
+            cycles_write(f);
+            fclose(f);
+            printf("Cycle table written to %s\n", argv[i]);
+            return 0;
+        } else if (strcmp(argv[i], "--opcode-stats") == 0) {
+            opcode_stats = true;
+        } else if (strcmp(argv[i], "--opcode-stats-json") == 0 && i + 1 < argc) {
+            opcode_stats = true;
+            opcode_json = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        } else {
+            filename = argv[i];
+        }
+    }
+    
+    if (!filename) {
+        printf("Usage: bebosim [--disk image] [--virtq-in file] [--virtq-out file] [--input file]\n"
+               "               [--fb-export prefix] [--fb-interval cycles]\n"
+               "               [--mhz freq | --throttle mhz] [--report] [--timeout seconds]\n"
+               "               [--trace file [--trace-regs] [--trace-mem] [--trace-compress]]\n"
+               "               [--profile | --profile-sample cycles] [--profile-calls]\n"
+               "               [--profile-out file] [--map file]\n"
+               "               [--opcode-stats] [--opcode-stats-json file]\n"
+               "               [--heatmap] [--heatmap-window instructions]\n"
+               "               [--heatmap-out file.csv | file.ppm]\n"
+               "               [--cache] [--cache-config l1i|l1d|l2=size,ways,line[,policy[,latency]]]\n"
+               "               [--cache-config memory=latency]\n"
+               "               [--pipeline] [--pipeline-config branch|jump|return=cycles]\n"
+               "               [--pipeline-config forwarding=on|off]\n"
+               "               [--metrics file | unix:socket] [--metrics-interval ms]\n"
+               "               [--cycles file] [--cycles-dump file]\n"
+               "               [--branch static|bimodal|gshare]\n"
+               "               [--branch-config table|history|btb|ras|penalty=n]\n"
+               "               <binary file | source.basm>\n");
         return 1;
     }
     
-    const char *filename = argv[1];
+    // A source file is assembled in-process; its symbols feed the profiler
+    AssemblerState *program = NULL;
+    size_t name_len = strlen(filename);
+    if (name_len > 5 && strcasecmp(filename + name_len - 5, ".basm") == 0) {
+        program = assembler_create(true, false);
+        if (!program) {
+            fprintf(stderr, "Error: Failed to create assembler state\n");
+            return 1;
+        }
+        program->quiet = true;
+        if (!assemble_file(program, filename)) {
+            assembler_destroy(program);
+            return 1;
+        }
+    }
     
-    // Create simulator state
-    SimulatorState *sim = simulator_create(NULL);
+    // Create simulator state (adopts the assembled image, if any)
+    SimulatorState *sim = simulator_create(program);
     if (!sim) {
         fprintf(stderr, "Error: Failed to create simulator\n");
+        assembler_destroy(program);
         return 1;
     }
     
-    // Load binary file
-    FILE *file = fopen(filename, "rb");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+    // Code range for per-address profile counters
+    uint32_t code_base = 0;
+    uint32_t code_end = 0;
+    
+    if (program) {
+        for (int i = 0; i < program->section_count; i++) {
+            Section *sec = &program->sections[i];
+            if (!(sec->attributes & 0x01) || sec->size == 0) continue;
+            if (code_end == 0 || sec->address < code_base) code_base = sec->address;
+            if (sec->address + sec->size > code_end) code_end = sec->address + sec->size;
+        }
+        printf("Assembled %u bytes from %s\n", code_end - code_base, filename);
+    } else {
+        // Load binary file
+        FILE *file = fopen(filename, "rb");
+        if (!file) {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+            simulator_destroy(sim);
+            return 1;
+        }
+        
+        // Get file size
+        fseek(file, 0, SEEK_END);
+        long file_size = ftell(file);
+        rewind(file);
+        
+        if (file_size > MEMORY_SIZE) {
+            fprintf(stderr, "Error: File too large for memory (%ld bytes > %d bytes)\n", file_size, MEMORY_SIZE);
+            fclose(file);
+            simulator_destroy(sim);
+            return 1;
+        }
+        
+        // Read file into memory
+        size_t read_size = fread(sim->memory, 1, file_size, file);
+        fclose(file);
+        
+        if (read_size != (size_t)file_size) {
+            fprintf(stderr, "Error: Failed to read file\n");
+            simulator_destroy(sim);
+            return 1;
+        }
+        
+        printf("Loaded %ld bytes from %s\n", read_size, filename);
+        code_end = (uint32_t)read_size;
+    }
+    
+    // Profiling: exact per-instruction counts, or a PC sample every N cycles
+    if (profile) {
+        ProfileMode mode = profile_period ? PROFILE_SAMPLE : PROFILE_EXACT;
+        if (!profiler_start(sim, mode, profile_period, code_base, code_end - code_base) ||
+            (program && !profiler_add_symbols(sim, program)) ||
+            (map_file && !profiler_load_map(sim, map_file))) {
+            fprintf(stderr, "Error: Failed to start profiler\n");
+            assembler_destroy(program);
+            simulator_destroy(sim);
+            return 1;
+        }
+        sim->profiler->call_graph = profile_calls;
+    }
+    
+    // Memory heatmap, mapped back to sections and symbols
+    if (heatmap) {
+        if (!heatmap_start(sim, heatmap_window) ||
+            (program && !heatmap_add_symbols(sim, program)) ||
+            (map_file && !heatmap_load_map(sim, map_file))) {
+            fprintf(stderr, "Error: Failed to start heatmap\n");
+            assembler_destroy(program);
+            simulator_destroy(sim);
+            return 1;
+        }
+    }
+    assembler_destroy(program);
+    
+    // Attach disk image
+    if (disk_image && !ata_attach_image(sim, disk_image)) {
         simulator_destroy(sim);
         return 1;
     }
     
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
+    // Attach virtqueue backend ("-" selects stdin/stdout)
+    if (virtq_in || virtq_out) {
+        VirtqBackend *backend = virtq_backend_file(virtq_in, virtq_out);
+        if (!backend || !virtq_attach(sim, backend)) {
+            simulator_destroy(sim);
+            return 1;
+        }
+    }
     
-    if (file_size > MEMORY_SIZE) {
-        fprintf(stderr, "Error: File too large for memory (%ld bytes > %d bytes)\n", file_size, MEMORY_SIZE);
-        fclose(file);
+    // Attach keyboard input ("-" selects stdin)
+    if (input && !keyboard_attach(sim, input)) {
         simulator_destroy(sim);
         return 1;
     }
     
-    // Read file into memory
-    size_t read_size = fread(sim->memory, 1, file_size, file);
-    fclose(file);
+    // Framebuffer frames go to <prefix>NNNNN.ppm
+    if (fb_prefix) {
+        framebuffer_set_export(sim, fb_prefix, fb_interval);
+    }
+    
+    // Simulated clock: --mhz sets the frequency, --throttle also paces to it
+    if (mhz > 0) {
+        sim->clock_hz = (uint64_t)(mhz * 1e6);
+    }
+    if ((throttle || report) && !rtc_set_pacing(sim, throttle, report)) {
+        fprintf(stderr, "Error: Invalid clock frequency\n");
+        simulator_destroy(sim);
+        return 1;
+    }
     
-    if (read_size != (size_t)file_size) {
-        fprintf(stderr, "Error: Failed to read file\n");
+    // Binary execution trace, decoded with bebotrace
+    if (trace_path && !tracer_start(sim, trace_path, trace_flags)) {
         simulator_destroy(sim);
         return 1;
     }
     
-    printf("Loaded %ld bytes from %s\n", read_size, filename);
+    // Cache hierarchy: misses add their latency to clock_cycles
+    if (cache && !cache_start(sim, &cache_config)) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    
+    // Branch prediction: mispredictions add their penalty to clock_cycles
+    if (branch && !branch_start(sim, &branch_config)) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    
+    // Pipeline timing: hazards and flushes replace the fixed cycle costs
+    if (pipeline && !pipeline_start(sim, &pipeline_config)) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    
+    // Instruction mix (builds with OPCODE_STATS=1)
+    if (opcode_stats && !opstats_start(sim)) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    
+    // Live counters for a collector; started last so the cache model is seen
+    if (metrics_out && !metrics_start(sim, metrics_out, metrics_interval)) {
+        simulator_destroy(sim);
+        return 1;
+    }
+    
+    // Ctrl-C and --timeout stop the guest cleanly
+    active_sim = sim;
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGALRM, handle_stop_signal);
+    if (timeout) {
+        alarm(timeout);
+    }
     
     // Run simulation
     sim->running = true;
     simulator_run(sim);
     
-    // Clean up
+    alarm(0);
+    active_sim = NULL;
+    metrics_stop(sim);
+    
+    if (profile) {
+        profiler_report(sim, 20);
+        if (profile_out && profiler_write_collapsed(sim, profile_out)) {
+            printf("Collapsed stacks written to %s\n", profile_out);
+        }
+    }
+    
+    if (cache) {
+        cache_report(sim, 10);
+    }
+    
+    if (branch) {
+        branch_report(sim, 10);
+    }
+    
+    if (pipeline) {
+        pipeline_report(sim);
+    }
+    
+    if (heatmap) {
+        heatmap_report(sim, 10);
+        if (heatmap_out && heatmap_export(sim, heatmap_out)) {
+            printf("Heatmap written to %s\n", heatmap_out);
+        }
+    }
+    
+    if (opcode_stats) {
+        if (opcode_json) {
+            if (opstats_write_json(sim, opcode_json)) {
+                printf("Instruction mix written to %s\n", opcode_json);
+            }
+        } else {
+            opstats_report(sim);
+        }
+    }
+    
+    // Clean up (SYS_EXIT sets the exit code)
+    int exit_code = sim->exit_code;
     simulator_destroy(sim);
     
-    return 0;
+    return exit_code;
 }
@@ -0,0 +1,121 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/symtab.h"
+
+static int symtab_compare(const void *a, const void *b) {
+    const SymtabEntry *x = (const SymtabEntry *)a;
+    const SymtabEntry *y = (const SymtabEntry *)b;
+    return (x->address > y->address) - (x->address < y->address);
+}
+
+static int symtab_add(SymbolTable *table, const char *name, uint32_t address, uint32_t size) {
+    SymtabEntry *grown = realloc(table->entries, (table->count + 1) * sizeof(SymtabEntry));
+    if (!grown) return 0;
+    table->entries = grown;
+    snprintf(grown[table->count].name, MAX_LABEL_LEN, "%s", name);
+    grown[table->count].address = address;
+    grown[table->count++].size = size;
+    return 1;
+}
+
+static void symtab_sort(SymbolTable *symbols, SymbolTable *sections) {
+    qsort(symbols->entries, symbols->count, sizeof(SymtabEntry), symtab_compare);
+    if (sections) qsort(sections->entries, sections->count, sizeof(SymtabEntry), symtab_compare);
+}
+
+int symtab_add_assembler(SymbolTable *symbols, SymbolTable *sections,
+                         AssemblerState *state, uint8_t types) {
+    if (!symbols || !state) return 0;
+
+    for (int i = 0; sections && i < state->section_count; i++) {
+        Section *sec = &state->sections[i];
+        if (sec->size == 0) continue;
+        if (!symtab_add(sections, sec->name, sec->address, sec->size)) return 0;
+    }
+    for (int i = 0; i < state->symbol_count; i++) {
+        Symbol *sym = &state->symbols[i];
+        if (!sym->defined || !(sym->type & types)) continue;
+        if (!symtab_add(symbols, sym->name, sym->value, 0)) return 0;
+    }
+    symtab_sort(symbols, sections);
+    return 1;
+}
+
+// Symbol type names as write_map prints them
+static uint8_t symtab_map_type(const char *type) {
+    if (strcmp(type, "code") == 0) return SYM_CODE;
+    if (strcmp(type, "data") == 0) return SYM_DATA;
+    if (strcmp(type, "bss") == 0)  return SYM_BSS;
+    if (strcmp(type, "equ") == 0)  return SYM_EQU;
+    if (strcmp(type, "abs") == 0)  return SYM_ABSOLUTE;
+    return 0;
+}
+
+int symtab_load_map(SymbolTable *symbols, SymbolTable *sections, const char *path, uint8_t types) {
+    if (!symbols || !path) return 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot open map file '%s'\n", path);
+        return 0;
+    }
+
+    char line[512];
+    char name[MAX_LABEL_LEN];
+    char type[16];
+    unsigned int address, size;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "section %63s %x %x", name, &address, &size) == 3) {
+            if (sections && size) ok = symtab_add(sections, name, address, size);
+        } else if (sscanf(line, "symbol %x %15s %63s", &address, type, name) == 3 &&
+                   (symtab_map_type(type) & types)) {
+            ok = symtab_add(symbols, name, address, 0);
+        }
+    }
+    fclose(f);
+
+    symtab_sort(symbols, sections);
+    return ok;
+}
+
+void symtab_free(SymbolTable *table) {
+    if (!table) return;
+    free(table->entries);
+    table->entries = NULL;
+    table->count = 0;
+}
+
+int symtab_find(const SymbolTable *table, uint32_t address) {
+    int lo = 0, hi = table->count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (table->entries[mid].address <= address) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+const SymtabEntry* symtab_lookup(const SymbolTable *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->entries[i].name, name) == 0) return &table->entries[i];
+    }
+    return NULL;
+}
+
+const char* symtab_format(const SymbolTable *table, uint32_t address, char *buf, size_t size) {
+    int found = symtab_find(table, address);
+    if (found < 0) {
+        snprintf(buf, size, "0x%04X", address);
+    } else if (table->entries[found].address == address) {
+        snprintf(buf, size, "%s", table->entries[found].name);
+    } else {
+        snprintf(buf, size, "%s+0x%X", table->entries[found].name,
+                 address - table->entries[found].address);
+    }
+    return buf;
+}
@@ -0,0 +1,122 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+
+// Programmable interval timer, driven by the event queue
+#define TIMER_REG_PERIOD    0   // Period in clock cycles
+#define TIMER_REG_CONTROL   1   // Control bits below
+#define TIMER_REG_COUNT     2   // Read: cycles until the next expiry
+#define TIMER_REG_FIRED     3   // Read: number of expiries since reset
+
+#define TIMER_CTRL_ENABLE   0x01
+#define TIMER_CTRL_PERIODIC 0x02
+#define TIMER_CTRL_IRQ      0x04
+
+typedef struct {
+    uint32_t period;
+    uint32_t control;
+    uint64_t deadline;
+    uint32_t event_id;
+    uint64_t fired;
+} Timer;
+
+static void timer_expire(SimulatorState *sim, void *opaque);
+
+static void timer_arm(SimulatorState *sim, Timer *timer, uint64_t from) {
+    if (timer->event_id) {
+        event_cancel(sim, timer->event_id);
+        timer->event_id = 0;
+    }
+    if (!(timer->control & TIMER_CTRL_ENABLE) || timer->period == 0) return;
+
+    timer->deadline = from + timer->period;
+    timer->event_id = event_schedule(sim, timer->deadline, timer_expire, timer);
+}
+
+static void timer_expire(SimulatorState *sim, void *opaque) {
+    Timer *timer = (Timer *)opaque;
+    timer->event_id = 0;
+    timer->fired++;
+
+    if (timer->control & TIMER_CTRL_IRQ) {
+        interrupt_raise(sim, IRQ_TIMER);
+    }
+
+    if (timer->control & TIMER_CTRL_PERIODIC) {
+        // Re-arm from the deadline, not the current cycle, to avoid drift
+        timer_arm(sim, timer, timer->deadline);
+    } else {
+        timer->control &= ~TIMER_CTRL_ENABLE;
+    }
+}
+
+static uint32_t timer_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    Timer *timer = (Timer *)opaque;
+
+    switch (port - PORT_TIMER_BASE) {
+        case TIMER_REG_PERIOD:  return timer->period;
+        case TIMER_REG_CONTROL: return timer->control;
+        case TIMER_REG_COUNT:
+            if (!timer->event_id || timer->deadline <= sim->clock_cycles) return 0;
+            return (uint32_t)(timer->deadline - sim->clock_cycles);
+        case TIMER_REG_FIRED:   return (uint32_t)timer->fired;
+    }
+    return 0;
+}
+
+static void timer_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    Timer *timer = (Timer *)opaque;
+
+    switch (port - PORT_TIMER_BASE) {
+        case TIMER_REG_PERIOD:
+            timer->period = value;
+            if (timer->control & TIMER_CTRL_ENABLE) timer_arm(sim, timer, sim->clock_cycles);
+            break;
+        case TIMER_REG_CONTROL:
+            timer->control = value;
+            timer_arm(sim, timer, sim->clock_cycles);
+            break;
+    }
+}
+
+static void timer_reset(SimulatorState *sim, void *opaque) {
+    Timer *timer = (Timer *)opaque;
+    if (timer->event_id) event_cancel(sim, timer->event_id);
+    memset(timer, 0, sizeof(*timer));
+}
+
+static void timer_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    Timer *timer = (Timer *)opaque;
+    if (timer->fired) {
+        bebo_log(BEBO_LOG_INFO, "Timer expiries: %lu\n", (unsigned long)timer->fired);
+    }
+}
+
+static uint64_t timer_counter(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    return ((Timer *)opaque)->fired;
+}
+
+static void timer_destroy(void *opaque) {
+    free(opaque);
+}
+
+int timer_attach(SimulatorState *sim) {
+    Timer *timer = calloc(1, sizeof(Timer));
+    if (!timer) return 0;
+
+    Device *dev = device_register(sim, "timer", PORT_TIMER_BASE, PORT_TIMER_COUNT,
+                                  timer_read, timer_write, timer);
+    if (!dev) {
+        free(timer);
+        return 0;
+    }
+    dev->reset = timer_reset;
+    dev->idle_reads = ~0ULL;
+    dev->state_size = sizeof(Timer);
+    dev->print_stats = timer_print_stats;
+    dev->counter = timer_counter;
+    dev->counter_name = "timer_expiries";
+    dev->destroy = timer_destroy;
+    return 1;
+}
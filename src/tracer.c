@@ -0,0 +1,500 @@
+#include "../include/beboasm.h"
+#include "../include/tracer.h"
+
+// Execution tracing: records are appended by the simulator thread into
+// fixed-size blocks (see tracer.h for the format) and written out by a
+// background thread, optionally compressed with the LZ4 block format.
+
+#define LZ_MIN_MATCH        4
+#define LZ_HASH_BITS        12
+#define LZ_LAST_LITERALS    5       // LZ4: the last 5 bytes are always literals
+#define LZ_MF_LIMIT         12      // LZ4: no match may start in the last 12 bytes
+#define LZ_MAX_OFFSET       65535
+#define LZ_BOUND(len)       ((len) + (len) / 255 + 16)
+
+static uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* lz_put_length(uint8_t *op, uint32_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t* lz_put_sequence(uint8_t *op, const uint8_t *literals, uint32_t lit_len,
+                                uint32_t offset, uint32_t match_len) {
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) op = lz_put_length(op, lit_len - 15);
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+
+    if (offset) {
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        uint32_t ml = match_len - LZ_MIN_MATCH;
+        *token |= ml >= 15 ? 15 : ml;
+        if (ml >= 15) op = lz_put_length(op, ml - 15);
+    }
+    return op;
+}
+
+// Greedy single-probe LZ4 block compressor. dst needs LZ_BOUND(len) bytes.
+static uint32_t lz_compress(const uint8_t *src, uint32_t len, uint8_t *dst) {
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + len;
+    uint8_t *op = dst;
+
+    if (len > LZ_MF_LIMIT) {
+        const uint8_t *match_limit = end - LZ_MF_LIMIT;
+        const uint8_t *extend_limit = end - LZ_LAST_LITERALS;
+
+        while (ip < match_limit) {
+            uint32_t seq, ref_seq;
+            memcpy(&seq, ip, 4);
+            uint32_t h = lz_hash(seq);
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            memcpy(&ref_seq, ref, 4);
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || ref_seq != seq) {
+                ip++;
+                continue;
+            }
+
+            uint32_t match_len = LZ_MIN_MATCH;
+            while (ip + match_len < extend_limit && ref[match_len] == ip[match_len]) {
+                match_len++;
+            }
+
+            op = lz_put_sequence(op, anchor, (uint32_t)(ip - anchor), (uint32_t)(ip - ref), match_len);
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    op = lz_put_sequence(op, anchor, (uint32_t)(end - anchor), 0, 0);
+    return (uint32_t)(op - dst);
+}
+
+static int lz_get_length(const uint8_t **ip, const uint8_t *end, uint32_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+// Returns the decompressed size, or -1 if src is not a valid block
+static int64_t lz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + len;
+    uint8_t *op = dst;
+    uint8_t *op_end = dst + cap;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15 && !lz_get_length(&ip, end, &lit_len)) return -1;
+        if (lit_len > (uint32_t)(end - ip) || lit_len > (uint32_t)(op_end - op)) return -1;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == end) break;       // Last sequence has no match
+
+        if (end - ip < 2) return -1;
+        uint32_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst)) return -1;
+
+        uint32_t match_len = token & 15;
+        if (match_len == 15 && !lz_get_length(&ip, end, &match_len)) return -1;
+        match_len += LZ_MIN_MATCH;
+        if (match_len > (uint32_t)(op_end - op)) return -1;
+
+        // Byte copy: a match may overlap the bytes it produces
+        const uint8_t *ref = op - offset;
+        while (match_len--) *op++ = *ref++;
+    }
+    return op - dst;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ==========================================
+// Writer thread
+// ==========================================
+
+static void tracer_write_block(Tracer *t, const uint8_t *data, uint32_t len) {
+    const uint8_t *stored = data;
+    uint32_t stored_len = len;
+
+    if (t->flags & TRACE_F_COMPRESS) {
+        uint32_t packed = lz_compress(data, len, t->scratch);
+        if (packed < len) {
+            stored = t->scratch;
+            stored_len = packed;
+        }
+    }
+
+    uint8_t header[8];
+    put_le32(header, len);
+    put_le32(header + 4, stored_len);
+    if (fwrite(header, 1, sizeof(header), t->file) != sizeof(header) ||
+        fwrite(stored, 1, stored_len, t->file) != stored_len) {
+        t->write_error = true;
+    }
+    t->raw_bytes += len;
+    t->stored_bytes += sizeof(header) + stored_len;
+}
+
+static void* tracer_thread(void *arg) {
+    Tracer *t = (Tracer *)arg;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        while (t->tail == t->head && !t->stop) {
+            pthread_cond_wait(&t->filled, &t->lock);
+        }
+        if (t->tail == t->head) break;
+
+        int slot = t->tail % TRACE_BLOCK_SLOTS;
+        pthread_mutex_unlock(&t->lock);
+
+        tracer_write_block(t, t->slots[slot], t->slot_len[slot]);
+
+        pthread_mutex_lock(&t->lock);
+        t->tail++;
+        pthread_cond_signal(&t->drained);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+// ==========================================
+// Producer side
+// ==========================================
+
+static void tracer_publish(Tracer *t) {
+    int slot = t->head % TRACE_BLOCK_SLOTS;
+    uint32_t len = (uint32_t)(t->pos - t->slots[slot]);
+    if (len == 0) return;
+
+    pthread_mutex_lock(&t->lock);
+    t->slot_len[slot] = len;
+    t->head++;
+    pthread_cond_signal(&t->filled);
+    while (t->head - t->tail >= TRACE_BLOCK_SLOTS) {
+        t->stalls++;
+        pthread_cond_wait(&t->drained, &t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+// Hand the current block to the writer and start the next one
+void tracer_next_block(Tracer *t) {
+    tracer_publish(t);
+
+    t->pos = t->slots[t->head % TRACE_BLOCK_SLOTS];
+    t->limit = t->pos + TRACE_BLOCK_SIZE - TRACE_RECORD_MAX;
+    t->last_pc = 0;
+    t->last_addr = 0;
+}
+
+// Full record: PC plus the registers that changed since the last record
+// and the stores collected by tracer_note_write. Stores made while
+// entering an interrupt are reported with the handler's first instruction.
+void tracer_record_effects(SimulatorState *sim, uint32_t pc) {
+    Tracer *t = sim->tracer;
+    if (t->pos >= t->limit) tracer_next_block(t);
+
+    uint8_t changed[TRACE_NUM_REGS];
+    int change_count = 0;
+    if (t->flags & TRACE_F_REGS) {
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            if (sim->registers[i] != t->shadow[i]) {
+                t->shadow[i] = sim->registers[i];
+                changed[change_count++] = (uint8_t)i;
+            }
+        }
+        if (sim->flags != t->shadow[TRACE_REG_FLAGS]) {
+            t->shadow[TRACE_REG_FLAGS] = sim->flags;
+            changed[change_count++] = TRACE_REG_FLAGS;
+        }
+        if (sim->sp != t->shadow[TRACE_REG_SP]) {
+            t->shadow[TRACE_REG_SP] = sim->sp;
+            changed[change_count++] = TRACE_REG_SP;
+        }
+    }
+
+    uint64_t header = trace_zigzag((int32_t)(pc - t->last_pc)) << 2;
+    if (change_count) header |= TRACE_REC_REGS;
+    if (t->write_count) header |= TRACE_REC_MEM;
+
+    uint8_t *p = trace_put_varint(t->pos, header);
+    if (change_count) {
+        *p++ = (uint8_t)change_count;
+        for (int i = 0; i < change_count; i++) {
+            *p++ = changed[i];
+            p = trace_put_varint(p, t->shadow[changed[i]]);
+        }
+    }
+    if (t->write_count) {
+        *p++ = (uint8_t)t->write_count;
+        for (int i = 0; i < t->write_count; i++) {
+            TraceWrite *w = &t->writes[i];
+            p = trace_put_varint(p, trace_zigzag((int32_t)(w->address - t->last_addr)));
+            *p++ = w->size;
+            p = trace_put_varint(p, w->value);
+            t->last_addr = w->address + w->size;
+        }
+        t->write_count = 0;
+    }
+
+    t->pos = p;
+    t->last_pc = pc;
+    t->records++;
+}
+
+int tracer_start(SimulatorState *sim, const char *path, uint32_t flags) {
+    if (!sim || !path || sim->tracer) return 0;
+
+    Tracer *t = calloc(1, sizeof(Tracer));
+    if (!t) return 0;
+
+    for (int i = 0; i < TRACE_BLOCK_SLOTS; i++) {
+        t->slots[i] = malloc(TRACE_BLOCK_SIZE);
+        if (!t->slots[i]) goto fail;
+    }
+
+    // Settled before the header and the writer thread; never changed after
+    if (flags & TRACE_F_COMPRESS) {
+        t->scratch = malloc(LZ_BOUND(TRACE_BLOCK_SIZE));
+        if (!t->scratch) flags &= ~TRACE_F_COMPRESS;
+    }
+
+    t->file = fopen(path, "wb");
+    if (!t->file) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot create trace file '%s'\n", path);
+        goto fail;
+    }
+
+    uint8_t header[TRACE_HEADER_SIZE] = {0};
+    memcpy(header, TRACE_MAGIC, 4);
+    header[4] = TRACE_VERSION & 0xFF;
+    header[5] = TRACE_VERSION >> 8;
+    header[6] = flags & 0xFF;
+    header[7] = (flags >> 8) & 0xFF;
+    put_le32(header + 8, sim->pc);
+    if (fwrite(header, 1, sizeof(header), t->file) != sizeof(header)) goto fail;
+
+    t->flags = flags;
+    memcpy(t->shadow, sim->registers, sizeof(sim->registers));
+    t->shadow[TRACE_REG_FLAGS] = sim->flags;
+    t->shadow[TRACE_REG_SP] = sim->sp;
+    t->pos = t->slots[0];
+    t->limit = t->pos + TRACE_BLOCK_SIZE - TRACE_RECORD_MAX;
+
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->filled, NULL);
+    pthread_cond_init(&t->drained, NULL);
+    if (pthread_create(&t->thread, NULL, tracer_thread, t) != 0) {
+        pthread_mutex_destroy(&t->lock);
+        pthread_cond_destroy(&t->filled);
+        pthread_cond_destroy(&t->drained);
+        goto fail;
+    }
+
+    sim->tracer = t;
+    return 1;
+
+fail:
+    if (t->file) fclose(t->file);
+    for (int i = 0; i < TRACE_BLOCK_SLOTS; i++) free(t->slots[i]);
+    free(t->scratch);
+    free(t);
+    return 0;
+}
+
+// Flush the partial block, wait for the writer and close the file
+int tracer_stop(SimulatorState *sim) {
+    if (!sim || !sim->tracer) return 0;
+    Tracer *t = sim->tracer;
+    sim->tracer = NULL;
+
+    tracer_publish(t);
+
+    pthread_mutex_lock(&t->lock);
+    t->stop = true;
+    pthread_cond_signal(&t->filled);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+
+    if (fclose(t->file) != 0) t->write_error = true;
+
+    bebo_log(BEBO_LOG_INFO, "Trace: %lu records, %lu bytes (%.2f per instruction), %lu written\n",
+             (unsigned long)t->records, (unsigned long)t->raw_bytes,
+             t->records ? (double)t->raw_bytes / t->records : 0.0,
+             (unsigned long)(t->stored_bytes + TRACE_HEADER_SIZE));
+    if (t->stalls) {
+        bebo_log(BEBO_LOG_INFO, "Trace: simulator waited for the writer %lu times\n", (unsigned long)t->stalls);
+    }
+    if (t->write_error) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Trace file is incomplete (write failed)\n");
+    }
+
+    int ok = !t->write_error;
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->filled);
+    pthread_cond_destroy(&t->drained);
+    for (int i = 0; i < TRACE_BLOCK_SLOTS; i++) free(t->slots[i]);
+    free(t->scratch);
+    free(t);
+    return ok;
+}
+
+// ==========================================
+// Reader
+// ==========================================
+
+static int trace_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return 0;
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Decode one block; returns 1 to continue, 0 on error, -1 if fn stopped
+static int trace_decode_block(const uint8_t *p, const uint8_t *end, TraceRecord *rec,
+                              TraceRecordFn fn, void *user) {
+    uint32_t last_pc = 0;
+    uint32_t last_addr = 0;
+
+    while (p < end) {
+        uint64_t header, v;
+        if (!trace_get_varint(&p, end, &header)) return 0;
+        rec->pc = last_pc + (uint32_t)trace_unzigzag(header >> 2);
+        last_pc = rec->pc;
+        rec->reg_count = 0;
+        rec->write_count = 0;
+
+        if (header & TRACE_REC_REGS) {
+            if (p >= end || *p > TRACE_NUM_REGS) return 0;
+            rec->reg_count = *p++;
+            for (int i = 0; i < rec->reg_count; i++) {
+                if (p >= end || *p >= TRACE_NUM_REGS) return 0;
+                rec->regs[i] = *p++;
+                if (!trace_get_varint(&p, end, &v)) return 0;
+                rec->reg_values[i] = (uint32_t)v;
+            }
+        }
+        if (header & TRACE_REC_MEM) {
+            if (p >= end || *p > TRACE_MAX_WRITES) return 0;
+            rec->write_count = *p++;
+            for (int i = 0; i < rec->write_count; i++) {
+                TraceWrite *w = &rec->writes[i];
+                if (!trace_get_varint(&p, end, &v) || p >= end) return 0;
+                w->address = last_addr + (uint32_t)trace_unzigzag(v);
+                w->size = *p++;
+                if (!trace_get_varint(&p, end, &v)) return 0;
+                w->value = (uint32_t)v;
+                last_addr = w->address + w->size;
+            }
+        }
+
+        if (fn(user, rec)) return -1;
+    }
+    return 1;
+}
+
+int trace_read_file(const char *path, TraceHeader *header, TraceRecordFn fn, void *user) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Cannot open trace file '%s'\n", path);
+        return 0;
+    }
+
+    uint8_t head[TRACE_HEADER_SIZE];
+    if (fread(head, 1, sizeof(head), file) != sizeof(head) || memcmp(head, TRACE_MAGIC, 4) != 0) {
+        bebo_log(BEBO_LOG_ERROR, "Error: '%s' is not a trace file\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    TraceHeader info;
+    info.version = head[4] | (head[5] << 8);
+    info.flags = head[6] | (head[7] << 8);
+    info.start_pc = get_le32(head + 8);
+    if (info.version != TRACE_VERSION) {
+        bebo_log(BEBO_LOG_ERROR, "Error: Unsupported trace version %u\n", info.version);
+        fclose(file);
+        return 0;
+    }
+    if (header) *header = info;
+
+    uint8_t *stored = malloc(LZ_BOUND(TRACE_BLOCK_SIZE));
+    uint8_t *raw = malloc(TRACE_BLOCK_SIZE);
+    TraceRecord *rec = malloc(sizeof(TraceRecord));
+    int result = stored && raw && rec;
+
+    uint8_t block_header[8];
+    while (result && fread(block_header, 1, sizeof(block_header), file) == sizeof(block_header)) {
+        uint32_t raw_len = get_le32(block_header);
+        uint32_t stored_len = get_le32(block_header + 4);
+        if (raw_len > TRACE_BLOCK_SIZE || stored_len > raw_len ||
+            fread(stored, 1, stored_len, file) != stored_len) {
+            result = 0;
+            break;
+        }
+
+        const uint8_t *data = stored;
+        if (stored_len < raw_len) {
+            if (lz_decompress(stored, stored_len, raw, TRACE_BLOCK_SIZE) != raw_len) {
+                result = 0;
+                break;
+            }
+            data = raw;
+        }
+
+        int status = trace_decode_block(data, data + raw_len, rec, fn, user);
+        if (status <= 0) {
+            result = status < 0;
+            break;
+        }
+    }
+
+    if (!result) bebo_log(BEBO_LOG_ERROR, "Error: Corrupt trace file '%s'\n", path);
+    free(stored);
+    free(raw);
+    free(rec);
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,317 @@
+#include "../include/beboasm.h"
+#include "../include/opcodes.h"
+#include "../include/tracer.h"
+#include "../include/symtab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+// bebotrace: decode a bebosim --trace file into text, a per-address
+// histogram, or collapsed stacks (flamegraph.pl / speedscope input)
+
+static SymbolTable symbols;             // Code labels
+static uint8_t *image = NULL;          // Program bytes for opcode lookups
+static uint32_t image_size = 0;
+
+// A .basm program provides code labels as well as the image
+static int load_program(const char *path) {
+    size_t len = strlen(path);
+    if (len > 5 && strcasecmp(path + len - 5, ".basm") == 0) {
+        AssemblerState *state = assembler_create(true, false);
+        if (!state) return 0;
+        state->quiet = true;
+        if (!assemble_file(state, path)) {
+            assembler_destroy(state);
+            return 0;
+        }
+
+        if (!symtab_add_assembler(&symbols, NULL, state, SYM_CODE)) {
+            assembler_destroy(state);
+            return 0;
+        }
+
+        image = state->memory;
+        image_size = MEMORY_SIZE;
+        state->memory = NULL;
+        assembler_destroy(state);
+        return 1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+        return 0;
+    }
+    image = calloc(MEMORY_SIZE, 1);
+    if (image) image_size = (uint32_t)fread(image, 1, MEMORY_SIZE, file);
+    fclose(file);
+    return image != NULL;
+}
+
+static const char* symbolize(uint32_t address, char *buf, size_t size) {
+    return symtab_format(&symbols, address, buf, size);
+}
+
+static uint8_t opcode_at(uint32_t address) {
+    return address < image_size ? image[address] : OP_NOP;
+}
+
+// ==========================================
+// text: one line per instruction
+// ==========================================
+
+typedef struct {
+    uint64_t index;
+    uint64_t limit;
+} TextState;
+
+static int text_record(void *user, const TraceRecord *rec) {
+    TextState *st = (TextState *)user;
+    char name[MAX_LABEL_LEN + 16];
+
+    printf("%10lu  0x%06X", (unsigned long)st->index, rec->pc);
+    if (symbols.count) printf("  %-24s", symbolize(rec->pc, name, sizeof(name)));
+
+    for (int i = 0; i < rec->reg_count; i++) {
+        int r = rec->regs[i];
+        if (r == TRACE_REG_FLAGS) {
+            printf("  FLAGS=0x%X", rec->reg_values[i]);
+        } else if (r == TRACE_REG_SP) {
+            printf("  SP=0x%X", rec->reg_values[i]);
+        } else {
+            printf("  R%d=0x%X", r, rec->reg_values[i]);
+        }
+    }
+    for (int i = 0; i < rec->write_count; i++) {
+        const TraceWrite *w = &rec->writes[i];
+        printf("  [0x%X]%u=0x%X", w->address, w->size, w->value);
+    }
+    printf("\n");
+
+    return ++st->index == st->limit;
+}
+
+// ==========================================
+// hist: execution count per address
+// ==========================================
+
+typedef struct {
+    uint32_t pc;
+    uint64_t count;
+} HistEntry;
+
+typedef struct {
+    HistEntry *entries;         // Open addressing; count 0 = empty
+    uint32_t capacity;
+    uint32_t used;
+    uint64_t total;
+} Histogram;
+
+static int hist_insert(Histogram *h, uint32_t pc, uint64_t count) {
+    uint32_t i = (pc * 0x9E3779B1u) & (h->capacity - 1);
+    while (h->entries[i].count && h->entries[i].pc != pc) {
+        i = (i + 1) & (h->capacity - 1);
+    }
+    if (!h->entries[i].count) {
+        h->entries[i].pc = pc;
+        h->used++;
+    }
+    h->entries[i].count += count;
+    return 1;
+}
+
+static int hist_grow(Histogram *h) {
+    HistEntry *old = h->entries;
+    uint32_t old_capacity = h->capacity;
+
+    h->capacity = old_capacity ? old_capacity * 2 : 4096;
+    h->entries = calloc(h->capacity, sizeof(HistEntry));
+    if (!h->entries) return 0;
+    h->used = 0;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old[i].count) hist_insert(h, old[i].pc, old[i].count);
+    }
+    free(old);
+    return 1;
+}
+
+static int hist_record(void *user, const TraceRecord *rec) {
+    Histogram *h = (Histogram *)user;
+    if (h->used * 2 >= h->capacity && !hist_grow(h)) return 1;
+    hist_insert(h, rec->pc, 1);
+    h->total++;
+    return 0;
+}
+
+static int hist_compare(const void *a, const void *b) {
+    const HistEntry *x = (const HistEntry *)a;
+    const HistEntry *y = (const HistEntry *)b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return (x->pc > y->pc) - (x->pc < y->pc);
+}
+
+static void hist_print(Histogram *h) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < h->capacity; i++) {
+        if (h->entries[i].count) h->entries[n++] = h->entries[i];
+    }
+    qsort(h->entries, n, sizeof(HistEntry), hist_compare);
+
+    char name[MAX_LABEL_LEN + 16];
+    printf("# %lu instructions at %u addresses\n", (unsigned long)h->total, n);
+    printf("#      count       %%  address   symbol\n");
+    for (uint32_t i = 0; i < n; i++) {
+        printf("%12lu  %6.2f  0x%06X  %s\n", (unsigned long)h->entries[i].count,
+               100.0 * h->entries[i].count / h->total, h->entries[i].pc,
+               symbols.count ? symbolize(h->entries[i].pc, name, sizeof(name)) : "");
+    }
+}
+
+// ==========================================
+// collapsed: instructions per call stack
+// ==========================================
+
+typedef struct StackNode {
+    uint32_t entry;             // Function address (call target)
+    uint64_t count;             // Instructions executed in this frame itself
+    struct StackNode *parent;
+    struct StackNode *child;
+    struct StackNode *sibling;
+} StackNode;
+
+typedef struct {
+    StackNode *root;
+    StackNode *current;
+    uint8_t last_opcode;
+    bool started;
+} StackState;
+
+static StackNode* stack_child(StackNode *parent, uint32_t entry) {
+    for (StackNode *n = parent->child; n; n = n->sibling) {
+        if (n->entry == entry) return n;
+    }
+    StackNode *n = calloc(1, sizeof(StackNode));
+    if (!n) return NULL;
+    n->entry = entry;
+    n->parent = parent;
+    n->sibling = parent->child;
+    parent->child = n;
+    return n;
+}
+
+// The instruction after a CALL opens a frame and the one after a RET
+// closes it. Interrupt handlers are counted in the interrupted frame.
+static int stack_record(void *user, const TraceRecord *rec) {
+    StackState *st = (StackState *)user;
+
+    if (!st->started) {
+        st->started = true;
+    } else if (st->last_opcode == OP_CALL) {
+        StackNode *n = stack_child(st->current, rec->pc);
+        if (!n) return 1;
+        st->current = n;
+    } else if (st->last_opcode == OP_RET && st->current->parent) {
+        st->current = st->current->parent;
+    }
+
+    st->current->count++;
+    st->last_opcode = opcode_at(rec->pc);
+    return 0;
+}
+
+static void stack_print(StackNode *node, char *path, size_t len, size_t size) {
+    char name[MAX_LABEL_LEN + 16];
+    int n = snprintf(path + len, size - len, "%s%s", len ? ";" : "",
+                     symbolize(node->entry, name, sizeof(name)));
+    if (n < 0 || (size_t)n >= size - len) return;
+    len += n;
+
+    if (node->count) printf("%s %lu\n", path, (unsigned long)node->count);
+    for (StackNode *c = node->child; c; c = c->sibling) {
+        stack_print(c, path, len, size);
+    }
+}
+
+static void stack_free(StackNode *node) {
+    while (node) {
+        StackNode *next = node->sibling;
+        stack_free(node->child);
+        free(node);
+        node = next;
+    }
+}
+
+static void usage(void) {
+    printf("Usage: bebotrace [options] <trace file>\n"
+           "  -f FORMAT      text (default), hist, or collapsed\n"
+           "  -p PROGRAM     Program that was traced (.basm for symbols, or .bin);\n"
+           "                 required for collapsed\n"
+           "  -n N           Stop text output after N instructions\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *format = "text";
+    const char *program = NULL;
+    const char *trace_path = NULL;
+    uint64_t limit = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            program = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = strtoull(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            usage();
+            return 1;
+        } else {
+            trace_path = argv[i];
+        }
+    }
+
+    if (!trace_path) {
+        usage();
+        return 1;
+    }
+    if (program && !load_program(program)) return 1;
+
+    TraceHeader header;
+    int ok;
+
+    if (strcmp(format, "text") == 0) {
+        TextState st = {0, limit};
+        ok = trace_read_file(trace_path, &header, text_record, &st);
+    } else if (strcmp(format, "hist") == 0) {
+        Histogram h = {0};
+        ok = hist_grow(&h) && trace_read_file(trace_path, &header, hist_record, &h);
+        if (ok) hist_print(&h);
+        free(h.entries);
+    } else if (strcmp(format, "collapsed") == 0) {
+        if (!image) {
+            fprintf(stderr, "Error: collapsed output needs the program (-p)\n");
+            return 1;
+        }
+        // The root frame is named after the trace's first instruction
+        StackState st = {0};
+        st.root = st.current = calloc(1, sizeof(StackNode));
+        ok = st.root != NULL;
+        if (ok) {
+            ok = trace_read_file(trace_path, &header, stack_record, &st);
+        }
+        if (ok) {
+            static char path[65536];
+            st.root->entry = header.start_pc;
+            stack_print(st.root, path, 0, sizeof(path));
+        }
+        stack_free(st.root);
+    } else {
+        fprintf(stderr, "Error: Unknown format '%s'\n", format);
+        return 1;
+    }
+
+    symtab_free(&symbols);
+    free(image);
+    return ok ? 0 : 1;
+}
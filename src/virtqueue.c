@@ -0,0 +1,409 @@
+#include "../include/beboasm.h"
+#include "../include/devices.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Virtqueue register offsets from PORT_VIRTQ_BASE
+#define VQ_REG_SEL          0   // Queue select (VIRTQ_TX or VIRTQ_RX)
+#define VQ_REG_SIZE         1   // Ring size (power of two, <= VIRTQ_MAX_SIZE)
+#define VQ_REG_DESC         2   // Guest address of the descriptor table
+#define VQ_REG_AVAIL        3   // Guest address of the available ring
+#define VQ_REG_USED         4   // Guest address of the used ring
+#define VQ_REG_READY        5   // Write 1 to enable the selected queue
+#define VQ_REG_NOTIFY       6   // Write a queue index to process its available buffers
+#define VQ_REG_ISR          7   // Read: interrupt status (cleared on read)
+
+// Guest layout (little endian, virtio split ring)
+//   Descriptor: u32 addr, u32 addr_hi (ignored), u32 len, u16 flags, u16 next
+//   Available:  u16 flags, u16 idx, u16 ring[size]
+//   Used:       u16 flags, u16 idx, { u32 id, u32 len } ring[size]
+#define VQ_DESC_SIZE        16
+#define VQ_DESC_F_NEXT      0x01
+#define VQ_DESC_F_WRITE     0x02
+
+#define VQ_ISR_USED         0x01
+
+typedef struct {
+    uint32_t size;
+    uint32_t desc;
+    uint32_t avail;
+    uint32_t used;
+    bool ready;
+    uint16_t last_avail;
+    uint16_t used_idx;
+} Virtqueue;
+
+typedef struct {
+    VirtqBackend *backend;
+    Virtqueue queues[VIRTQ_NUM_QUEUES];
+    uint32_t sel;
+    uint8_t isr;
+
+    // Statistics
+    uint64_t notifications;
+    uint64_t buffers;
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+} VirtqDevice;
+
+static uint16_t guest_read16(SimulatorState *sim, uint32_t addr) {
+    if (addr > MEMORY_SIZE - 2) return 0;
+    return sim->memory[addr] | (sim->memory[addr + 1] << 8);
+}
+
+static uint32_t guest_read32(SimulatorState *sim, uint32_t addr) {
+    if (addr > MEMORY_SIZE - 4) return 0;
+    return sim->memory[addr] | (sim->memory[addr + 1] << 8) |
+           (sim->memory[addr + 2] << 16) | ((uint32_t)sim->memory[addr + 3] << 24);
+}
+
+static void guest_write16(SimulatorState *sim, uint32_t addr, uint16_t value) {
+    uint8_t bytes[2] = { value & 0xFF, value >> 8 };
+    memory_write_block(sim, addr, bytes, 2);
+}
+
+static void guest_write32(SimulatorState *sim, uint32_t addr, uint32_t value) {
+    uint8_t bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24 };
+    memory_write_block(sim, addr, bytes, 4);
+}
+
+// Walk one descriptor chain, moving data between guest buffers and the
+// backend. Returns the number of bytes written into guest memory.
+static uint32_t virtq_process_chain(SimulatorState *sim, VirtqDevice *vq, Virtqueue *q, uint16_t head) {
+    uint32_t written = 0;
+    uint16_t index = head;
+
+    // Bound the walk by the ring size so a looping chain cannot hang the host
+    for (uint32_t hops = 0; hops < q->size; hops++) {
+        uint32_t desc = q->desc + (uint32_t)(index % q->size) * VQ_DESC_SIZE;
+        uint32_t addr = guest_read32(sim, desc);
+        uint32_t len = guest_read32(sim, desc + 8);
+        uint16_t flags = guest_read16(sim, desc + 12);
+        uint16_t next = guest_read16(sim, desc + 14);
+
+        if (len > 0) {
+            bool to_guest = (flags & VQ_DESC_F_WRITE) != 0;
+            uint8_t *buf = memory_map_block(sim, addr, len, to_guest);
+            if (!buf) break;
+
+            if (to_guest) {
+                long n = vq->backend->read ? vq->backend->read(vq->backend, buf, len) : 0;
+                if (n > 0) {
+                    written += (uint32_t)n;
+                    vq->bytes_in += (uint64_t)n;
+                }
+            } else if (vq->backend->write) {
+                long n = vq->backend->write(vq->backend, buf, len);
+                if (n > 0) vq->bytes_out += (uint64_t)n;
+            }
+        }
+
+        if (!(flags & VQ_DESC_F_NEXT)) break;
+        index = next;
+    }
+
+    return written;
+}
+
+// Drain every available buffer on a queue and publish the completions
+static void virtq_notify(SimulatorState *sim, VirtqDevice *vq, uint32_t queue) {
+    if (queue >= VIRTQ_NUM_QUEUES) return;
+
+    Virtqueue *q = &vq->queues[queue];
+    if (!q->ready || q->size == 0) return;
+
+    vq->notifications++;
+
+    uint16_t avail_idx = guest_read16(sim, q->avail + 2);
+    uint32_t completed = 0;
+
+    while (q->last_avail != avail_idx) {
+        uint16_t head = guest_read16(sim, q->avail + 4 + (uint32_t)(q->last_avail % q->size) * 2);
+        uint32_t len = virtq_process_chain(sim, vq, q, head);
+
+        uint32_t elem = q->used + 4 + (uint32_t)(q->used_idx % q->size) * 8;
+        guest_write32(sim, elem, head);
+        guest_write32(sim, elem + 4, len);
+
+        q->last_avail++;
+        q->used_idx++;
+        completed++;
+    }
+
+    if (completed) {
+        // One index update and one interrupt per batch
+        guest_write16(sim, q->used + 2, q->used_idx);
+        vq->buffers += completed;
+        vq->isr |= VQ_ISR_USED;
+        interrupt_raise(sim, IRQ_VIRTQ);
+    }
+}
+
+static uint32_t virtq_read(SimulatorState *sim, void *opaque, uint16_t port) {
+    (void)sim;
+    VirtqDevice *vq = (VirtqDevice *)opaque;
+    Virtqueue *q = &vq->queues[vq->sel];
+
+    switch (port - PORT_VIRTQ_BASE) {
+        case VQ_REG_SEL:   return vq->sel;
+        case VQ_REG_SIZE:  return q->size;
+        case VQ_REG_DESC:  return q->desc;
+        case VQ_REG_AVAIL: return q->avail;
+        case VQ_REG_USED:  return q->used;
+        case VQ_REG_READY: return q->ready;
+        case VQ_REG_ISR: {
+            uint32_t isr = vq->isr;
+            vq->isr = 0;
+            return isr;
+        }
+    }
+    return 0;
+}
+
+static void virtq_write(SimulatorState *sim, void *opaque, uint16_t port, uint32_t value) {
+    VirtqDevice *vq = (VirtqDevice *)opaque;
+    Virtqueue *q = &vq->queues[vq->sel];
+
+    switch (port - PORT_VIRTQ_BASE) {
+        case VQ_REG_SEL:
+            if (value < VIRTQ_NUM_QUEUES) vq->sel = value;
+            break;
+        case VQ_REG_SIZE:
+            if (value && value <= VIRTQ_MAX_SIZE && (value & (value - 1)) == 0) q->size = value;
+            break;
+        case VQ_REG_DESC:  q->desc = value; break;
+        case VQ_REG_AVAIL: q->avail = value; break;
+        case VQ_REG_USED:  q->used = value; break;
+        case VQ_REG_READY:
+            q->ready = value != 0;
+            q->last_avail = 0;
+            q->used_idx = 0;
+            break;
+        case VQ_REG_NOTIFY:
+            virtq_notify(sim, vq, value);
+            break;
+    }
+}
+
+static void virtq_reset(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    VirtqDevice *vq = (VirtqDevice *)opaque;
+    memset(vq->queues, 0, sizeof(vq->queues));
+    vq->sel = 0;
+    vq->isr = 0;
+}
+
+static void virtq_print_stats(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    VirtqDevice *vq = (VirtqDevice *)opaque;
+    bebo_log(BEBO_LOG_INFO, "Virtqueue: %lu notifications, %lu buffers, %lu bytes out, %lu bytes in\n",
+             (unsigned long)vq->notifications, (unsigned long)vq->buffers,
+             (unsigned long)vq->bytes_out, (unsigned long)vq->bytes_in);
+}
+
+static uint64_t virtq_counter(SimulatorState *sim, void *opaque) {
+    (void)sim;
+    return ((VirtqDevice *)opaque)->buffers;
+}
+
+static void virtq_destroy(void *opaque) {
+    VirtqDevice *vq = (VirtqDevice *)opaque;
+    if (!vq) return;
+    if (vq->backend && vq->backend->close) vq->backend->close(vq->backend);
+    free(vq);
+}
+
+int virtq_attach(SimulatorState *sim, VirtqBackend *backend) {
+    if (!sim || !backend) return 0;
+
+    // The device owns the backend from here on, even if attaching fails
+    VirtqDevice *vq = calloc(1, sizeof(VirtqDevice));
+    if (!vq) {
+        if (backend->close) backend->close(backend);
+        return 0;
+    }
+    vq->backend = backend;
+
+    Device *dev = device_register(sim, "virtqueue", PORT_VIRTQ_BASE, PORT_VIRTQ_COUNT,
+                                  virtq_read, virtq_write, vq);
+    if (!dev) {
+        virtq_destroy(vq);
+        return 0;
+    }
+    dev->reset = virtq_reset;
+    dev->idle_reads = ~(1ULL << VQ_REG_ISR);
+    dev->print_stats = virtq_print_stats;
+    dev->counter = virtq_counter;
+    dev->counter_name = "virtq_buffers";
+    dev->destroy = virtq_destroy;
+    return 1;
+}
+
+// ==========================================
+// Host Backends
+// ==========================================
+
+// File descriptor backend (files, pipes, stdin/stdout)
+typedef struct {
+    int in_fd;
+    int out_fd;
+    bool close_in;
+    bool close_out;
+} FdBackend;
+
+static long fd_backend_read(VirtqBackend *be, uint8_t *buf, uint32_t len) {
+    FdBackend *fb = (FdBackend *)be->opaque;
+    if (fb->in_fd < 0) return 0;
+
+    ssize_t n;
+    do {
+        n = read(fb->in_fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+    return n < 0 ? 0 : (long)n;
+}
+
+static long fd_backend_write(VirtqBackend *be, const uint8_t *buf, uint32_t len) {
+    FdBackend *fb = (FdBackend *)be->opaque;
+    if (fb->out_fd < 0) return 0;
+
+    uint32_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fb->out_fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (uint32_t)n;
+    }
+    return (long)done;
+}
+
+static void fd_backend_close(VirtqBackend *be) {
+    FdBackend *fb = (FdBackend *)be->opaque;
+    if (fb->close_in && fb->in_fd >= 0) close(fb->in_fd);
+    if (fb->close_out && fb->out_fd >= 0) close(fb->out_fd);
+    free(fb);
+    free(be);
+}
+
+VirtqBackend* virtq_backend_fd(int in_fd, int out_fd) {
+    VirtqBackend *be = calloc(1, sizeof(VirtqBackend));
+    FdBackend *fb = calloc(1, sizeof(FdBackend));
+    if (!be || !fb) {
+        free(be);
+        free(fb);
+        return NULL;
+    }
+    fb->in_fd = in_fd;
+    fb->out_fd = out_fd;
+
+    be->name = "fd";
+    be->read = fd_backend_read;
+    be->write = fd_backend_write;
+    be->close = fd_backend_close;
+    be->opaque = fb;
+    return be;
+}
+
+// Paths may be NULL (unused direction) or "-" for stdin/stdout
+VirtqBackend* virtq_backend_file(const char *in_path, const char *out_path) {
+    int in_fd = -1, out_fd = -1;
+
+    if (in_path) {
+        in_fd = strcmp(in_path, "-") == 0 ? STDIN_FILENO : open(in_path, O_RDONLY);
+        if (in_fd < 0) {
+            bebo_log(BEBO_LOG_ERROR, "Error: Cannot open '%s' for virtqueue input\n", in_path);
+            return NULL;
+        }
+    }
+    if (out_path) {
+        out_fd = strcmp(out_path, "-") == 0 ? STDOUT_FILENO
+                                            : open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            bebo_log(BEBO_LOG_ERROR, "Error: Cannot open '%s' for virtqueue output\n", out_path);
+            if (in_fd > STDIN_FILENO) close(in_fd);
+            return NULL;
+        }
+    }
+
+    VirtqBackend *be = virtq_backend_fd(in_fd, out_fd);
+    if (!be) {
+        if (in_fd > STDIN_FILENO) close(in_fd);
+        if (out_fd > STDERR_FILENO) close(out_fd);
+        return NULL;
+    }
+
+    be->name = "file";
+    FdBackend *fb = (FdBackend *)be->opaque;
+    fb->close_in = in_fd > STDIN_FILENO;
+    fb->close_out = out_fd > STDERR_FILENO;
+    return be;
+}
+
+// Memory stream backend: reads from a caller-supplied buffer, writes
+// append to a growable buffer retrievable with virtq_backend_memory_output
+typedef struct {
+    const uint8_t *input;
+    size_t input_len;
+    size_t input_pos;
+    uint8_t *output;
+    size_t output_len;
+    size_t output_cap;
+} MemBackend;
+
+static long mem_backend_read(VirtqBackend *be, uint8_t *buf, uint32_t len) {
+    MemBackend *mb = (MemBackend *)be->opaque;
+    size_t left = mb->input_len - mb->input_pos;
+    size_t n = len < left ? len : left;
+    memcpy(buf, mb->input + mb->input_pos, n);
+    mb->input_pos += n;
+    return (long)n;
+}
+
+static long mem_backend_write(VirtqBackend *be, const uint8_t *buf, uint32_t len) {
+    MemBackend *mb = (MemBackend *)be->opaque;
+    if (mb->output_len + len > mb->output_cap) {
+        size_t cap = mb->output_cap ? mb->output_cap : 4096;
+        while (cap < mb->output_len + len) cap *= 2;
+        uint8_t *grown = realloc(mb->output, cap);
+        if (!grown) return 0;
+        mb->output = grown;
+        mb->output_cap = cap;
+    }
+    memcpy(mb->output + mb->output_len, buf, len);
+    mb->output_len += len;
+    return (long)len;
+}
+
+static void mem_backend_close(VirtqBackend *be) {
+    MemBackend *mb = (MemBackend *)be->opaque;
+    free(mb->output);
+    free(mb);
+    free(be);
+}
+
+VirtqBackend* virtq_backend_memory(const uint8_t *input, size_t input_len) {
+    VirtqBackend *be = calloc(1, sizeof(VirtqBackend));
+    MemBackend *mb = calloc(1, sizeof(MemBackend));
+    if (!be || !mb) {
+        free(be);
+        free(mb);
+        return NULL;
+    }
+    mb->input = input;
+    mb->input_len = input ? input_len : 0;
+
+    be->name = "memory";
+    be->read = mem_backend_read;
+    be->write = mem_backend_write;
+    be->close = mem_backend_close;
+    be->opaque = mb;
+    return be;
+}
+
+const uint8_t* virtq_backend_memory_output(VirtqBackend *be, size_t *len) {
+    MemBackend *mb = (MemBackend *)be->opaque;
+    if (len) *len = mb->output_len;
+    return mb->output;
+}